@@ -17,6 +17,7 @@
 #include <netinet/in.h>
 #include <stdio.h>
 #include <sys/socket.h>
+#include <unistd.h>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -167,6 +168,11 @@ int main(int argc, char** argv) {
     assert(response.is_ok());
     std::string edge_config_str = response.value().as_string();
     uint64_t write_epoch = get_latest_epoch(comm_spec, etcd_client);
+    // keep the writer from freeing the blocks of the epoch while reading
+    std::string reader_epoch_key =
+        FLAGS_meta_prefix + "gart_reader_epoch_p" +
+        std::to_string(comm_spec.fid()) + "_" + std::to_string(getpid());
+    etcd_client->put(reader_epoch_key, std::to_string(write_epoch)).wait();
     schema_key = FLAGS_meta_prefix + "gart_blob_m" + std::to_string(0) + "_p" +
                  std::to_string(comm_spec.fid()) + "_e" +
                  std::to_string(write_epoch);
@@ -203,6 +209,8 @@ int main(int argc, char** argv) {
     RunPropertyPageRank(fragment, comm_spec, "./output_property_ctx_pr/");
 
     MPI_Barrier(comm_spec.comm());
+
+    etcd_client->rm(reader_epoch_key).wait();
   }
 
   grape::FinalizeMPIComm();
@@ -0,0 +1,228 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "bulk_load.h"  // NOLINT(build/include_subdir)
+
+#include <charconv>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+using json = vineyard::json;
+
+namespace {
+// rows of a table converted as one batch
+constexpr size_t kBulkLoadBatchRows = 65536;
+
+struct CsvField {
+  std::string value;
+  bool null = false;
+};
+
+/**
+ * Reads a row of an RFC 4180 CSV file: fields are separated by commas and
+ * may be quoted, with "" for a quote inside. Quoted fields may span lines.
+ */
+bool read_csv_row(std::istream& in, std::vector<CsvField>& fields) {
+  std::string line;
+  if (!std::getline(in, line)) {
+    return false;
+  }
+  fields.clear();
+  CsvField field;
+  bool quoted = false, in_quotes = false;
+  size_t pos = 0;
+  while (true) {
+    if (pos == line.size() || (!in_quotes && pos + 1 == line.size() &&
+                               line[pos] == '\r')) {
+      if (!in_quotes || !std::getline(in, line)) {
+        break;
+      }
+      field.value.push_back('\n');
+      pos = 0;
+      continue;
+    }
+    char c = line[pos++];
+    if (in_quotes) {
+      if (c != '"') {
+        field.value.push_back(c);
+      } else if (pos < line.size() && line[pos] == '"') {
+        field.value.push_back('"');
+        pos++;
+      } else {
+        in_quotes = false;
+      }
+    } else if (c == '"') {
+      in_quotes = quoted = true;
+    } else if (c == ',') {
+      field.null = !quoted && field.value.empty();
+      fields.push_back(std::move(field));
+      field = CsvField();
+      quoted = false;
+    } else {
+      field.value.push_back(c);
+    }
+  }
+  field.null = !quoted && field.value.empty();
+  fields.push_back(std::move(field));
+  return true;
+}
+
+// oids are typed as in the binlog, where integer columns are numbers
+json to_oid(std::string&& value) {
+  int64_t oid;
+  auto res = std::from_chars(value.data(), value.data() + value.size(), oid);
+  if (res.ec == std::errc() && res.ptr == value.data() + value.size()) {
+    return json(oid);
+  }
+  return json(std::move(value));
+}
+
+// UnifiedLogs of each fragment appended to a file
+class FileProducer : public LogProducer {
+ public:
+  FileProducer(const std::string& dir, int num_partitions) {
+    for (int fid = 0; fid < num_partitions; fid++) {
+      std::string path = dir + "/" + gart::BulkLoadFileName(fid);
+      files_.emplace_back(path, std::ios::binary | std::ios::trunc);
+      if (!files_.back()) {
+        LOG(ERROR) << "Open " << path << " failed.";
+        exit(1);
+      }
+    }
+  }
+
+  void AddMessage(const std::string& message, int32_t partition) override {
+    files_[partition].write(message.data(), message.size());
+  }
+
+  void AddMessage(char* data, size_t len, int32_t partition) override {
+    files_[partition].write(data, len);
+    free(data);
+  }
+
+  bool Close() {
+    bool ok = true;
+    for (auto& file : files_) {
+      file.close();
+      ok = ok && !file.fail();
+    }
+    return ok;
+  }
+
+ private:
+  std::vector<std::ofstream> files_;
+};
+
+// number of rows converted, or -1 if the file cannot be read
+int64_t load_table(const std::string& path, int table,
+                   TxnLogConverter& converter, LogEmitter& emitter) {
+  std::ifstream in(path);
+  std::vector<CsvField> header, fields;
+  if (!in.is_open() || !read_csv_row(in, header)) {
+    return -1;
+  }
+  const TableMapping& mapping = converter.table(table);
+  std::vector<bool> is_oid;
+  for (auto& column : header) {
+    is_oid.push_back(column.value == mapping.id_column ||
+                     column.value == mapping.src_column ||
+                     column.value == mapping.dst_column);
+  }
+
+  int64_t num_rows = 0;
+  std::vector<json> rows;
+  while (read_csv_row(in, fields)) {
+    if (fields.size() != header.size()) {
+      LOG(ERROR) << path << ": row " << num_rows + 1 << " has "
+                 << fields.size() << " fields, expect " << header.size();
+      continue;
+    }
+    json row = json::object();
+    for (size_t idx = 0; idx < fields.size(); idx++) {
+      if (fields[idx].null) {
+        continue;
+      }
+      std::string& value = fields[idx].value;
+      row[header[idx].value] =
+          is_oid[idx] ? to_oid(std::move(value)) : json(std::move(value));
+    }
+    rows.push_back(std::move(row));
+    num_rows++;
+    if (rows.size() == kBulkLoadBatchRows) {
+      emitter.Push(converter.ConvertRows(table, std::move(rows)));
+      rows.clear();
+    }
+  }
+  if (!rows.empty()) {
+    emitter.Push(converter.ConvertRows(table, std::move(rows)));
+  }
+  return num_rows;
+}
+}  // namespace
+
+bool BulkLoad(const std::string& dir, TxnLogConverter& converter,
+              int num_subgraphs, size_t max_message_bytes) {
+  auto start = std::chrono::steady_clock::now();
+  auto producer = std::make_shared<FileProducer>(dir, num_subgraphs);
+  {
+    LogEmitter emitter(&converter, producer, num_subgraphs, true, 2,
+                       max_message_bytes);
+    // the gids of endpoints are known once their vertex tables are loaded
+    for (bool edges : {false, true}) {
+      for (int table = 0; table < converter.num_tables(); table++) {
+        const TableMapping& mapping = converter.table(table);
+        if (mapping.is_edge != edges) {
+          continue;
+        }
+        std::string path = dir + "/" + mapping.name + ".csv";
+        if (!std::filesystem::exists(path)) {
+          LOG(WARNING) << "No dump of table " << mapping.name << " (" << path
+                       << "), skipped.";
+          continue;
+        }
+        int64_t num_rows = load_table(path, table, converter, emitter);
+        if (num_rows < 0) {
+          LOG(ERROR) << "Read " << path << " failed.";
+          return false;
+        }
+        LOG(INFO) << "Bulk loaded " << num_rows << " rows of table "
+                  << mapping.name;
+      }
+    }
+  }  // drain the emitter
+  converter.NextEpoch();
+  if (!producer->Close()) {
+    LOG(ERROR) << "Write UnifiedLogs to " << dir << " failed.";
+    return false;
+  }
+
+  size_t num_pending, bytes;
+  uint64_t num_dangling;
+  converter.GetPendingEdgeStats(num_pending, bytes, num_dangling);
+  LOG(INFO) << "Bulk load took "
+            << std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::steady_clock::now() - start)
+                   .count()
+            << " s, " << num_pending << " edges wait for their endpoints";
+  return true;
+}
@@ -0,0 +1,38 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_BULK_LOAD_H_
+#define CONVERTER_BULK_LOAD_H_
+
+#include <string>
+
+#include "txn_log_converter.h"  // NOLINT(build/include_subdir)
+
+/**
+ * Converts a dump of the source database into UnifiedLogs, without Maxwell
+ * and Kafka. `dir` holds a CSV file of each mapped table, <table>.csv, with
+ * the column names in its first line; an unquoted empty field is null.
+ * Vertex tables go before edge tables, and vertices get their gids from
+ * `converter` as inserts do, so the binlog continues from the dump.
+ *
+ * Binary UnifiedLogs of each fragment are written to the file named by
+ * gart::BulkLoadFileName() in `dir`, for the writers to build their
+ * fragments from (see --bulk_load_dir of vegito). They are all in the
+ * current epoch of the converter, which is ended afterwards.
+ */
+bool BulkLoad(const std::string& dir, TxnLogConverter& converter,
+              int num_subgraphs, size_t max_message_bytes);
+
+#endif  // CONVERTER_BULK_LOAD_H_
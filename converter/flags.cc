@@ -24,10 +24,69 @@ DEFINE_string(write_kafka_broker_list, "localhost:9092",
 DEFINE_string(read_kafka_topic, "binlog", "Kafka topic for reading TxnLogs.");
 DEFINE_string(write_kafka_topic, "unified_log",
               "Kafka topic for writing UnifiedLogs.");
+DEFINE_int32(kafka_fetch_batch_size, 512,
+             "Max number of TxnLogs fetched from Kafka in a batch.");
+DEFINE_int32(kafka_prefetch_depth, 65536,
+             "Max number of TxnLogs prefetched from Kafka.");
+DEFINE_int64(read_kafka_start_offset, -1,
+             "Offset of the first TxnLog to read, e.g., the binlog position "
+             "of a bulk loaded dump. -1 for the beginning of the topic.");
 
-DEFINE_int32(logs_per_epoch, 10000, "logs_per_epoch.");
+DEFINE_int32(logs_per_epoch, 10000,
+             "Number of logs after which an epoch ends, at the next "
+             "transaction boundary.");
+DEFINE_int32(max_logs_per_epoch, 100000,
+             "Max number of logs of an epoch, even inside a transaction. "
+             "0 for no limit.");
+DEFINE_int32(max_epoch_duration_ms, 1000,
+             "Max duration of an epoch in milliseconds, it ends at the next "
+             "transaction boundary, or when no log comes. 0 for no limit.");
 
 DEFINE_string(rg_mapping_file_path, "schema/rgmapping-ldbc.json",
               "RGMapping file path.");
 
-DEFINE_int32(numbers_of_subgraphs, 1, "Number of subgraphs for GAP workloads.");
\ No newline at end of file
+DEFINE_int32(numbers_of_subgraphs, 1, "Number of subgraphs for GAP workloads.");
+
+DEFINE_string(unified_log_format, "binary",
+              "Encoding of UnifiedLogs: binary (default) or text.");
+DEFINE_int32(max_message_bytes, 262144,
+             "Max bytes of binary UnifiedLogs batched into one Kafka message, "
+             "0 to send one log per message.");
+DEFINE_string(kafka_compression_codec, "lz4",
+              "Compression codec of the UnifiedLog topic: none, gzip, snappy, "
+              "lz4 or zstd.");
+DEFINE_string(unified_log_shm_name, "",
+              "Write UnifiedLogs to shared memory rings named "
+              "/<name>_<fid> instead of Kafka, for writers on the same host.");
+DEFINE_int32(unified_log_shm_size_mb, 256,
+             "Size of each shared memory ring in MB, if it is created.");
+
+DEFINE_int32(num_convert_threads, 4,
+             "Number of threads to convert TxnLogs, including the main one.");
+
+DEFINE_string(oid_index_dir, "",
+              "Directory of the oid indexes, which are reopened on restart. "
+              "Kept in memory if empty.");
+
+DEFINE_string(vertex_partitioner, "round_robin",
+              "How new vertices are placed in fragments: round_robin "
+              "(default), hash or range of the oid, or ldg, which follows "
+              "the edges of the vertex seen in the same batch.");
+DEFINE_string(partition_range_bounds, "",
+              "Comma-separated integer oids where the fragments of the range "
+              "partitioner start, from fragment 1.");
+
+DEFINE_int32(max_pending_edge_mb, 256,
+             "Max memory in MB of edges waiting for their endpoint vertices, "
+             "the oldest ones are dropped beyond it. 0 for no limit.");
+DEFINE_int32(pending_edge_timeout_ms, 600000,
+             "Max time in milliseconds an edge waits for its endpoint "
+             "vertices before it is dropped. 0 for no limit.");
+
+DEFINE_int32(stats_report_interval, 60,
+             "Interval in seconds to log the size of the oid indexes and the "
+             "edge-cut ratio, 0 to disable.");
+
+DEFINE_string(bulk_load_dir, "",
+              "Directory of CSV dumps of the tables to convert before the "
+              "binlog, see bulk_load.h. Empty for no bulk load.");
@@ -22,11 +22,36 @@ DECLARE_string(read_kafka_broker_list);
 DECLARE_string(write_kafka_broker_list);
 DECLARE_string(read_kafka_topic);
 DECLARE_string(write_kafka_topic);
+DECLARE_int32(kafka_fetch_batch_size);
+DECLARE_int32(kafka_prefetch_depth);
+DECLARE_int64(read_kafka_start_offset);
 
 DECLARE_int32(logs_per_epoch);
+DECLARE_int32(max_logs_per_epoch);
+DECLARE_int32(max_epoch_duration_ms);
 
 DECLARE_string(rg_mapping_file_path);
 
 DECLARE_int32(numbers_of_subgraphs);
 
+DECLARE_string(unified_log_format);
+DECLARE_int32(max_message_bytes);
+DECLARE_string(kafka_compression_codec);
+DECLARE_string(unified_log_shm_name);
+DECLARE_int32(unified_log_shm_size_mb);
+
+DECLARE_int32(num_convert_threads);
+
+DECLARE_string(oid_index_dir);
+
+DECLARE_string(vertex_partitioner);
+DECLARE_string(partition_range_bounds);
+
+DECLARE_int32(max_pending_edge_mb);
+DECLARE_int32(pending_edge_timeout_ms);
+
+DECLARE_int32(stats_report_interval);
+
+DECLARE_string(bulk_load_dir);
+
 #endif  // CONVERTER_FLAGS_H_
@@ -16,23 +16,28 @@
 #ifndef CONVERTER_PRODUCER_H_
 #define CONVERTER_PRODUCER_H_
 
-#include <iostream>
+#include <atomic>
+#include <cstdlib>
 #include <memory>
+#include <string>
 
 #include "glog/logging.h"
 #include "librdkafka/rdkafkacpp.h"
 
+#include "log_producer.h"  // NOLINT(build/include_subdir)
+
 /** Kafka producer class
  *
  * A kafka producer class based on librdkafka, can be used to produce
- * stream data to one topic.
+ * stream data to one topic. Delivery is reported through callbacks, which
+ * are served as messages are produced; when the internal queue is full,
+ * the producer waits for deliveries instead of flushing everything.
  */
-class KafkaProducer {
+class KafkaProducer : public LogProducer {
  public:
-  KafkaProducer() = default;
-
   explicit KafkaProducer(const std::string& broker_list,
-                         const std::string& topic)
+                         const std::string& topic,
+                         const std::string& compression_codec = "none")
       : brokers_(broker_list), topic_(topic) {
     RdKafka::Conf* conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
     std::string rdkafka_err;
@@ -40,10 +45,6 @@ class KafkaProducer {
         RdKafka::Conf::CONF_OK) {
       LOG(ERROR) << "Failed to set metadata.broker.list: " << rdkafka_err;
     }
-    if (conf->set("metadata.broker.list", broker_list, rdkafka_err) !=
-        RdKafka::Conf::CONF_OK) {
-      std::cout << "Failed to set metadata.broker.list: " << rdkafka_err;
-    }
     // for producer's internal queue.
     if (conf->set("queue.buffering.max.messages",
                   std::to_string(internal_buffer_size_),
@@ -51,6 +52,14 @@ class KafkaProducer {
       LOG(ERROR) << "Failed to set queue.buffering.max.messages: "
                  << rdkafka_err;
     }
+    if (conf->set("compression.codec", compression_codec, rdkafka_err) !=
+        RdKafka::Conf::CONF_OK) {
+      LOG(ERROR) << "Failed to set compression.codec: " << rdkafka_err;
+    }
+    if (conf->set("dr_cb", &delivery_report_, rdkafka_err) !=
+        RdKafka::Conf::CONF_OK) {
+      LOG(ERROR) << "Failed to set dr_cb: " << rdkafka_err;
+    }
 
     producer_ = std::unique_ptr<RdKafka::Producer>(
         RdKafka::Producer::create(conf, rdkafka_err));
@@ -60,65 +69,101 @@ class KafkaProducer {
     delete conf;  // release the memory resource
   }
 
-  ~KafkaProducer() = default;
+  ~KafkaProducer() {
+    if (producer_) {
+      producer_->flush(1000 * 60);  // 60s
+    }
+  }
 
-  void AddMessage(const std::string& message) {
+  void AddMessage(const std::string& message, int32_t partition) override {
     if (message.empty()) {
       return;
     }
-    RdKafka::ErrorCode err = producer_->produce(
-        topic_, RdKafka::Topic::PARTITION_UA, RdKafka::Producer::RK_MSG_COPY,
-        static_cast<void*>(const_cast<char*>(message.c_str())) /* value */,
-        message.size() /* size */, NULL, 0, 0 /* timestamp */,
-        NULL /* delivery report */);
-    if (err != RdKafka::ERR_NO_ERROR) {
-      LOG(ERROR) << "Failed to output to kafka: " << RdKafka::err2str(err);
-    }
-    pending_count_ += 1;
-    if (pending_count_ == 1024 * 128) {
-      producer_->flush(1000 * 60);  // 60s
-      pending_count_ = 0;
-    }
+    produce_(const_cast<char*>(message.data()), message.size(), partition,
+             RdKafka::Producer::RK_MSG_COPY);
   }
 
-  inline std::string topic() { return topic_; }
-
- private:
-  static const constexpr int internal_buffer_size_ = 1024 * 1024;
-
-  size_t pending_count_ = 0;
-  std::string brokers_;
-  std::string topic_;
-  std::unique_ptr<RdKafka::Producer> producer_;
-};
+  // librdkafka frees the buffer once delivered
+  void AddMessage(char* data, size_t len, int32_t partition) override {
+    produce_(data, len, partition, RdKafka::Producer::RK_MSG_FREE);
+  }
 
-/**
- * A kafka output stream that can be used to flush messages into kafka prodcuer.
- */
-class KafkaOutputStream : public std::ostream {
- public:
-  explicit KafkaOutputStream(std::shared_ptr<KafkaProducer> producer)
-      : std::ostream(new KafkaBuffer(producer)) {}
+  inline std::string topic() { return topic_; }
 
-  ~KafkaOutputStream() { delete rdbuf(); }
+  uint64_t num_delivered() const { return delivery_report_.num_delivered; }
+  uint64_t num_failed() const { return delivery_report_.num_failed; }
 
-  void close() {}
+  // number of partitions of the topic, -1 if the metadata is unavailable
+  int GetPartitionCount() {
+    std::string rdkafka_err;
+    std::unique_ptr<RdKafka::Topic> topic(RdKafka::Topic::create(
+        producer_.get(), topic_, nullptr, rdkafka_err));
+    if (!topic) {
+      LOG(ERROR) << "Failed to create topic " << topic_ << ": " << rdkafka_err;
+      return -1;
+    }
+    RdKafka::Metadata* metadata = nullptr;
+    RdKafka::ErrorCode err =
+        producer_->metadata(false, topic.get(), &metadata, 5000);
+    if (err != RdKafka::ERR_NO_ERROR) {
+      LOG(ERROR) << "Failed to get metadata of topic " << topic_ << ": "
+                 << RdKafka::err2str(err);
+      return -1;
+    }
+    int count = -1;
+    for (const RdKafka::TopicMetadata* topic_meta : *metadata->topics()) {
+      if (topic_meta->topic() == topic_) {
+        count = static_cast<int>(topic_meta->partitions()->size());
+      }
+    }
+    delete metadata;
+    return count;
+  }
 
  private:
-  class KafkaBuffer : public std::stringbuf {
+  class DeliveryReport : public RdKafka::DeliveryReportCb {
    public:
-    explicit KafkaBuffer(std::shared_ptr<KafkaProducer>& prodcuer)
-        : producer_(prodcuer) {}
-
-    int sync() override {
-      producer_->AddMessage(this->str());
-      this->str("");
-      return 0;
+    void dr_cb(RdKafka::Message& message) override {
+      if (message.err() == RdKafka::ERR_NO_ERROR) {
+        num_delivered.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        num_failed.fetch_add(1, std::memory_order_relaxed);
+        LOG(ERROR) << "Failed to deliver to kafka: " << message.errstr();
+      }
     }
 
-   private:
-    std::shared_ptr<KafkaProducer> producer_;
+    std::atomic<uint64_t> num_delivered{0};
+    std::atomic<uint64_t> num_failed{0};
   };
+
+  void produce_(char* data, size_t len, int32_t partition, int msgflags) {
+    RdKafka::ErrorCode err;
+    while (true) {
+      err = producer_->produce(topic_, partition, msgflags,
+                               static_cast<void*>(data) /* value */,
+                               len /* size */, NULL, 0, 0 /* timestamp */,
+                               NULL /* delivery report */);
+      if (err != RdKafka::ERR__QUEUE_FULL) {
+        break;
+      }
+      // wait for deliveries to make room in the queue
+      producer_->poll(100);
+    }
+    if (err != RdKafka::ERR_NO_ERROR) {
+      LOG(ERROR) << "Failed to output to kafka: " << RdKafka::err2str(err);
+      if (msgflags & RdKafka::Producer::RK_MSG_FREE) {
+        free(data);  // not taken by librdkafka on failure
+      }
+    }
+    producer_->poll(0);
+  }
+
+  static const constexpr int internal_buffer_size_ = 1024 * 1024;
+
+  std::string brokers_;
+  std::string topic_;
+  DeliveryReport delivery_report_;
+  std::unique_ptr<RdKafka::Producer> producer_;
 };
 
 #endif  // CONVERTER_PRODUCER_H_
@@ -0,0 +1,81 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_LOG_PRODUCER_H_
+#define CONVERTER_LOG_PRODUCER_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/**
+ * Where UnifiedLogs go, one partition per fragment: Kafka by default, or
+ * shared memory rings when the writers run on the same host.
+ */
+class LogProducer {
+ public:
+  virtual ~LogProducer() = default;
+
+  // the message is copied
+  virtual void AddMessage(const std::string& message, int32_t partition) = 0;
+
+  // takes a buffer from malloc()
+  virtual void AddMessage(char* data, size_t len, int32_t partition) = 0;
+};
+
+/**
+ * Records batched into one message. The buffer is handed over to the
+ * producer when sent, so Kafka does not copy the records again.
+ */
+class LogMessageBuffer {
+ public:
+  LogMessageBuffer() = default;
+  LogMessageBuffer(const LogMessageBuffer&) = delete;
+  LogMessageBuffer& operator=(const LogMessageBuffer&) = delete;
+
+  ~LogMessageBuffer() { free(data_); }
+
+  void Append(std::string_view record) {
+    if (size_ + record.size() > capacity_) {
+      capacity_ = std::max(size_ + record.size(), capacity_ * 2);
+      data_ = static_cast<char*>(realloc(data_, capacity_));
+    }
+    memcpy(data_ + size_, record.data(), record.size());
+    size_ += record.size();
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  void Send(LogProducer& producer, int32_t partition) {
+    if (size_ == 0) {
+      return;
+    }
+    producer.AddMessage(data_, size_, partition);
+    data_ = nullptr;
+    size_ = 0;
+    capacity_ = 0;
+  }
+
+ private:
+  char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+#endif  // CONVERTER_LOG_PRODUCER_H_
@@ -0,0 +1,419 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "maxwell_parser.h"  // NOLINT(build/include_subdir)
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using json = vineyard::json;
+
+namespace {
+// the first quote or backslash from `cur`, or `end`
+const char* find_quote_or_escape(const char* cur, const char* end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i escape = _mm_set1_epi8('\\');
+  for (; cur + 16 <= end; cur += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                              _mm_cmpeq_epi8(chunk, escape)));
+    if (mask != 0) {
+      return cur + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (cur < end && *cur != '"' && *cur != '\\') {
+    cur++;
+  }
+  return cur;
+}
+
+// the first quote or bracket from `cur`, or `end`
+const char* find_structural(const char* cur, const char* end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i open_square = _mm_set1_epi8('[');
+  const __m128i close_square = _mm_set1_epi8(']');
+  const __m128i open_curly = _mm_set1_epi8('{');
+  const __m128i close_curly = _mm_set1_epi8('}');
+  for (; cur + 16 <= end; cur += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cur));
+    __m128i hits = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                     _mm_cmpeq_epi8(chunk, open_square)),
+        _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, close_square),
+                         _mm_cmpeq_epi8(chunk, open_curly)),
+            _mm_cmpeq_epi8(chunk, close_curly)));
+    int mask = _mm_movemask_epi8(hits);
+    if (mask != 0) {
+      return cur + __builtin_ctz(mask);
+    }
+  }
+#endif
+  while (cur < end && *cur != '"' && *cur != '[' && *cur != ']' &&
+         *cur != '{' && *cur != '}') {
+    cur++;
+  }
+  return cur;
+}
+
+void append_utf8(std::string& out, uint32_t code) {
+  if (code < 0x80) {
+    out.push_back(static_cast<char>(code));
+  } else if (code < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else if (code < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+  }
+}
+
+bool parse_hex4(std::string_view s, size_t pos, uint32_t& code) {
+  if (pos + 4 > s.size()) {
+    return false;
+  }
+  auto res = std::from_chars(s.data() + pos, s.data() + pos + 4, code, 16);
+  return res.ptr == s.data() + pos + 4;
+}
+
+// the content of a string with escapes, without its quotes
+bool unescape(std::string_view raw, std::string& out) {
+  out.clear();
+  for (size_t pos = 0; pos < raw.size(); pos++) {
+    if (raw[pos] != '\\') {
+      out.push_back(raw[pos]);
+      continue;
+    }
+    if (++pos == raw.size()) {
+      return false;
+    }
+    switch (raw[pos]) {
+    case '"':
+    case '\\':
+    case '/':
+      out.push_back(raw[pos]);
+      break;
+    case 'b':
+      out.push_back('\b');
+      break;
+    case 'f':
+      out.push_back('\f');
+      break;
+    case 'n':
+      out.push_back('\n');
+      break;
+    case 'r':
+      out.push_back('\r');
+      break;
+    case 't':
+      out.push_back('\t');
+      break;
+    case 'u': {
+      uint32_t code, low;
+      if (!parse_hex4(raw, pos + 1, code)) {
+        return false;
+      }
+      pos += 4;
+      // a surrogate pair
+      if (code >= 0xD800 && code < 0xDC00 && pos + 2 < raw.size() &&
+          raw[pos + 1] == '\\' && raw[pos + 2] == 'u' &&
+          parse_hex4(raw, pos + 3, low) && low >= 0xDC00 && low < 0xE000) {
+        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        pos += 6;
+      }
+      append_utf8(out, code);
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+// a cursor over a JSON text, skipping what it does not need
+class JsonScanner {
+ public:
+  explicit JsonScanner(std::string_view text)
+      : cur_(text.data()), end_(text.data() + text.size()) {}
+
+  bool consume(char c) {
+    skip_whitespace();
+    if (cur_ < end_ && *cur_ == c) {
+      cur_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool peek(char c) {
+    skip_whitespace();
+    return cur_ < end_ && *cur_ == c;
+  }
+
+  // the content of a string without its quotes, and if it has escapes
+  bool scan_string(std::string_view& raw, bool& escaped) {
+    if (!consume('"')) {
+      return false;
+    }
+    const char* begin = cur_;
+    escaped = false;
+    while (true) {
+      cur_ = find_quote_or_escape(cur_, end_);
+      if (cur_ >= end_) {
+        return false;
+      }
+      if (*cur_ == '"') {
+        break;
+      }
+      escaped = true;
+      cur_ += 2;
+    }
+    raw = std::string_view(begin, cur_ - begin);
+    cur_++;
+    return true;
+  }
+
+  // the text of any value
+  bool scan_value(std::string_view& raw) {
+    skip_whitespace();
+    const char* begin = cur_;
+    if (cur_ == end_) {
+      return false;
+    }
+    bool escaped;
+    std::string_view str;
+    if (*cur_ == '"') {
+      if (!scan_string(str, escaped)) {
+        return false;
+      }
+    } else if (*cur_ == '{' || *cur_ == '[') {
+      if (!skip_nested_()) {
+        return false;
+      }
+    } else {
+      while (cur_ < end_ && *cur_ != ',' && *cur_ != '}' && *cur_ != ']' &&
+             !is_whitespace_(*cur_)) {
+        cur_++;
+      }
+      if (cur_ == begin) {
+        return false;
+      }
+    }
+    raw = std::string_view(begin, cur_ - begin);
+    return true;
+  }
+
+  /**
+   * Calls fn(key, escaped, scanner) for each field of an object; fn must
+   * scan the value. Returns false if the object is malformed.
+   */
+  template <typename Fn>
+  bool for_each_field(Fn fn) {
+    if (!consume('{')) {
+      return false;
+    }
+    if (consume('}')) {
+      return true;
+    }
+    do {
+      std::string_view key;
+      bool escaped;
+      if (!scan_string(key, escaped) || !consume(':') ||
+          !fn(key, escaped, *this)) {
+        return false;
+      }
+    } while (consume(','));
+    return consume('}');
+  }
+
+ private:
+  static bool is_whitespace_(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+  }
+
+  void skip_whitespace() {
+    while (cur_ < end_ && is_whitespace_(*cur_)) {
+      cur_++;
+    }
+  }
+
+  // an object or array, strings inside may hold brackets
+  bool skip_nested_() {
+    int depth = 0;
+    while (true) {
+      cur_ = find_structural(cur_, end_);
+      if (cur_ == end_) {
+        return false;
+      }
+      if (*cur_ == '"') {
+        std::string_view str;
+        bool escaped;
+        if (!scan_string(str, escaped)) {
+          return false;
+        }
+        continue;
+      }
+      depth += (*cur_ == '{' || *cur_ == '[') ? 1 : -1;
+      cur_++;
+      if (depth == 0) {
+        return true;
+      }
+    }
+  }
+
+  const char* cur_;
+  const char* end_;
+};
+
+// a string field, unescaped into `buffer` if needed
+bool scan_string_field(JsonScanner& scanner, std::string_view& value,
+                       std::string& buffer) {
+  bool escaped;
+  if (!scanner.peek('"')) {
+    std::string_view raw;
+    return scanner.scan_value(raw);  // e.g., null, left empty
+  }
+  if (!scanner.scan_string(value, escaped)) {
+    return false;
+  }
+  if (escaped) {
+    if (!unescape(value, buffer)) {
+      return false;
+    }
+    value = buffer;
+  }
+  return true;
+}
+
+bool parse_number(std::string_view raw, json& out) {
+  const char* end = raw.data() + raw.size();
+  if (raw.find_first_of(".eE") == std::string_view::npos) {
+    int64_t i;
+    auto res = std::from_chars(raw.data(), end, i);
+    if (res.ec == std::errc() && res.ptr == end) {
+      out = i;
+      return true;
+    }
+    uint64_t u;
+    res = std::from_chars(raw.data(), end, u);
+    if (res.ec == std::errc() && res.ptr == end) {
+      out = u;
+      return true;
+    }
+  }
+  double d;
+  auto res = std::from_chars(raw.data(), end, d);
+  if (res.ec != std::errc() || res.ptr != end) {
+    return false;
+  }
+  out = d;
+  return true;
+}
+
+// a scalar as nlohmann would parse it; nested values are rare, and parsed
+bool parse_value(std::string_view raw, json& out) {
+  if (raw[0] == '"') {
+    std::string_view str = raw.substr(1, raw.size() - 2);
+    if (str.find('\\') == std::string_view::npos) {
+      out = std::string(str);
+      return true;
+    }
+    std::string buffer;
+    if (!unescape(str, buffer)) {
+      return false;
+    }
+    out = std::move(buffer);
+    return true;
+  } else if (raw == "null") {
+    out = nullptr;
+  } else if (raw == "true") {
+    out = true;
+  } else if (raw == "false") {
+    out = false;
+  } else if (raw[0] == '{' || raw[0] == '[') {
+    out = json::parse(raw.begin(), raw.end(), nullptr, false);
+    return !out.is_discarded();
+  } else {
+    return parse_number(raw, out);
+  }
+  return true;
+}
+}  // namespace
+
+bool ParseMaxwellMessage(std::string_view msg, MaxwellMessage& out) {
+  JsonScanner scanner(msg);
+  return scanner.for_each_field([&out](std::string_view key, bool /* escaped */,
+                                       JsonScanner& scanner) {
+    std::string_view raw;
+    if (key == "type") {
+      return scan_string_field(scanner, out.type, out.type_buffer);
+    } else if (key == "table") {
+      return scan_string_field(scanner, out.table, out.table_buffer);
+    } else if (!scanner.scan_value(raw)) {
+      return false;
+    }
+    if (key == "xid") {
+      out.has_xid = true;
+    } else if (key == "commit") {
+      out.commit = raw == "true";
+    } else if (key == "data") {
+      out.data = raw;
+    } else if (key == "old") {
+      out.old = raw;
+    }
+    return true;
+  });
+}
+
+bool ExtractColumns(std::string_view obj,
+                    const std::vector<std::string>& columns, json& out) {
+  out = json::object();
+  JsonScanner scanner(obj);
+  std::string key_buffer;
+  return scanner.for_each_field([&](std::string_view key, bool escaped,
+                                    JsonScanner& scanner) {
+    std::string_view raw;
+    if (!scanner.scan_value(raw)) {
+      return false;
+    }
+    if (escaped) {
+      if (!unescape(key, key_buffer)) {
+        return false;
+      }
+      key = key_buffer;
+    }
+    for (const std::string& column : columns) {
+      if (column == key) {
+        return parse_value(raw, out[column]);
+      }
+    }
+    return true;
+  });
+}
@@ -0,0 +1,54 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_MAXWELL_PARSER_H_
+#define CONVERTER_MAXWELL_PARSER_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vineyard/common/util/json.h"
+
+/**
+ * The top-level fields of a Maxwell message that the converter reads. Views
+ * point into the message, or into the buffers below if they had escapes.
+ */
+struct MaxwellMessage {
+  std::string_view type;
+  std::string_view table;
+  bool has_xid = false;
+  bool commit = false;
+  std::string_view data;  // text of the "data" object, empty if absent
+  std::string_view old;   // text of the "old" object, empty if absent
+
+  std::string type_buffer, table_buffer;
+};
+
+/**
+ * Maxwell messages are parsed in two steps, without a DOM of the whole
+ * message: ParseMaxwellMessage() scans the top level, and skips the values
+ * of other fields; ExtractColumns() then picks the columns a table mapping
+ * needs out of "data" or "old". Strings are scanned with SSE2 where it is
+ * available, 16 bytes at a time.
+ */
+bool ParseMaxwellMessage(std::string_view msg, MaxwellMessage& out);
+
+// `out` becomes an object of the `columns` present in the JSON object `obj`
+bool ExtractColumns(std::string_view obj,
+                    const std::vector<std::string>& columns,
+                    vineyard::json& out);
+
+#endif  // CONVERTER_MAXWELL_PARSER_H_
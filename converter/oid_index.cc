@@ -0,0 +1,444 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oid_index.h"  // NOLINT(build/include_subdir)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace {
+constexpr uint64_t kTableMagic = 0x4741525449445831;  // "GARTIDX1"
+constexpr uint64_t kArenaMagic = 0x4741525441524e31;  // "GARTARN1"
+constexpr uint64_t kInitCapacity = 1024;
+constexpr size_t kInitArenaSize = 1ul << 20;
+
+// keep the live and erased slots below 70% of the capacity
+inline bool overloaded(uint64_t used, uint64_t capacity) {
+  return (used + 1) * 10 > capacity * 7;
+}
+
+inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+inline uint64_t slot_hash(int64_t key) {
+  return mix64(static_cast<uint64_t>(key));
+}
+
+// stable across processes, since hashes are persisted with the index
+inline uint64_t hash_string(std::string_view s) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (unsigned char c : s) {
+    h = (h ^ c) * 0x100000001b3ULL;
+  }
+  return mix64(h);
+}
+}  // namespace
+
+bool MappedBuffer::Open(const std::string& path, size_t min_size) {
+  Close();
+  path_ = path;
+  size_t size = min_size;
+  if (!path_.empty()) {
+    fd_ = open(path_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      LOG(ERROR) << "Open " << path_ << " failed: " << strerror(errno);
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      LOG(ERROR) << "Stat " << path_ << " failed: " << strerror(errno);
+      return false;
+    }
+    if (static_cast<size_t>(st.st_size) > size) {
+      size = st.st_size;
+    } else if (ftruncate(fd_, size) != 0) {
+      LOG(ERROR) << "Truncate " << path_ << " failed: " << strerror(errno);
+      return false;
+    }
+  }
+
+  void* data = fd_ >= 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                               MAP_SHARED, fd_, 0)
+                        : mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Map " << size << " bytes failed: " << strerror(errno);
+    return false;
+  }
+  data_ = static_cast<char*>(data);
+  size_ = size;
+  return true;
+}
+
+bool MappedBuffer::Resize(size_t size) {
+  if (size <= size_) {
+    return true;
+  }
+  if (fd_ >= 0 && ftruncate(fd_, size) != 0) {
+    LOG(ERROR) << "Truncate " << path_ << " failed: " << strerror(errno);
+    return false;
+  }
+  void* data = mremap(data_, size_, size, MREMAP_MAYMOVE);
+  if (data == MAP_FAILED) {
+    LOG(ERROR) << "Remap " << size << " bytes failed: " << strerror(errno);
+    return false;
+  }
+  data_ = static_cast<char*>(data);
+  size_ = size;
+  return true;
+}
+
+bool MappedBuffer::Rename(const std::string& path) {
+  if (fd_ < 0) {
+    return true;
+  }
+  if (std::rename(path_.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Rename " << path_ << " to " << path
+               << " failed: " << strerror(errno);
+    return false;
+  }
+  path_ = path;
+  return true;
+}
+
+void MappedBuffer::Swap(MappedBuffer& other) {
+  std::swap(path_, other.path_);
+  std::swap(fd_, other.fd_);
+  std::swap(data_, other.data_);
+  std::swap(size_, other.size_);
+}
+
+void MappedBuffer::Sync() {
+  if (fd_ >= 0 && data_) {
+    msync(data_, size_, MS_SYNC);
+  }
+}
+
+void MappedBuffer::Close() {
+  if (data_) {
+    munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+bool OidIndex::Open(const std::string& dir, const std::string& name) {
+  if (!dir.empty()) {
+    int_path_ = dir + "/" + name + ".int";
+    string_path_ = dir + "/" + name + ".str";
+  }
+  if (!open_table_<IntSlot>(int_table_, int_path_) ||
+      !open_table_<StringSlot>(string_table_, string_path_)) {
+    return false;
+  }
+
+  std::string arena_path = dir.empty() ? "" : dir + "/" + name + ".arena";
+  if (!arena_.Open(arena_path, kInitArenaSize)) {
+    return false;
+  }
+  auto* header = reinterpret_cast<ArenaHeader*>(arena_.data());
+  if (header->magic != kArenaMagic) {
+    header->magic = kArenaMagic;
+    header->used = sizeof(ArenaHeader);
+  }
+  return true;
+}
+
+template <typename Slot>
+bool OidIndex::open_table_(MappedBuffer& table, const std::string& path) {
+  if (!table.Open(path, sizeof(TableHeader) + kInitCapacity * sizeof(Slot))) {
+    return false;
+  }
+  TableHeader* header = header_(table);
+  if (header->magic == kTableMagic) {
+    return true;
+  }
+  header->magic = kTableMagic;
+  header->capacity = kInitCapacity;
+  header->size = 0;
+  header->used = 0;
+  return true;
+}
+
+template <typename Slot>
+bool OidIndex::rehash_(MappedBuffer& table, const std::string& path,
+                       uint64_t capacity) {
+  MappedBuffer new_table;
+  std::string new_path = path.empty() ? "" : path + ".rehash";
+  if (!new_path.empty()) {
+    unlink(new_path.c_str());  // left by a crash
+  }
+  size_t bytes = sizeof(TableHeader) + capacity * sizeof(Slot);
+  if (!new_table.Open(new_path, bytes)) {
+    return false;
+  }
+
+  TableHeader* header = header_(table);
+  const Slot* slots = slots_<Slot>(table);
+  Slot* new_slots = slots_<Slot>(new_table);
+  uint64_t mask = capacity - 1;
+  for (uint64_t idx = 0; idx < header->capacity; idx++) {
+    const Slot& slot = slots[idx];
+    if (slot.value < kValueBias) {
+      continue;
+    }
+    uint64_t hash;
+    if constexpr (std::is_same_v<Slot, IntSlot>) {
+      hash = slot_hash(slot.key);
+    } else {
+      hash = slot.hash;
+    }
+    uint64_t pos = hash & mask;
+    while (new_slots[pos].value != kEmpty) {
+      pos = (pos + 1) & mask;
+    }
+    new_slots[pos] = slot;
+  }
+
+  TableHeader* new_header = header_(new_table);
+  new_header->capacity = capacity;
+  new_header->size = header->size;
+  new_header->used = header->size;
+  new_header->magic = kTableMagic;
+
+  // the old file is only replaced by a complete table
+  if (!path.empty()) {
+    new_table.Sync();
+    if (!new_table.Rename(path)) {
+      return false;
+    }
+  }
+  table.Swap(new_table);
+  return true;
+}
+
+template <typename Slot>
+bool OidIndex::reserve_(MappedBuffer& table, const std::string& path) {
+  TableHeader* header = header_(table);
+  if (!overloaded(header->used, header->capacity)) {
+    return true;
+  }
+  // erased slots are dropped, so the table may not need to grow
+  uint64_t capacity = header->capacity;
+  while (overloaded(header->size * 2, capacity)) {
+    capacity *= 2;
+  }
+  return rehash_<Slot>(table, path, capacity);
+}
+
+size_t OidIndex::probe_int_(int64_t oid, bool& found) const {
+  const TableHeader* header = header_(int_table_);
+  const IntSlot* slots = slots_<IntSlot>(int_table_);
+  uint64_t mask = header->capacity - 1;
+  uint64_t pos = slot_hash(oid) & mask;
+  size_t free_pos = header->capacity;
+  while (slots[pos].value != kEmpty) {
+    if (slots[pos].value == kErased) {
+      if (free_pos == header->capacity) {
+        free_pos = pos;
+      }
+    } else if (slots[pos].key == oid) {
+      found = true;
+      return pos;
+    }
+    pos = (pos + 1) & mask;
+  }
+  found = false;
+  return free_pos == header->capacity ? pos : free_pos;
+}
+
+size_t OidIndex::probe_string_(std::string_view oid, uint64_t hash,
+                               bool& found) const {
+  const TableHeader* header = header_(string_table_);
+  const StringSlot* slots = slots_<StringSlot>(string_table_);
+  uint64_t mask = header->capacity - 1;
+  uint64_t pos = hash & mask;
+  size_t free_pos = header->capacity;
+  while (slots[pos].value != kEmpty) {
+    if (slots[pos].value == kErased) {
+      if (free_pos == header->capacity) {
+        free_pos = pos;
+      }
+    } else if (slots[pos].hash == hash &&
+               arena_key_(slots[pos].key_offset) == oid) {
+      found = true;
+      return pos;
+    }
+    pos = (pos + 1) & mask;
+  }
+  found = false;
+  return free_pos == header->capacity ? pos : free_pos;
+}
+
+std::string_view OidIndex::arena_key_(uint64_t offset) const {
+  uint32_t len;
+  memcpy(&len, arena_.data() + offset, sizeof(len));
+  return std::string_view(arena_.data() + offset + sizeof(len), len);
+}
+
+uint64_t OidIndex::append_key_(std::string_view oid) {
+  auto* header = reinterpret_cast<ArenaHeader*>(arena_.data());
+  uint64_t offset = header->used;
+  size_t need = offset + sizeof(uint32_t) + oid.size();
+  if (need > arena_.size()) {
+    size_t size = arena_.size();
+    while (size < need) {
+      size *= 2;
+    }
+    if (!arena_.Resize(size)) {
+      LOG(ERROR) << "Grow the oid arena to " << size << " bytes failed.";
+      exit(1);
+    }
+    header = reinterpret_cast<ArenaHeader*>(arena_.data());
+  }
+  uint32_t len = static_cast<uint32_t>(oid.size());
+  memcpy(arena_.data() + offset, &len, sizeof(len));
+  memcpy(arena_.data() + offset + sizeof(len), oid.data(), oid.size());
+  header->used = need;
+  return offset;
+}
+
+bool OidIndex::Insert(int64_t oid, int64_t& gid) {
+  if (!reserve_<IntSlot>(int_table_, int_path_)) {
+    LOG(ERROR) << "Grow the oid index failed.";
+    exit(1);
+  }
+  bool found;
+  size_t pos = probe_int_(oid, found);
+  IntSlot& slot = slots_<IntSlot>(int_table_)[pos];
+  if (found) {
+    gid = slot.value - kValueBias;
+    return false;
+  }
+  TableHeader* header = header_(int_table_);
+  if (slot.value == kEmpty) {
+    header->used++;
+  }
+  header->size++;
+  slot.key = oid;
+  slot.value = gid + kValueBias;
+  return true;
+}
+
+bool OidIndex::Insert(std::string_view oid, int64_t& gid) {
+  if (!reserve_<StringSlot>(string_table_, string_path_)) {
+    LOG(ERROR) << "Grow the oid index failed.";
+    exit(1);
+  }
+  bool found;
+  uint64_t hash = hash_string(oid);
+  size_t pos = probe_string_(oid, hash, found);
+  StringSlot& slot = slots_<StringSlot>(string_table_)[pos];
+  if (found) {
+    gid = slot.value - kValueBias;
+    return false;
+  }
+  TableHeader* header = header_(string_table_);
+  if (slot.value == kEmpty) {
+    header->used++;
+  }
+  header->size++;
+  slot.hash = hash;
+  slot.key_offset = append_key_(oid);
+  slot.value = gid + kValueBias;
+  return true;
+}
+
+bool OidIndex::Find(int64_t oid, int64_t& gid) const {
+  bool found;
+  size_t pos = probe_int_(oid, found);
+  if (found) {
+    gid = slots_<IntSlot>(int_table_)[pos].value - kValueBias;
+  }
+  return found;
+}
+
+bool OidIndex::Find(std::string_view oid, int64_t& gid) const {
+  bool found;
+  size_t pos = probe_string_(oid, hash_string(oid), found);
+  if (found) {
+    gid = slots_<StringSlot>(string_table_)[pos].value - kValueBias;
+  }
+  return found;
+}
+
+bool OidIndex::Erase(int64_t oid) {
+  bool found;
+  size_t pos = probe_int_(oid, found);
+  if (found) {
+    slots_<IntSlot>(int_table_)[pos].value = kErased;
+    header_(int_table_)->size--;
+  }
+  return found;
+}
+
+bool OidIndex::Erase(std::string_view oid) {
+  bool found;
+  size_t pos = probe_string_(oid, hash_string(oid), found);
+  if (found) {
+    // the key stays in the arena, which is append-only
+    slots_<StringSlot>(string_table_)[pos].value = kErased;
+    header_(string_table_)->size--;
+  }
+  return found;
+}
+
+void OidIndex::ForEachGid(const std::function<void(int64_t gid)>& fn) const {
+  const IntSlot* int_slots = slots_<IntSlot>(int_table_);
+  for (uint64_t idx = 0; idx < header_(int_table_)->capacity; idx++) {
+    if (int_slots[idx].value >= kValueBias) {
+      fn(int_slots[idx].value - kValueBias);
+    }
+  }
+  const StringSlot* string_slots = slots_<StringSlot>(string_table_);
+  for (uint64_t idx = 0; idx < header_(string_table_)->capacity; idx++) {
+    if (string_slots[idx].value >= kValueBias) {
+      fn(string_slots[idx].value - kValueBias);
+    }
+  }
+}
+
+size_t OidIndex::size() const {
+  return header_(int_table_)->size + header_(string_table_)->size;
+}
+
+size_t OidIndex::MemoryUsage() const {
+  return int_table_.size() + string_table_.size() + arena_.size();
+}
+
+void OidIndex::Sync() {
+  int_table_.Sync();
+  string_table_.Sync();
+  arena_.Sync();
+}
@@ -0,0 +1,166 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_OID_INDEX_H_
+#define CONVERTER_OID_INDEX_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * A memory region, either anonymous or mapped from a file. File-backed
+ * buffers keep their contents across restarts, and may grow past RAM since
+ * the kernel pages them out.
+ */
+class MappedBuffer {
+ public:
+  MappedBuffer() = default;
+  MappedBuffer(const MappedBuffer&) = delete;
+  MappedBuffer& operator=(const MappedBuffer&) = delete;
+
+  ~MappedBuffer() { Close(); }
+
+  // anonymous if `path` is empty; an existing file keeps its contents
+  bool Open(const std::string& path, size_t min_size);
+
+  // new bytes are zeroed
+  bool Resize(size_t size);
+
+  // move the backing file, e.g., over an older version of it
+  bool Rename(const std::string& path);
+
+  void Swap(MappedBuffer& other);
+
+  void Sync();
+
+  void Close();
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  std::string path_;
+  int fd_ = -1;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+/**
+ * oid -> gid index of one vertex label, with open addressing (linear
+ * probing). Integer oids are stored inline in 16-byte slots; string oids
+ * are stored once in an append-only arena, and their slots keep the hash
+ * and the arena offset.
+ *
+ * With a directory, the tables and the arena are mapped from files named
+ * after `name`, and an existing index is reopened. Tables are rehashed into
+ * a new file which then replaces the old one, so a crash during growth
+ * leaves the previous version intact.
+ *
+ * Not thread-safe; gids must be non-negative.
+ */
+class OidIndex {
+ public:
+  OidIndex() = default;
+  OidIndex(const OidIndex&) = delete;
+  OidIndex& operator=(const OidIndex&) = delete;
+
+  // in memory if `dir` is empty
+  bool Open(const std::string& dir, const std::string& name);
+
+  // false if the oid exists, and `gid` is set to its gid
+  bool Insert(int64_t oid, int64_t& gid);
+  bool Insert(std::string_view oid, int64_t& gid);
+
+  bool Find(int64_t oid, int64_t& gid) const;
+  bool Find(std::string_view oid, int64_t& gid) const;
+
+  bool Erase(int64_t oid);
+  bool Erase(std::string_view oid);
+
+  void ForEachGid(const std::function<void(int64_t gid)>& fn) const;
+
+  size_t size() const;
+
+  // bytes of the tables and the arena, resident or not
+  size_t MemoryUsage() const;
+
+  void Sync();
+
+ private:
+  struct TableHeader {
+    uint64_t magic;
+    uint64_t capacity;  // number of slots, a power of 2
+    uint64_t size;      // number of live slots
+    uint64_t used;      // live and erased slots
+  };
+
+  // a zeroed slot is empty, so new pages need no initialization
+  struct IntSlot {
+    int64_t key;
+    uint64_t value;  // kEmpty, kErased or gid + kValueBias
+  };
+
+  struct StringSlot {
+    uint64_t hash;
+    uint64_t key_offset;  // in the arena
+    uint64_t value;
+  };
+
+  struct ArenaHeader {
+    uint64_t magic;
+    uint64_t used;  // bytes, including the header
+  };
+
+  static constexpr uint64_t kEmpty = 0;
+  static constexpr uint64_t kErased = 1;
+  static constexpr uint64_t kValueBias = 2;
+
+  template <typename Slot>
+  bool open_table_(MappedBuffer& table, const std::string& path);
+
+  template <typename Slot>
+  bool rehash_(MappedBuffer& table, const std::string& path,
+               uint64_t capacity);
+
+  static TableHeader* header_(const MappedBuffer& table) {
+    return reinterpret_cast<TableHeader*>(table.data());
+  }
+
+  template <typename Slot>
+  static Slot* slots_(const MappedBuffer& table) {
+    return reinterpret_cast<Slot*>(table.data() + sizeof(TableHeader));
+  }
+
+  // slot of the key, or the first free slot on its probe sequence
+  size_t probe_int_(int64_t oid, bool& found) const;
+  size_t probe_string_(std::string_view oid, uint64_t hash,
+                       bool& found) const;
+
+  // make room for one more slot
+  template <typename Slot>
+  bool reserve_(MappedBuffer& table, const std::string& path);
+
+  std::string_view arena_key_(uint64_t offset) const;
+  uint64_t append_key_(std::string_view oid);
+
+  std::string int_path_, string_path_;  // empty if in memory
+  MappedBuffer int_table_;
+  MappedBuffer string_table_;
+  MappedBuffer arena_;
+};
+
+#endif  // CONVERTER_OID_INDEX_H_
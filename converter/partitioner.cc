@@ -0,0 +1,149 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "partitioner.h"  // NOLINT(build/include_subdir)
+
+#include <algorithm>
+#include <sstream>
+#include <string_view>
+
+#include "glog/logging.h"
+
+using json = vineyard::json;
+
+namespace {
+// the balance slack of LDG, as in the paper
+constexpr double kLdgSlack = 0.1;
+
+inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+// stable across runs and builds, unlike std::hash
+uint64_t hash_oid(const json& oid) {
+  if (oid.is_number_integer()) {
+    return mix64(static_cast<uint64_t>(oid.get<int64_t>()));
+  }
+  uint64_t h = 14695981039346656037ULL;  // FNV-1a
+  if (oid.is_string()) {
+    for (char c : oid.get_ref<const std::string&>()) {
+      h = (h ^ static_cast<uint8_t>(c)) * 1099511628211ULL;
+    }
+  }
+  return mix64(h);
+}
+
+uint64_t sum(const std::vector<uint64_t>& sizes) {
+  uint64_t total = 0;
+  for (uint64_t size : sizes) {
+    total += size;
+  }
+  return total;
+}
+
+int32_t smallest(const std::vector<uint64_t>& sizes) {
+  return static_cast<int32_t>(std::min_element(sizes.begin(), sizes.end()) -
+                              sizes.begin());
+}
+}  // namespace
+
+int32_t RoundRobinPartitioner::Assign(
+    int vlabel, const json* oid, const std::vector<uint64_t>& label_sizes,
+    const std::vector<int32_t>& nbr_fids) const {
+  return static_cast<int32_t>(sum(label_sizes) % label_sizes.size());
+}
+
+int32_t HashPartitioner::Assign(int vlabel, const json* oid,
+                                const std::vector<uint64_t>& label_sizes,
+                                const std::vector<int32_t>& nbr_fids) const {
+  if (oid == nullptr) {
+    return smallest(label_sizes);
+  }
+  return static_cast<int32_t>(hash_oid(*oid) % label_sizes.size());
+}
+
+int32_t RangePartitioner::Assign(int vlabel, const json* oid,
+                                 const std::vector<uint64_t>& label_sizes,
+                                 const std::vector<int32_t>& nbr_fids) const {
+  if (oid == nullptr) {
+    return smallest(label_sizes);
+  } else if (!oid->is_number_integer()) {
+    return static_cast<int32_t>(hash_oid(*oid) % label_sizes.size());
+  }
+  int64_t key = oid->get<int64_t>();
+  auto iter = std::upper_bound(bounds_.begin(), bounds_.end(), key);
+  size_t fid = iter - bounds_.begin();
+  return static_cast<int32_t>(std::min(fid, label_sizes.size() - 1));
+}
+
+int32_t LdgPartitioner::Assign(int vlabel, const json* oid,
+                               const std::vector<uint64_t>& label_sizes,
+                               const std::vector<int32_t>& nbr_fids) const {
+  size_t num_fragments = label_sizes.size();
+  int32_t best = smallest(label_sizes);
+  if (nbr_fids.empty()) {
+    return best;
+  }
+
+  std::vector<uint32_t> nbr_counts(num_fragments, 0);
+  for (int32_t fid : nbr_fids) {
+    nbr_counts[fid]++;
+  }
+  double capacity =
+      (1 + slack_) * static_cast<double>(sum(label_sizes) + 1) / num_fragments;
+  double best_score = 0;
+  for (size_t fid = 0; fid < num_fragments; fid++) {
+    double score = nbr_counts[fid] * (1 - label_sizes[fid] / capacity);
+    // ties go to the smaller fragment
+    if (score > best_score ||
+        (score == best_score && score > 0 &&
+         label_sizes[fid] < label_sizes[best])) {
+      best_score = score;
+      best = static_cast<int32_t>(fid);
+    }
+  }
+  return best;
+}
+
+std::unique_ptr<VertexPartitioner> CreateVertexPartitioner(
+    const std::string& name, const std::string& range_bounds) {
+  if (name == "round_robin") {
+    return std::make_unique<RoundRobinPartitioner>();
+  } else if (name == "hash") {
+    return std::make_unique<HashPartitioner>();
+  } else if (name == "ldg") {
+    return std::make_unique<LdgPartitioner>(kLdgSlack);
+  } else if (name == "range") {
+    std::vector<int64_t> bounds;
+    std::stringstream ss(range_bounds);
+    std::string bound;
+    while (std::getline(ss, bound, ',')) {
+      try {
+        bounds.push_back(std::stoll(bound));
+      } catch (const std::exception& e) {
+        LOG(ERROR) << "Invalid range bound (" << bound << ")";
+        return nullptr;
+      }
+    }
+    std::sort(bounds.begin(), bounds.end());
+    return std::make_unique<RangePartitioner>(std::move(bounds));
+  }
+  return nullptr;
+}
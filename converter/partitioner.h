@@ -0,0 +1,101 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_PARTITIONER_H_
+#define CONVERTER_PARTITIONER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "vineyard/common/util/json.h"
+
+/**
+ * Chooses the fragment of a new vertex. Implementations keep no state of
+ * their own, whatever they need is passed in, so vertices of different
+ * labels may be placed in parallel.
+ */
+class VertexPartitioner {
+ public:
+  virtual ~VertexPartitioner() = default;
+
+  // `oid` may be null; `label_sizes` are the vertices of the label in each
+  // fragment; `nbr_fids` are the fragments of its neighbors known so far,
+  // only filled if UsesNeighbors()
+  virtual int32_t Assign(int vlabel, const vineyard::json* oid,
+                         const std::vector<uint64_t>& label_sizes,
+                         const std::vector<int32_t>& nbr_fids) const = 0;
+
+  virtual bool UsesNeighbors() const { return false; }
+};
+
+// the n-th vertex of a label goes to fragment n % num_fragments
+class RoundRobinPartitioner : public VertexPartitioner {
+ public:
+  int32_t Assign(int vlabel, const vineyard::json* oid,
+                 const std::vector<uint64_t>& label_sizes,
+                 const std::vector<int32_t>& nbr_fids) const override;
+};
+
+class HashPartitioner : public VertexPartitioner {
+ public:
+  int32_t Assign(int vlabel, const vineyard::json* oid,
+                 const std::vector<uint64_t>& label_sizes,
+                 const std::vector<int32_t>& nbr_fids) const override;
+};
+
+// integer oids below bounds[i] and not below bounds[i - 1] go to fragment i,
+// other oids are hashed
+class RangePartitioner : public VertexPartitioner {
+ public:
+  explicit RangePartitioner(std::vector<int64_t> bounds)
+      : bounds_(std::move(bounds)) {}
+
+  int32_t Assign(int vlabel, const vineyard::json* oid,
+                 const std::vector<uint64_t>& label_sizes,
+                 const std::vector<int32_t>& nbr_fids) const override;
+
+ private:
+  std::vector<int64_t> bounds_;  // sorted, one less than the fragments
+};
+
+/**
+ * Linear Deterministic Greedy: a vertex goes to the fragment holding most of
+ * its neighbors, weighted by the room left in the fragment,
+ *
+ *   argmax_i |N(v) in P_i| * (1 - |P_i| / C),  C = (1 + slack) * |V| / k
+ *
+ * and to the smallest fragment if it has no known neighbor.
+ */
+class LdgPartitioner : public VertexPartitioner {
+ public:
+  explicit LdgPartitioner(double slack) : slack_(slack) {}
+
+  int32_t Assign(int vlabel, const vineyard::json* oid,
+                 const std::vector<uint64_t>& label_sizes,
+                 const std::vector<int32_t>& nbr_fids) const override;
+
+  bool UsesNeighbors() const override { return true; }
+
+ private:
+  double slack_;
+};
+
+// by name: round_robin, hash, range or ldg; nullptr if unknown
+std::unique_ptr<VertexPartitioner> CreateVertexPartitioner(
+    const std::string& name, const std::string& range_bounds);
+
+#endif  // CONVERTER_PARTITIONER_H_
@@ -0,0 +1,64 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_SHM_PRODUCER_H_
+#define CONVERTER_SHM_PRODUCER_H_
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "log_producer.h"  // NOLINT(build/include_subdir)
+#include "vegito/src/util/shm_ring.h"
+
+/**
+ * Writes UnifiedLogs to the shared memory rings of the fragments, named
+ * `<prefix>_<fid>`, for writers on the same host. Messages are copied into
+ * the rings, and AddMessage() blocks while the ring of the fragment is
+ * full, which holds back the converter.
+ */
+class ShmProducer : public LogProducer {
+ public:
+  ShmProducer(const std::string& prefix, int num_partitions,
+              size_t ring_bytes) {
+    for (int fid = 0; fid < num_partitions; fid++) {
+      rings_.emplace_back(std::make_unique<gart::util::ShmRing>());
+      if (!rings_.back()->Open(gart::util::ShmRingName(prefix, fid),
+                               ring_bytes)) {
+        exit(1);
+      }
+    }
+  }
+
+  void AddMessage(const std::string& message, int32_t partition) override {
+    if (message.empty()) {
+      return;
+    }
+    rings_[partition]->Push(message.data(), message.size());
+  }
+
+  void AddMessage(char* data, size_t len, int32_t partition) override {
+    rings_[partition]->Push(data, len);
+    free(data);
+  }
+
+ private:
+  std::vector<std::unique_ptr<gart::util::ShmRing>> rings_;
+};
+
+#endif  // CONVERTER_SHM_PRODUCER_H_
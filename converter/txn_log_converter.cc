@@ -0,0 +1,883 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "txn_log_converter.h"  // NOLINT(build/include_subdir)
+
+#include <algorithm>
+#include <charconv>
+#include <utility>
+
+#include "glog/logging.h"
+
+#include "maxwell_parser.h"  // NOLINT(build/include_subdir)
+#include "vegito/src/fragment/unified_log.h"
+
+using json = vineyard::json;
+
+namespace {
+// number of logs encoded by a task of the worker pool
+constexpr size_t kEncodeChunkSize = 256;
+
+constexpr uint64_t kVertexCountsMagic = 0x4741525456434e54ul;  // "GARTVCNT"
+
+const json* find_column(const json& data, const std::string& column) {
+  auto iter = data.find(column);
+  return iter == data.end() ? nullptr : &*iter;
+}
+
+void append_int(std::string& out, int64_t val) {
+  char buf[24];
+  auto res = std::to_chars(buf, buf + sizeof(buf), val);
+  out.append(buf, res.ptr - buf);
+}
+
+// call fn with the oid as an int64_t or a string_view, false if it is
+// neither
+template <typename Fn>
+bool with_oid(const json& oid, Fn fn) {
+  if (oid.is_number_integer()) {
+    return fn(oid.get<int64_t>());
+  } else if (oid.is_string()) {
+    return fn(std::string_view(oid.get_ref<const std::string&>()));
+  }
+  return false;
+}
+
+std::string oid_key(int vlabel, const json& oid) {
+  return std::to_string(vlabel) + "|" + oid.dump();
+}
+
+// rough bytes of the columns of a row, without serializing it
+size_t row_bytes(const json& data) {
+  size_t bytes = 0;
+  if (!data.is_object()) {
+    return bytes;
+  }
+  for (auto iter = data.begin(); iter != data.end(); ++iter) {
+    bytes += iter.key().size() + sizeof(json);
+    if (iter->is_string()) {
+      bytes += iter->get_ref<const std::string&>().size();
+    }
+  }
+  return bytes;
+}
+
+bool is_encodable(const json& val) {
+  return val.is_string() || val.is_number_integer() || val.is_number_float();
+}
+
+void put_field(gart::UnifiedLogBuilder& builder, const json* val) {
+  if (val == nullptr) {
+    builder.PutNull();
+  } else if (val->is_string()) {
+    builder.PutString(val->get_ref<const std::string&>());
+  } else if (val->is_number_integer()) {
+    builder.PutInt64(val->get<int64_t>());
+  } else if (val->is_number_float()) {
+    builder.PutDouble(val->get<double>());
+  } else {
+    builder.PutNull();
+  }
+}
+
+void append_text_field(std::string& out, const json& val) {
+  if (val.is_string()) {
+    out.append(val.get_ref<const std::string&>());
+  } else if (val.is_number_integer()) {
+    append_int(out, val.get<int64_t>());
+  } else if (val.is_number_float()) {
+    out.append(std::to_string(val.get<float>()));
+  }
+}
+
+const char* text_op_name(gart::LogOp op) {
+  switch (op) {
+  case gart::LogOp::kAddVertex:
+    return "add_vertex";
+  case gart::LogOp::kAddEdge:
+    return "add_edge";
+  case gart::LogOp::kDeleteVertex:
+    return "delete_vertex";
+  case gart::LogOp::kDeleteEdge:
+    return "delete_edge";
+  case gart::LogOp::kUpdateVertex:
+    return "update_vertex";
+  default:
+    return "invalid";
+  }
+}
+}  // namespace
+
+TxnLogConverter::TxnLogConverter(const json& rg_mapping, int num_subgraphs,
+                                 const EpochPolicy& epoch_policy,
+                                 bool binary_format, WorkerPool* pool,
+                                 const std::string& oid_index_dir,
+                                 const VertexPartitioner* partitioner,
+                                 PendingEdgeBuffer&& pending_edges)
+    : num_subgraphs_(num_subgraphs),
+      epoch_policy_(epoch_policy),
+      binary_format_(binary_format),
+      pool_(pool),
+      partitioner_(partitioner),
+      pending_edges_(std::move(pending_edges)) {
+  auto types = rg_mapping["types"];
+  vertex_label_num_ = rg_mapping["vertexLabelNum"].get<int>();
+  id_parser_.Init(num_subgraphs_, vertex_label_num_);
+
+  for (int vlabel = 0; vlabel < vertex_label_num_; vlabel++) {
+    open_shard_(vlabel, oid_index_dir);
+  }
+
+  std::unordered_map<std::string, int> vertex_label2ids;
+  for (uint64_t idx = 0; idx < types.size(); idx++) {
+    auto type = types[idx]["type"].get<std::string>();
+    auto id = types[idx]["id"].get<int>();
+    auto table_name = types[idx]["table_name"].get<std::string>();
+    auto label = types[idx]["label"].get<std::string>();
+
+    TableMapping table;
+    table.name = table_name;
+    if (type == "VERTEX") {
+      table.label_id = id;
+      table.id_column = types[idx]["id_column_name"].get<std::string>();
+      vertex_label2ids.emplace(label, id);
+    } else if (type == "EDGE") {
+      auto relation = types[idx]["rawRelationShips"].at(0);
+      table.is_edge = true;
+      table.label_id = id - vertex_label_num_;
+      table.src_column = relation["src_column_name"].get<std::string>();
+      table.dst_column = relation["dst_column_name"].get<std::string>();
+      table.src_label_id =
+          vertex_label2ids.at(relation["srcVertexLabel"].get<std::string>());
+      table.dst_label_id =
+          vertex_label2ids.at(relation["dstVertexLabel"].get<std::string>());
+    } else {
+      continue;
+    }
+    auto properties = types[idx]["propertyDefList"];
+    for (uint64_t prop_id = 0; prop_id < properties.size(); prop_id++) {
+      table.properties.emplace_back(
+          properties[prop_id]["column_name"].get<std::string>());
+    }
+    for (auto* column : {&table.id_column, &table.src_column,
+                         &table.dst_column}) {
+      if (!column->empty()) {
+        table.columns.push_back(*column);
+      }
+    }
+    for (auto& prop_name : table.properties) {
+      if (std::find(table.columns.begin(), table.columns.end(), prop_name) ==
+          table.columns.end()) {
+        table.columns.push_back(prop_name);
+      }
+    }
+    table_ids_.emplace(table_name, tables_.size());
+    tables_.push_back(std::move(table));
+  }
+}
+
+void TxnLogConverter::GetOidIndexUsage(size_t& num_oids, size_t& bytes) const {
+  num_oids = 0;
+  bytes = 0;
+  for (auto& shard : vertex_shards_) {
+    num_oids += shard->oids.size();
+    bytes += shard->oids.MemoryUsage();
+  }
+}
+
+void TxnLogConverter::open_shard_(int vlabel, const std::string& dir) {
+  auto shard = std::make_unique<VertexIdShard>();
+  if (!shard->oids.Open(dir, "oid_index_v" + std::to_string(vlabel))) {
+    LOG(ERROR) << "Open oid index of vertex label " << vlabel << " in ("
+               << dir << ") failed.";
+    exit(1);
+  }
+
+  // continue numbering after the vertices of a reopened index, including
+  // the erased ones, whose gids are never handed out again
+  std::string counts_path =
+      dir.empty() ? ""
+                  : dir + "/oid_index_v" + std::to_string(vlabel) + ".counts";
+  size_t counts_size = (num_subgraphs_ + 1) * sizeof(uint64_t);
+  if (!shard->saved_counts.Open(counts_path, counts_size) ||
+      shard->saved_counts.size() != counts_size) {
+    LOG(ERROR) << "Open vertex counts of vertex label " << vlabel << " in ("
+               << dir << ") failed.";
+    exit(1);
+  }
+  auto saved = reinterpret_cast<uint64_t*>(shard->saved_counts.data());
+  auto& counts = shard->num_vertices_per_fragment;
+  counts.resize(num_subgraphs_, 0);
+  if (saved[0] == kVertexCountsMagic) {
+    counts.assign(saved + 1, saved + 1 + num_subgraphs_);
+  } else {
+    // an index from before the counts were kept
+    shard->oids.ForEachGid([this, &counts](int64_t gid) {
+      uint64_t& count = counts[id_parser_.GetFid(gid)];
+      uint64_t offset = id_parser_.GetOffset(gid);
+      count = std::max(count, offset + 1);
+    });
+    std::copy(counts.begin(), counts.end(), saved + 1);
+    saved[0] = kVertexCountsMagic;
+  }
+  if (shard->oids.size() > 0) {
+    LOG(INFO) << "Reopened oid index of vertex label " << vlabel << " with "
+              << shard->oids.size() << " oids";
+  }
+  vertex_shards_.push_back(std::move(shard));
+}
+
+std::shared_ptr<ConvertedBatch> TxnLogConverter::Convert(
+    const gart::util::KafkaMessageBatch& msgs) {
+  auto batch = std::make_shared<ConvertedBatch>();
+  auto& logs = batch->logs;
+  logs.resize(msgs.size());
+
+  pool_->ParallelFor(logs.size(), [this, &msgs, &logs](size_t idx) {
+    parse_(msgs.payload(idx), logs[idx]);
+  });
+
+  uint64_t first_epoch = epoch_;
+  number_epochs_(logs);
+  convert_numbered_(*batch);
+  if (epoch_ != first_epoch) {
+    sync_oid_indexes_();
+  }
+  return batch;
+}
+
+std::shared_ptr<ConvertedBatch> TxnLogConverter::ConvertRows(
+    int table, std::vector<json>&& rows) {
+  auto batch = std::make_shared<ConvertedBatch>();
+  auto& logs = batch->logs;
+  logs.resize(rows.size());
+  gart::LogOp op = tables_[table].is_edge ? gart::LogOp::kAddEdge
+                                          : gart::LogOp::kAddVertex;
+  for (size_t idx = 0; idx < rows.size(); idx++) {
+    logs[idx].table = table;
+    logs[idx].op = op;
+    logs[idx].epoch = epoch_;
+    logs[idx].data = std::move(rows[idx]);
+  }
+  convert_numbered_(*batch);
+  return batch;
+}
+
+void TxnLogConverter::convert_numbered_(ConvertedBatch& batch) {
+  auto& logs = batch.logs;
+  // placing a vertex by its neighbors needs all labels, so it is serial
+  if (partitioner_->UsesNeighbors()) {
+    assign_all_vertex_gids_(batch);
+  } else {
+    pool_->ParallelFor(vertex_label_num_, [this, &batch](size_t vlabel) {
+      assign_vertex_gids_(static_cast<int>(vlabel), batch);
+    });
+  }
+
+  buffer_edges_(batch);
+
+  size_t num_chunks = (logs.size() + kEncodeChunkSize - 1) / kEncodeChunkSize;
+  pool_->ParallelFor(num_chunks, [this, &logs](size_t chunk) {
+    size_t end = std::min((chunk + 1) * kEncodeChunkSize, logs.size());
+    for (size_t idx = chunk * kEncodeChunkSize; idx < end; idx++) {
+      encode_(logs[idx]);
+    }
+  });
+}
+
+std::shared_ptr<ConvertedBatch> TxnLogConverter::CloseIdleEpoch() {
+  if (epoch_policy_.max_epoch_duration_ms <= 0 || epoch_logs_ == 0 ||
+      in_txn_ || !epoch_expired_(Clock::now())) {
+    return nullptr;
+  }
+  NextEpoch();
+  auto batch = std::make_shared<ConvertedBatch>();
+  batch->epoch_marker = epoch_;
+  return batch;
+}
+
+void TxnLogConverter::NextEpoch() {
+  epoch_++;
+  epoch_logs_ = 0;
+  sync_oid_indexes_();
+}
+
+void TxnLogConverter::sync_oid_indexes_() {
+  pool_->ParallelFor(vertex_shards_.size(), [this](size_t vlabel) {
+    vertex_shards_[vlabel]->oids.Sync();
+    vertex_shards_[vlabel]->saved_counts.Sync();
+  });
+}
+
+void TxnLogConverter::number_epochs_(std::vector<ConvertedLog>& logs) {
+  Clock::time_point now = Clock::now();
+  uint64_t target_logs = epoch_policy_.logs_per_epoch;
+  uint64_t max_logs = epoch_policy_.max_logs_per_epoch;
+  for (auto& log : logs) {
+    if (log.counted) {
+      bool full = max_logs > 0 && epoch_logs_ >= max_logs;
+      bool reached = target_logs > 0 && epoch_logs_ >= target_logs;
+      bool done = !in_txn_ && (reached || epoch_expired_(now));
+      if (epoch_logs_ > 0 && (full || done)) {
+        epoch_++;
+        epoch_logs_ = 0;
+      }
+      if (epoch_logs_ == 0) {
+        epoch_start_ = now;
+      }
+      log.epoch = epoch_;
+      epoch_logs_++;
+    }
+    in_txn_ = !log.txn_end;
+  }
+}
+
+bool TxnLogConverter::epoch_expired_(Clock::time_point now) const {
+  return epoch_policy_.max_epoch_duration_ms > 0 &&
+         now - epoch_start_ >=
+             std::chrono::milliseconds(epoch_policy_.max_epoch_duration_ms);
+}
+
+void TxnLogConverter::parse_(std::string_view line, ConvertedLog& log) const {
+  MaxwellMessage txn_log;
+  if (!ParseMaxwellMessage(line, txn_log)) {
+    LOG(ERROR) << "Parse TxnLog failed: " << line.substr(0, 128);
+    return;
+  }
+  // maxwell marks the last row of a transaction with "commit"
+  log.txn_end = !txn_log.has_xid || txn_log.commit;
+
+  std::string_view type = txn_log.type;
+  bool is_insert = type == "insert";
+  if (!is_insert && type != "delete" && type != "update") {
+    return;
+  }
+  auto iter = table_ids_.find(std::string(txn_log.table));
+  // deletes and updates count even if their tables are not mapped
+  log.counted = !is_insert || iter != table_ids_.end();
+  if (iter == table_ids_.end()) {
+    return;
+  }
+  const TableMapping& table = tables_[iter->second];
+
+  if (is_insert) {
+    log.op = table.is_edge ? gart::LogOp::kAddEdge : gart::LogOp::kAddVertex;
+  } else if (type == "delete") {
+    log.op =
+        table.is_edge ? gart::LogOp::kDeleteEdge : gart::LogOp::kDeleteVertex;
+  } else if (table.is_edge) {
+    // TODO(wanglei): add update edge support
+    return;
+  } else {
+    // maxwell puts the old values of the changed columns in "old"
+    log.op = gart::LogOp::kUpdateVertex;
+    if (!txn_log.old.empty() &&
+        !ExtractColumns(txn_log.old, table.columns, log.old_data)) {
+      LOG(ERROR) << "Parse TxnLog failed: " << line.substr(0, 128);
+      return;
+    }
+    for (size_t idx = 0; idx < table.properties.size(); idx++) {
+      if (find_column(log.old_data, table.properties[idx]) != nullptr) {
+        log.changed_props.push_back(static_cast<int>(idx));
+      }
+    }
+    if (log.changed_props.empty() &&
+        find_column(log.old_data, table.id_column) == nullptr) {
+      return;
+    }
+  }
+  if (!txn_log.data.empty() &&
+      !ExtractColumns(txn_log.data, table.columns, log.data)) {
+    LOG(ERROR) << "Parse TxnLog failed: " << line.substr(0, 128);
+    log.changed_props.clear();
+    log.op = gart::LogOp::kInvalid;
+    return;
+  }
+  log.table = iter->second;
+}
+
+void TxnLogConverter::assign_vertex_gids_(int vlabel, ConvertedBatch& batch) {
+  for (auto& log : batch.logs) {
+    if (log.table < 0) {
+      continue;
+    }
+    const TableMapping& table = tables_[log.table];
+    if (table.is_edge) {
+      resolve_endpoints_(vlabel, log);
+    } else if (table.label_id == vlabel) {
+      apply_vertex_log_(vlabel, log);
+    }
+  }
+}
+
+void TxnLogConverter::assign_all_vertex_gids_(ConvertedBatch& batch) {
+  collect_new_neighbors_(batch);
+  std::vector<int32_t> nbr_fids;
+  for (auto& log : batch.logs) {
+    if (log.table < 0) {
+      continue;
+    }
+    const TableMapping& table = tables_[log.table];
+    if (table.is_edge) {
+      resolve_endpoints_(table.src_label_id, log);
+      if (table.dst_label_id != table.src_label_id) {
+        resolve_endpoints_(table.dst_label_id, log);
+      }
+      continue;
+    }
+    nbr_fids.clear();
+    for (auto& [nbr_label, nbr_oid] : log.new_neighbors) {
+      int64_t gid;
+      if (lookup_gid_(nbr_label, *nbr_oid, gid)) {
+        nbr_fids.push_back(id_parser_.GetFid(gid));
+      }
+    }
+    apply_vertex_log_(table.label_id, log, nbr_fids);
+  }
+}
+
+void TxnLogConverter::collect_new_neighbors_(ConvertedBatch& batch) const {
+  // new vertices of the batch, by label and oid
+  std::unordered_map<std::string, ConvertedLog*> new_vertices;
+  for (auto& log : batch.logs) {
+    if (log.table < 0) {
+      continue;
+    }
+    const TableMapping& table = tables_[log.table];
+    if (!table.is_edge) {
+      const json* oid = find_column(log.data, table.id_column);
+      if (oid == nullptr) {
+        continue;
+      }
+      std::string key = oid_key(table.label_id, *oid);
+      if (log.op == gart::LogOp::kAddVertex) {
+        new_vertices[key] = &log;
+      } else {
+        new_vertices.erase(key);
+      }
+      continue;
+    } else if (log.op != gart::LogOp::kAddEdge) {
+      continue;
+    }
+
+    const json* src = find_column(log.data, table.src_column);
+    const json* dst = find_column(log.data, table.dst_column);
+    if (src == nullptr || dst == nullptr) {
+      continue;
+    }
+    auto iter = new_vertices.find(oid_key(table.src_label_id, *src));
+    if (iter != new_vertices.end()) {
+      iter->second->new_neighbors.emplace_back(table.dst_label_id, dst);
+    }
+    iter = new_vertices.find(oid_key(table.dst_label_id, *dst));
+    if (iter != new_vertices.end()) {
+      iter->second->new_neighbors.emplace_back(table.src_label_id, src);
+    }
+  }
+}
+
+void TxnLogConverter::apply_vertex_log_(
+    int vlabel, ConvertedLog& log, const std::vector<int32_t>& nbr_fids) {
+  VertexIdShard& shard = *vertex_shards_[vlabel];
+  const TableMapping& table = tables_[log.table];
+  const json* oid = find_column(log.data, table.id_column);
+
+  if (log.op == gart::LogOp::kAddVertex) {
+    // a known oid, e.g., replayed after a restart, keeps its gid
+    bool known = oid != nullptr && with_oid(*oid, [&](auto key) {
+                   return shard.oids.Find(key, log.vertex_gid);
+                 });
+    if (known) {
+      return;
+    }
+    int32_t fid = partitioner_->Assign(
+        vlabel, oid, shard.num_vertices_per_fragment, nbr_fids);
+    int64_t offset = shard.num_vertices_per_fragment[fid]++;
+    reinterpret_cast<uint64_t*>(shard.saved_counts.data())[fid + 1] =
+        offset + 1;
+    log.vertex_gid = id_parser_.GenerateId(fid, vlabel, offset);
+    if (oid != nullptr) {
+      int64_t gid = log.vertex_gid;
+      with_oid(*oid, [&](auto key) { return shard.oids.Insert(key, gid); });
+    }
+    return;
+  }
+
+  // a delete or update, of the vertex with the old oid if it changed
+  const json* old_oid = find_column(log.old_data, table.id_column);
+  const json* key = old_oid != nullptr ? old_oid : oid;
+  bool found = key != nullptr && with_oid(*key, [&](auto k) {
+                 return shard.oids.Find(k, log.vertex_gid);
+               });
+  if (!found) {
+    LOG(ERROR) << "Unknown vertex " << log.data.dump();
+    log.table = -1;
+    return;
+  }
+  if (log.op == gart::LogOp::kDeleteVertex) {
+    with_oid(*key, [&](auto k) { return shard.oids.Erase(k); });
+  } else if (old_oid != nullptr && oid != nullptr) {
+    int64_t gid = log.vertex_gid;
+    with_oid(*old_oid, [&](auto k) { return shard.oids.Erase(k); });
+    with_oid(*oid, [&](auto k) { return shard.oids.Insert(k, gid); });
+  }
+}
+
+void TxnLogConverter::resolve_endpoints_(int vlabel, ConvertedLog& log) const {
+  const TableMapping& table = tables_[log.table];
+  if (table.src_label_id == vlabel) {
+    const json* src = find_column(log.data, table.src_column);
+    if (src != nullptr) {
+      lookup_gid_(vlabel, *src, log.src_gid);
+    }
+  }
+  if (table.dst_label_id == vlabel) {
+    const json* dst = find_column(log.data, table.dst_column);
+    if (dst != nullptr) {
+      lookup_gid_(vlabel, *dst, log.dst_gid);
+    }
+  }
+}
+
+void TxnLogConverter::buffer_edges_(ConvertedBatch& batch) {
+  std::vector<ConvertedLog> released, ready;
+  for (auto& log : batch.logs) {
+    if (log.table < 0) {
+      continue;
+    }
+    const TableMapping& table = tables_[log.table];
+    if (table.is_edge) {
+      if (log.op == gart::LogOp::kAddEdge &&
+          (log.src_gid < 0 || log.dst_gid < 0)) {
+        wait_for_endpoint_(std::move(log));
+        log.table = -1;
+      }
+      continue;
+    } else if (log.op != gart::LogOp::kAddVertex || pending_edges_.empty()) {
+      continue;
+    }
+
+    const json* oid = find_column(log.data, table.id_column);
+    if (oid == nullptr) {
+      continue;
+    }
+    pending_edges_.Release(table.label_id, *oid, released);
+    for (auto& edge : released) {
+      const TableMapping& edge_table = tables_[edge.table];
+      resolve_endpoints_(edge_table.src_label_id, edge);
+      resolve_endpoints_(edge_table.dst_label_id, edge);
+      if (edge.src_gid < 0 || edge.dst_gid < 0) {
+        wait_for_endpoint_(std::move(edge));
+      } else {
+        // earlier epochs may be published, so it joins the latest one
+        edge.epoch = epoch_;
+        ready.push_back(std::move(edge));
+      }
+    }
+    released.clear();
+  }
+
+  size_t num_dropped = pending_edges_.Expire();
+  if (num_dropped > 0) {
+    num_dangling_edges_ += num_dropped;
+    LOG(WARNING) << "Dropped " << num_dropped
+                 << " edges whose endpoints did not arrive in time";
+  }
+
+  // after every log of the batch, including the vertices they wait on
+  for (auto& edge : ready) {
+    batch.logs.push_back(std::move(edge));
+  }
+}
+
+void TxnLogConverter::wait_for_endpoint_(ConvertedLog&& log) {
+  const TableMapping& table = tables_[log.table];
+  const json* src = find_column(log.data, table.src_column);
+  const json* dst = find_column(log.data, table.dst_column);
+  if (src == nullptr || dst == nullptr) {
+    return;  // reported when encoded
+  }
+  if (log.src_gid < 0) {
+    pending_edges_.Add(table.src_label_id, *src, std::move(log));
+  } else {
+    pending_edges_.Add(table.dst_label_id, *dst, std::move(log));
+  }
+}
+
+bool TxnLogConverter::lookup_gid_(int vlabel, const json& oid,
+                                  int64_t& gid) const {
+  const VertexIdShard& shard = *vertex_shards_[vlabel];
+  return with_oid(oid, [&](auto key) { return shard.oids.Find(key, gid); });
+}
+
+void TxnLogConverter::encode_(ConvertedLog& log) const {
+  if (log.table < 0) {
+    return;
+  }
+  const TableMapping& table = tables_[log.table];
+  if (table.is_edge && (log.src_gid < 0 || log.dst_gid < 0)) {
+    LOG(ERROR) << "Unknown endpoint of edge " << log.data.dump();
+    log.table = -1;
+    return;
+  }
+  if (log.op == gart::LogOp::kUpdateVertex && log.changed_props.empty()) {
+    // only the oid changed, which is not a property
+    log.table = -1;
+    return;
+  }
+  bool is_add =
+      log.op == gart::LogOp::kAddVertex || log.op == gart::LogOp::kAddEdge;
+
+  if (binary_format_) {
+    thread_local gart::UnifiedLogBuilder builder;
+    builder.Begin(log.op, log.epoch);
+    if (table.is_edge) {
+      builder.PutEdge(table.label_id, log.src_gid, log.dst_gid);
+    } else {
+      builder.PutVertex(log.vertex_gid);
+    }
+    if (is_add) {
+      for (auto& prop_name : table.properties) {
+        put_field(builder, find_column(log.data, prop_name));
+      }
+    } else if (log.op == gart::LogOp::kUpdateVertex) {
+      for (int prop_id : log.changed_props) {
+        builder.PutInt64(prop_id);
+        put_field(builder, find_column(log.data, table.properties[prop_id]));
+      }
+    }
+    log.record = builder.Finish();
+  } else {
+    std::string& content = log.record;
+    content.reserve(64);
+    content.append(text_op_name(log.op));
+    content.push_back('|');
+    append_int(content, log.epoch);
+    if (table.is_edge) {
+      content.push_back('|');
+      append_int(content, table.label_id);
+      content.push_back('|');
+      append_int(content, log.src_gid);
+      content.push_back('|');
+      append_int(content, log.dst_gid);
+    } else {
+      content.push_back('|');
+      append_int(content, log.vertex_gid);
+    }
+    if (is_add) {
+      for (auto& prop_name : table.properties) {
+        const json* prop_value = find_column(log.data, prop_name);
+        if (prop_value != nullptr && is_encodable(*prop_value)) {
+          content.push_back('|');
+          append_text_field(content, *prop_value);
+        }
+      }
+    } else if (log.op == gart::LogOp::kUpdateVertex) {
+      // a null is kept as an empty field, so the pairs stay aligned
+      for (int prop_id : log.changed_props) {
+        content.push_back('|');
+        append_int(content, prop_id);
+        content.push_back('|');
+        const json* prop_value =
+            find_column(log.data, table.properties[prop_id]);
+        if (prop_value != nullptr && is_encodable(*prop_value)) {
+          append_text_field(content, *prop_value);
+        }
+      }
+    }
+  }
+  // the properties are encoded, free them early
+  log.data = json();
+  log.old_data = json();
+}
+
+void PendingEdgeBuffer::Add(int vlabel, const json& oid, ConvertedLog&& log) {
+  size_t bytes = sizeof(Entry) + row_bytes(log.data);
+  entries_.push_back(
+      {oid_key(vlabel, oid), next_seq_++, bytes, Clock::now(), std::move(log)});
+  auto iter = std::prev(entries_.end());
+  waiting_.emplace(iter->key, iter);
+  bytes_ += bytes;
+}
+
+void PendingEdgeBuffer::Release(int vlabel, const json& oid,
+                                std::vector<ConvertedLog>& out) {
+  auto range = waiting_.equal_range(oid_key(vlabel, oid));
+  if (range.first == range.second) {
+    return;
+  }
+  std::vector<std::list<Entry>::iterator> iters;
+  for (auto iter = range.first; iter != range.second; ++iter) {
+    iters.push_back(iter->second);
+  }
+  waiting_.erase(range.first, range.second);
+  std::sort(iters.begin(), iters.end(),
+            [](auto a, auto b) { return a->seq < b->seq; });
+  for (auto iter : iters) {
+    out.push_back(std::move(iter->log));
+    bytes_ -= iter->bytes;
+    entries_.erase(iter);
+  }
+}
+
+size_t PendingEdgeBuffer::Expire() {
+  Clock::time_point deadline =
+      Clock::now() - std::chrono::milliseconds(timeout_ms_);
+  size_t num_dropped = 0;
+  while (!entries_.empty() &&
+         ((max_bytes_ > 0 && bytes_ > max_bytes_) ||
+          (timeout_ms_ > 0 && entries_.front().since <= deadline))) {
+    erase_(entries_.begin());
+    num_dropped++;
+  }
+  return num_dropped;
+}
+
+void PendingEdgeBuffer::erase_(std::list<Entry>::iterator iter) {
+  auto range = waiting_.equal_range(iter->key);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == iter) {
+      waiting_.erase(it);
+      break;
+    }
+  }
+  bytes_ -= iter->bytes;
+  entries_.erase(iter);
+}
+
+LogEmitter::LogEmitter(const TxnLogConverter* converter,
+                       std::shared_ptr<LogProducer> producer,
+                       int num_subgraphs, bool binary_format,
+                       size_t max_pending_batches, size_t max_message_bytes)
+    : converter_(converter),
+      producer_(std::move(producer)),
+      num_subgraphs_(num_subgraphs),
+      binary_format_(binary_format),
+      max_pending_batches_(std::max(max_pending_batches, size_t(1))),
+      max_message_bytes_(max_message_bytes),
+      messages_(num_subgraphs) {
+  thread_ = std::thread([this] { emit_loop_(); });
+}
+
+LogEmitter::~LogEmitter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  emit_cv_.notify_one();
+  thread_.join();
+}
+
+void LogEmitter::Push(std::shared_ptr<ConvertedBatch> batch) {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    push_cv_.wait(lock,
+                  [this] { return pending_.size() < max_pending_batches_; });
+    pending_.push_back(std::move(batch));
+  }
+  emit_cv_.notify_one();
+}
+
+void LogEmitter::emit_loop_() {
+  while (true) {
+    std::shared_ptr<ConvertedBatch> batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      emit_cv_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+      if (pending_.empty()) {
+        return;
+      }
+      batch = std::move(pending_.front());
+      pending_.pop_front();
+    }
+    push_cv_.notify_one();
+    emit_(*batch);
+  }
+}
+
+void LogEmitter::emit_(const ConvertedBatch& batch) {
+  if (batch.epoch_marker >= 0) {
+    emit_epoch_marker_(batch.epoch_marker);
+  }
+  for (auto& log : batch.logs) {
+    if (log.table < 0) {
+      continue;
+    }
+    emit_epoch_marker_(log.epoch);
+
+    // each fragment reads its own partition, so an edge crossing two
+    // fragments is sent to both of them
+    if (converter_->table(log.table).is_edge) {
+      int32_t src_fid = converter_->GetFid(log.src_gid);
+      int32_t dst_fid = converter_->GetFid(log.dst_gid);
+      send_(log.record, src_fid);
+      if (dst_fid != src_fid) {
+        send_(log.record, dst_fid);
+      }
+      if (log.op == gart::LogOp::kAddEdge) {
+        num_edges_.fetch_add(1, std::memory_order_relaxed);
+        if (dst_fid != src_fid) {
+          num_cut_edges_.fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+    } else if (log.op == gart::LogOp::kDeleteVertex) {
+      // fragments with an outer copy of the vertex drop it and its edges
+      for (int32_t fid = 0; fid < num_subgraphs_; fid++) {
+        send_(log.record, fid);
+      }
+    } else {
+      send_(log.record, converter_->GetFid(log.vertex_gid));
+    }
+  }
+  flush_();
+}
+
+// start a new epoch on every fragment, including the idle ones
+void LogEmitter::emit_epoch_marker_(uint64_t epoch) {
+  if (static_cast<int64_t>(epoch) == last_epoch_) {
+    return;
+  }
+  std::string marker;
+  if (binary_format_) {
+    gart::UnifiedLogBuilder builder;
+    builder.Begin(gart::LogOp::kEpoch, epoch);
+    marker = builder.Finish();
+  } else {
+    marker = "epoch|" + std::to_string(epoch);
+  }
+  flush_();
+  for (int32_t fid = 0; fid < num_subgraphs_; fid++) {
+    send_(marker, fid);
+  }
+  last_epoch_ = epoch;
+}
+
+void LogEmitter::send_(const std::string& record, int32_t fid) {
+  if (!binary_format_ || max_message_bytes_ == 0) {
+    producer_->AddMessage(record, fid);
+    return;
+  }
+  LogMessageBuffer& message = messages_[fid];
+  if (!message.empty() && message.size() + record.size() > max_message_bytes_) {
+    message.Send(*producer_, fid);
+  }
+  message.Append(record);
+}
+
+void LogEmitter::flush_() {
+  for (int32_t fid = 0; fid < num_subgraphs_; fid++) {
+    messages_[fid].Send(*producer_, fid);
+  }
+}
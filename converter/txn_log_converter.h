@@ -0,0 +1,301 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_TXN_LOG_CONVERTER_H_
+#define CONVERTER_TXN_LOG_CONVERTER_H_
+
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "vineyard/common/util/json.h"
+
+#include "log_producer.h"    // NOLINT(build/include_subdir)
+#include "oid_index.h"       // NOLINT(build/include_subdir)
+#include "partitioner.h"     // NOLINT(build/include_subdir)
+#include "vegito/src/fragment/id_parser.h"
+#include "vegito/src/fragment/unified_log.h"
+#include "vegito/src/util/kafka_consumer.h"
+#include "worker_pool.h"  // NOLINT(build/include_subdir)
+
+// a table of the source database, mapped to a vertex or edge label
+struct TableMapping {
+  std::string name;
+  bool is_edge = false;
+  int label_id = 0;  // vertex label, or edge label minus vertex label number
+  std::string id_column;  // of a vertex table
+  std::string src_column, dst_column;  // of an edge table
+  int src_label_id = 0, dst_label_id = 0;
+  std::vector<std::string> properties;  // columns in the property order
+  std::vector<std::string> columns;  // all columns read from TxnLogs
+};
+
+// a TxnLog and the UnifiedLog converted from it
+struct ConvertedLog {
+  int table = -1;  // index of TableMapping, -1 if there is nothing to emit
+  gart::LogOp op = gart::LogOp::kInvalid;
+  bool counted = false;  // counts towards the size of an epoch
+  bool txn_end = true;   // no log of the same transaction follows
+  uint64_t epoch = 0;
+  vineyard::json data;      // the row, or its new values of an update
+  vineyard::json old_data;  // old values of the columns changed by an update
+  std::vector<int> changed_props;  // of an update, in the property order
+  // of a new vertex, endpoints of later edges of the batch to it, as (vertex
+  // label, oid), for partitioners placing vertices by their neighbors
+  std::vector<std::pair<int, const vineyard::json*>> new_neighbors;
+  int64_t vertex_gid = 0;
+  int64_t src_gid = -1, dst_gid = -1;  // -1 if the endpoint is unknown
+  std::string record;
+};
+
+struct ConvertedBatch {
+  std::vector<ConvertedLog> logs;  // in the order of the binlog
+  int64_t epoch_marker = -1;       // an epoch to start before the logs
+};
+
+/**
+ * Edges waiting for an endpoint vertex that is not known yet, e.g., when a
+ * transaction writes an edge table before a vertex table, or a bootstrap of
+ * the vertex table runs behind. Each edge waits on one missing endpoint, by
+ * vertex label and oid. Edges beyond `max_bytes` or older than `timeout_ms`
+ * are dropped, oldest first; zero disables a bound.
+ */
+class PendingEdgeBuffer {
+ public:
+  PendingEdgeBuffer(size_t max_bytes, int timeout_ms)
+      : max_bytes_(max_bytes), timeout_ms_(timeout_ms) {}
+
+  PendingEdgeBuffer(const PendingEdgeBuffer&) = delete;
+  PendingEdgeBuffer(PendingEdgeBuffer&&) = default;
+
+  void Add(int vlabel, const vineyard::json& oid, ConvertedLog&& log);
+
+  // move the edges waiting on a vertex to `out`, in the order they came
+  void Release(int vlabel, const vineyard::json& oid,
+               std::vector<ConvertedLog>& out);
+
+  // returns the number of edges dropped
+  size_t Expire();
+
+  bool empty() const { return entries_.empty(); }
+  size_t size() const { return entries_.size(); }
+  size_t bytes() const { return bytes_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    std::string key;
+    uint64_t seq;
+    size_t bytes;
+    Clock::time_point since;
+    ConvertedLog log;
+  };
+
+  void erase_(std::list<Entry>::iterator iter);
+
+  size_t max_bytes_;
+  int timeout_ms_;
+  std::list<Entry> entries_;  // oldest first
+  std::unordered_multimap<std::string, std::list<Entry>::iterator> waiting_;
+  size_t bytes_ = 0;
+  uint64_t next_seq_ = 0;
+};
+
+/**
+ * When the converter starts a new epoch. Epochs are only cut between
+ * transactions, once they reach `logs_per_epoch` logs or have been open
+ * for `max_epoch_duration_ms`; `max_logs_per_epoch` bounds an epoch even
+ * inside a transaction. Zero disables a limit.
+ */
+struct EpochPolicy {
+  int logs_per_epoch = 10000;
+  int max_logs_per_epoch = 0;
+  int max_epoch_duration_ms = 0;
+};
+
+/**
+ * Converts Maxwell TxnLogs to UnifiedLogs, batch by batch:
+ *
+ *   1. parse JSON messages, in parallel;
+ *   2. number the logs into epochs, in order, see EpochPolicy;
+ *   3. assign gids to new vertices, look up the updated and deleted ones
+ *      and resolve edge endpoints, in parallel over vertex labels. Each
+ *      label walks the batch in order, so its gids only depend on the order
+ *      of logs of its own table, and an edge sees the oids as of its log.
+ *      A partitioner using neighbors sees the edges of a new vertex later
+ *      in the batch, and then all labels are walked together;
+ *   4. buffer edges with an unknown endpoint, and release the ones whose
+ *      endpoints arrived at the end of the batch, see PendingEdgeBuffer;
+ *   5. encode records, in parallel.
+ *
+ * Batches must be converted one at a time and in order, emitting them is
+ * left to LogEmitter.
+ */
+class TxnLogConverter {
+ public:
+  // oid indexes are kept in memory if `oid_index_dir` is empty
+  TxnLogConverter(const vineyard::json& rg_mapping, int num_subgraphs,
+                  const EpochPolicy& epoch_policy, bool binary_format,
+                  WorkerPool* pool, const std::string& oid_index_dir,
+                  const VertexPartitioner* partitioner,
+                  PendingEdgeBuffer&& pending_edges);
+
+  std::shared_ptr<ConvertedBatch> Convert(
+      const gart::util::KafkaMessageBatch& msgs);
+
+  // rows of a table dump as inserts, all in the current epoch, see BulkLoad
+  std::shared_ptr<ConvertedBatch> ConvertRows(
+      int table, std::vector<vineyard::json>&& rows);
+
+  // end the current epoch, even if it has no log; oid indexes on files are
+  // synced at the end of every epoch
+  void NextEpoch();
+
+  // an empty batch starting the next epoch, if the current one has
+  // outlived max_epoch_duration_ms with no new log; nullptr otherwise
+  std::shared_ptr<ConvertedBatch> CloseIdleEpoch();
+
+  int32_t GetFid(int64_t gid) const { return id_parser_.GetFid(gid); }
+
+  const TableMapping& table(int idx) const { return tables_[idx]; }
+  int num_tables() const { return static_cast<int>(tables_.size()); }
+
+  // number of oids and bytes of the oid indexes, of all vertex labels
+  void GetOidIndexUsage(size_t& num_oids, size_t& bytes) const;
+
+  // edges waiting for an endpoint, their bytes, and the edges dropped
+  void GetPendingEdgeStats(size_t& num_pending, size_t& bytes,
+                           uint64_t& num_dangling) const {
+    num_pending = pending_edges_.size();
+    bytes = pending_edges_.bytes();
+    num_dangling = num_dangling_edges_;
+  }
+
+ private:
+  // oid -> gid of one vertex label, only touched by its own shard
+  struct VertexIdShard {
+    OidIndex oids;
+    std::vector<uint64_t> num_vertices_per_fragment;
+    // a magic word, then num_vertices_per_fragment, kept with the index
+    MappedBuffer saved_counts;
+  };
+
+  void open_shard_(int vlabel, const std::string& dir);
+  void sync_oid_indexes_();
+  using Clock = std::chrono::steady_clock;
+
+  void parse_(std::string_view line, ConvertedLog& log) const;
+  void number_epochs_(std::vector<ConvertedLog>& logs);
+  bool epoch_expired_(Clock::time_point now) const;
+  void convert_numbered_(ConvertedBatch& batch);
+  void assign_vertex_gids_(int vlabel, ConvertedBatch& batch);
+  void assign_all_vertex_gids_(ConvertedBatch& batch);
+  void collect_new_neighbors_(ConvertedBatch& batch) const;
+  void apply_vertex_log_(int vlabel, ConvertedLog& log,
+                         const std::vector<int32_t>& nbr_fids = {});
+  void resolve_endpoints_(int vlabel, ConvertedLog& log) const;
+  void buffer_edges_(ConvertedBatch& batch);
+  void wait_for_endpoint_(ConvertedLog&& log);
+  bool lookup_gid_(int vlabel, const vineyard::json& oid, int64_t& gid) const;
+  void encode_(ConvertedLog& log) const;
+
+  int num_subgraphs_;
+  EpochPolicy epoch_policy_;
+  bool binary_format_;
+  WorkerPool* pool_;
+  const VertexPartitioner* partitioner_;
+
+  int vertex_label_num_ = 0;
+  std::vector<TableMapping> tables_;
+  std::unordered_map<std::string, int> table_ids_;  // name -> index
+  gart::IdParser<int64_t> id_parser_;
+
+  std::vector<std::unique_ptr<VertexIdShard>> vertex_shards_;
+
+  uint64_t epoch_ = 0;
+  uint64_t epoch_logs_ = 0;  // counted logs in the current epoch
+  Clock::time_point epoch_start_;
+  bool in_txn_ = false;
+
+  PendingEdgeBuffer pending_edges_;
+  uint64_t num_dangling_edges_ = 0;
+};
+
+/**
+ * Sends converted batches to the fragments in the background, in the order
+ * they are pushed. An epoch marker goes to every fragment when a new epoch
+ * starts, and an edge crossing two fragments is sent to both of them.
+ *
+ * Binary records of a fragment are batched into Kafka messages of up to
+ * `max_message_bytes`. A message never spans two epochs and starts with
+ * the epoch marker, so resuming from its offset replays a whole epoch.
+ * Text records are sent one per message.
+ */
+class LogEmitter {
+ public:
+  LogEmitter(const TxnLogConverter* converter,
+             std::shared_ptr<LogProducer> producer, int num_subgraphs,
+             bool binary_format, size_t max_pending_batches,
+             size_t max_message_bytes);
+
+  ~LogEmitter();
+
+  // blocks if too many batches are waiting
+  void Push(std::shared_ptr<ConvertedBatch> batch);
+
+  // edges added so far, and those crossing two fragments
+  void GetEdgeCut(uint64_t& num_edges, uint64_t& num_cut_edges) const {
+    num_edges = num_edges_.load(std::memory_order_relaxed);
+    num_cut_edges = num_cut_edges_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void emit_loop_();
+  void emit_(const ConvertedBatch& batch);
+  void emit_epoch_marker_(uint64_t epoch);
+  void send_(const std::string& record, int32_t fid);
+  void flush_();
+
+  const TxnLogConverter* converter_;
+  std::shared_ptr<LogProducer> producer_;
+  int num_subgraphs_;
+  bool binary_format_;
+  size_t max_pending_batches_;
+  size_t max_message_bytes_;
+  std::vector<LogMessageBuffer> messages_;  // of each fragment
+  int64_t last_epoch_ = -1;
+  std::atomic<uint64_t> num_edges_{0};
+  std::atomic<uint64_t> num_cut_edges_{0};
+
+  std::mutex mutex_;
+  std::condition_variable push_cv_;
+  std::condition_variable emit_cv_;
+  std::deque<std::shared_ptr<ConvertedBatch>> pending_;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
+
+#endif  // CONVERTER_TXN_LOG_CONVERTER_H_
@@ -0,0 +1,126 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CONVERTER_WORKER_POOL_H_
+#define CONVERTER_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of threads running one parallel loop at a time. The calling
+ * thread takes part in the loop, so a pool of 0 threads runs it inline.
+ */
+class WorkerPool {
+ public:
+  explicit WorkerPool(int num_threads) {
+    for (int i = 0; i < num_threads; i++) {
+      threads_.emplace_back([this] { worker_loop_(); });
+    }
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  int size() const { return static_cast<int>(threads_.size()) + 1; }
+
+  // run fn(0), ..., fn(n - 1), and return after all of them finish
+  void ParallelFor(size_t n, const std::function<void(size_t)>& fn) {
+    if (threads_.empty() || n <= 1) {
+      for (size_t idx = 0; idx < n; idx++) {
+        fn(idx);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &fn;
+      task_size_ = n;
+      next_ = 0;
+      active_ = threads_.size();
+      generation_++;
+    }
+    task_cv_.notify_all();
+    run_task_(fn, n);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this] { return active_ == 0; });
+    task_ = nullptr;
+  }
+
+ private:
+  void run_task_(const std::function<void(size_t)>& fn, size_t n) {
+    for (size_t idx = next_++; idx < n; idx = next_++) {
+      fn(idx);
+    }
+  }
+
+  void worker_loop_() {
+    size_t seen_generation = 0;
+    while (true) {
+      const std::function<void(size_t)>* task;
+      size_t task_size;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        task_cv_.wait(lock, [this, seen_generation] {
+          return stop_ || generation_ != seen_generation;
+        });
+        if (stop_) {
+          return;
+        }
+        seen_generation = generation_;
+        task = task_;
+        task_size = task_size_;
+      }
+
+      run_task_(*task, task_size);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        active_--;
+      }
+      done_cv_.notify_one();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(size_t)>* task_ = nullptr;
+  size_t task_size_ = 0;
+  std::atomic<size_t> next_{0};
+  size_t active_ = 0;  // workers still in the current loop
+  size_t generation_ = 0;
+  bool stop_ = false;
+
+  std::vector<std::thread> threads_;
+};
+
+#endif  // CONVERTER_WORKER_POOL_H_
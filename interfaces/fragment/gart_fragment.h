@@ -16,6 +16,8 @@
 #ifndef INTERFACES_FRAGMENT_GART_FRAGMENT_H_
 #define INTERFACES_FRAGMENT_GART_FRAGMENT_H_
 
+#include <limits>
+
 #include "grape/fragment/fragment_base.h"
 #include "vineyard/basic/ds/hashmap.vineyard.h"
 
@@ -73,10 +75,10 @@ class GartFragment {
     ovnums_.resize(vertex_label_num_);
     tvnums_.resize(vertex_label_num_);
 
-    inner_edge_blob_ptrs_.resize(vertex_label_num_, nullptr);
-    outer_edge_blob_ptrs_.resize(vertex_label_num_, nullptr);
-    inner_edge_label_ptrs_.resize(vertex_label_num_, nullptr);
-    outer_edge_label_ptrs_.resize(vertex_label_num_, nullptr);
+    inner_edge_extents_.resize(vertex_label_num_);
+    outer_edge_extents_.resize(vertex_label_num_);
+    inner_edge_label_ptrs_.resize(vertex_label_num_);
+    outer_edge_label_ptrs_.resize(vertex_label_num_);
 
     idst_.resize(vertex_label_num_);
     odst_.resize(vertex_label_num_);
@@ -244,35 +246,15 @@ class GartFragment {
           blob_info[i]["ovl2g"]["len_ele"].get<uint64_t>();
 
       // init edge blobs
-      uint64_t inner_edge_label_obj_id =
-          blob_info[i]["elabel2seg"]["object_id"].get<uint64_t>();
-      std::shared_ptr<vineyard::Blob> inner_edge_label_blob;
-      VINEYARD_CHECK_OK(client_.GetBlob(inner_edge_label_obj_id, true,
-                                        inner_edge_label_blob));
       inner_edge_label_ptrs_[vlabel] =
-          (uint64_t*) inner_edge_label_blob->data();
-
-      uint64_t outer_edge_label_obj_id =
-          blob_info[i]["ov_elabel2seg"]["object_id"].get<uint64_t>();
-      std::shared_ptr<vineyard::Blob> outer_edge_label_blob;
-      VINEYARD_CHECK_OK(client_.GetBlob(outer_edge_label_obj_id, true,
-                                        outer_edge_label_blob));
+          map_edge_label_ptrs_(blob_info[i]["elabel2seg"]);
       outer_edge_label_ptrs_[vlabel] =
-          (uint64_t*) outer_edge_label_blob->data();
+          map_edge_label_ptrs_(blob_info[i]["ov_elabel2seg"]);
 
-      uint64_t inner_edge_blob_obj_id =
-          blob_info[i]["block_oid"].get<uint64_t>();
-      std::shared_ptr<vineyard::Blob> inner_edge_blob;
-      VINEYARD_CHECK_OK(
-          client_.GetBlob(inner_edge_blob_obj_id, true, inner_edge_blob));
-      inner_edge_blob_ptrs_[vlabel] = (char*) inner_edge_blob->data();
-
-      uint64_t outer_edge_blob_obj_id =
-          blob_info[i]["ov_block_oid"].get<uint64_t>();
-      std::shared_ptr<vineyard::Blob> outer_edge_blob;
-      VINEYARD_CHECK_OK(
-          client_.GetBlob(outer_edge_blob_obj_id, true, outer_edge_blob));
-      outer_edge_blob_ptrs_[vlabel] = (char*) outer_edge_blob->data();
+      inner_edge_extents_[vlabel] =
+          map_block_extents_(blob_info[i], "block_extents", "block_oid");
+      outer_edge_extents_[vlabel] = map_block_extents_(
+          blob_info[i], "ov_block_extents", "ov_block_oid");
 
       // init I(O)EDst
       idst_[vlabel].resize(edge_label_num_);
@@ -838,28 +820,38 @@ class GartFragment {
   }
 
  private:
+  // segment id -> the edge label block of the segment, in chunks
+  struct EdgeLabelPtrs {
+    std::vector<const uint64_t*> chunks;
+    size_t chunk_len;
+
+    inline uint64_t get(size_t seg_id) const {
+      return chunks[seg_id / chunk_len][seg_id % chunk_len];
+    }
+  };
+
   inline seggraph::VegitoSegmentHeader* locate_segment_(const vertex_t& v,
                                                         label_id_t e_label,
                                                         dir_t dir) const {
     uint64_t header_offset = 0;
     label_id_t label_id = vid_parser.GetLabelId(v.GetValue());
-    char* edge_blob_ptr = nullptr;
+    const seggraph::BlockExtents* extents = nullptr;
     if (IsInnerVertex(v)) {
       auto seg_id = vid_parser.GetOffset(v.GetValue()) / VERTEX_PER_SEG;
-      header_offset = inner_edge_label_ptrs_[label_id][seg_id];
-      edge_blob_ptr = inner_edge_blob_ptrs_[label_id];
+      header_offset = inner_edge_label_ptrs_[label_id].get(seg_id);
+      extents = inner_edge_extents_[label_id].get();
     } else {
       auto seg_id =
           (max_outer_id_offset_ - vid_parser.GetOffset(v.GetValue())) /
           VERTEX_PER_SEG;
-      header_offset = outer_edge_label_ptrs_[label_id][seg_id];
-      edge_blob_ptr = outer_edge_blob_ptrs_[label_id];
+      header_offset = outer_edge_label_ptrs_[label_id].get(seg_id);
+      extents = outer_edge_extents_[label_id].get();
     }
     if (header_offset == 0) {
       return nullptr;
     }
     auto edge_label_block =
-        (EdgeLabelBlockHeader*) (edge_blob_ptr + header_offset);
+        extents->convert<EdgeLabelBlockHeader>(header_offset);
     for (size_t i = 0; i < edge_label_block->get_num_entries(); i++) {
       auto label_entry = edge_label_block->get_entries()[i];
 
@@ -867,14 +859,67 @@ class GartFragment {
         if (label_entry.get_pointer(dir) == 0) {
           return nullptr;
         }
-        return (VegitoSegmentHeader*) (edge_blob_ptr +
-                                       label_entry.get_pointer(dir));
+        return extents->convert<VegitoSegmentHeader>(
+            label_entry.get_pointer(dir));
       }
     }
 
     return nullptr;
   }
 
+  // maps the chunks of the label array of segments described by `meta`
+  EdgeLabelPtrs map_edge_label_ptrs_(const vineyard::json& meta) {
+    EdgeLabelPtrs ptrs;
+    std::shared_ptr<vineyard::Blob> blob;
+    VINEYARD_CHECK_OK(
+        client_.GetBlob(meta["object_id"].get<uint64_t>(), true, blob));
+    if (!meta.contains("chunk_len")) {
+      // a single array of all segments
+      ptrs.chunks.push_back((const uint64_t*) blob->data());
+      ptrs.chunk_len = std::numeric_limits<size_t>::max();
+      return ptrs;
+    }
+
+    ptrs.chunk_len = meta["chunk_len"].get<size_t>();
+    auto chunk_oids = (const vineyard::ObjectID*) blob->data();
+    size_t max_chunks = meta["max_chunks"].get<size_t>();
+    for (size_t i = 0; i < max_chunks && chunk_oids[i] != 0; i++) {
+      std::shared_ptr<vineyard::Blob> chunk_blob;
+      VINEYARD_CHECK_OK(client_.GetBlob(chunk_oids[i], true, chunk_blob));
+      ptrs.chunks.push_back((const uint64_t*) chunk_blob->data());
+    }
+    return ptrs;
+  }
+
+  // maps the extents of blocks of a SegGraph listed in its schema, or the
+  // single blob of blocks of schemas without extents
+  std::shared_ptr<seggraph::BlockExtents> map_block_extents_(
+      const vineyard::json& schema, const std::string& extents_key,
+      const std::string& block_key) {
+    auto extents = std::make_shared<seggraph::BlockExtents>();
+    if (!schema.contains(extents_key)) {
+      std::shared_ptr<vineyard::Blob> blob;
+      VINEYARD_CHECK_OK(
+          client_.GetBlob(schema[block_key].get<uint64_t>(), true, blob));
+      extents->set_base(0, (char*) blob->data(), blob->size());
+      return extents;
+    }
+
+    std::shared_ptr<vineyard::Blob> table_blob;
+    VINEYARD_CHECK_OK(client_.GetBlob(
+        schema[extents_key]["object_id"].get<uint64_t>(), true, table_blob));
+    auto extent_oids = (const vineyard::ObjectID*) table_blob->data();
+    size_t num_extents = schema[extents_key]["len_ele"].get<uint64_t>();
+    // extents added after the epoch to read are mapped as well, but no block
+    // of the epoch lives in them
+    for (size_t i = 0; i < num_extents && extent_oids[i] != 0; i++) {
+      std::shared_ptr<vineyard::Blob> blob;
+      VINEYARD_CHECK_OK(client_.GetBlob(extent_oids[i], true, blob));
+      extents->set_base(i, (char*) blob->data(), blob->size());
+    }
+    return extents;
+  }
+
   inline gart::EdgeIterator get_edges_in_seg_(VegitoSegmentHeader* segment,
                                               const vertex_t& v,
                                               size_t edge_prop_size,
@@ -884,23 +929,23 @@ class GartFragment {
                                 read_epoch_number_, nullptr);
     }
     label_id_t label_id = vid_parser.GetLabelId(v.GetValue());
-    char* edge_blob_ptr = nullptr;
+    const seggraph::BlockExtents* extents = nullptr;
     uint64_t seg_idx = 0;
     if (IsInnerVertex(v)) {
       seg_idx = vid_parser.GetOffset(v.GetValue()) % VERTEX_PER_SEG;
-      edge_blob_ptr = inner_edge_blob_ptrs_[label_id];
+      extents = inner_edge_extents_[label_id].get();
     } else {
       seg_idx = (max_outer_id_offset_ - vid_parser.GetOffset(v.GetValue())) %
                 VERTEX_PER_SEG;
-      edge_blob_ptr = outer_edge_blob_ptrs_[label_id];
+      extents = outer_edge_extents_[label_id].get();
     }
     auto epoch_table_offset = segment->get_epoch_table(seg_idx);
     EpochBlockHeader* epoch_table =
-        (EpochBlockHeader*) (edge_blob_ptr + epoch_table_offset);
+        extents->convert<EpochBlockHeader>(epoch_table_offset);
 
     auto edge_block_offset = segment->get_region_ptr(seg_idx);
     VegitoEdgeBlockHeader* edge_block =
-        (VegitoEdgeBlockHeader*) (edge_blob_ptr + edge_block_offset);
+        extents->convert<VegitoEdgeBlockHeader>(edge_block_offset);
     if (!epoch_table || !edge_block || epoch_table_offset == 0 ||
         edge_block_offset == 0) {
       return gart::EdgeIterator(nullptr, nullptr, nullptr, nullptr, 0, 0,
@@ -913,7 +958,7 @@ class GartFragment {
                                 read_epoch_number_, nullptr);
     }
 
-    return gart::EdgeIterator(segment, edge_block, epoch_table, edge_blob_ptr,
+    return gart::EdgeIterator(segment, edge_block, epoch_table, extents,
                               num_entries, edge_prop_size, read_epoch_number_,
                               prop_offsets);
   }
@@ -1039,9 +1084,10 @@ class GartFragment {
   std::vector<size_t> valid_ovl2g_element_;
   std::vector<vineyard::Hashmap<vid_t, vid_t>*> ovg2l_maps_;
 
-  std::vector<uint64_t*> inner_edge_label_ptrs_;
-  std::vector<uint64_t*> outer_edge_label_ptrs_;
-  std::vector<char*> inner_edge_blob_ptrs_, outer_edge_blob_ptrs_;
+  std::vector<EdgeLabelPtrs> inner_edge_label_ptrs_;
+  std::vector<EdgeLabelPtrs> outer_edge_label_ptrs_;
+  std::vector<std::shared_ptr<seggraph::BlockExtents>> inner_edge_extents_,
+      outer_edge_extents_;
 
   std::vector<std::vector<std::vector<fid_t>>> idst_, odst_, iodst_;
   std::vector<std::vector<std::vector<fid_t*>>> idoffset_, odoffset_,
@@ -214,10 +214,12 @@ class EdgeIterator {
   using VegitoSegmentHeader = seggraph::VegitoSegmentHeader;
   using EdgeLabelBlockHeader = seggraph::EdgeLabelBlockHeader;
   using VegitoEdgeEntry = seggraph::VegitoEdgeEntry;
+  using EdgeDeletionBitmap = seggraph::EdgeDeletionBitmap;
 
   EdgeIterator(VegitoSegmentHeader* seg_header,
                VegitoEdgeBlockHeader* edge_block_header,
-               EpochBlockHeader* epoch_table_header, char* edge_blob_ptr,
+               EpochBlockHeader* epoch_table_header,
+               const seggraph::BlockExtents* extents,
                size_t num_entries, size_t edge_prop_size,
                size_t read_epoch_number, int* prop_offsets) {
     prop_offsets_ = prop_offsets;
@@ -227,13 +229,17 @@ class EdgeIterator {
     num_entries_ = num_entries;
     edge_prop_size_ = edge_prop_size;
     read_epoch_number_ = read_epoch_number;
-    edge_blob_ptr_ = edge_blob_ptr;
+    extents_ = extents;
     if (edge_block_header && epoch_table_header) {
       init();
-      find_next_valid_cursor();
       seg_block_size_ = seg_header->get_block_size();
-      edge_prop_offset_ =
-          seg_header->get_allocated_edge_num((uintptr_t) edge_block_header_);
+      if (edge_block_header_) {
+        edge_prop_offset_ =
+            seg_header->get_allocated_edge_num((uintptr_t) edge_block_header_);
+        deletions_ = edge_block_header_->get_deletion_bitmap(
+            *extents_, read_epoch_number_);
+      }
+      find_next_valid_cursor();
     }
   }
 
@@ -269,9 +275,8 @@ class EdgeIterator {
     } else {
       while (edge_block_header_->get_prev_num_entries() >=
              (uint64_t) read_end_offset) {
-        edge_block_header_ =
-            (VegitoEdgeBlockHeader*) (edge_block_header_->get_prev_pointer() +
-                                      edge_blob_ptr_);
+        edge_block_header_ = extents_->convert<VegitoEdgeBlockHeader>(
+            edge_block_header_->get_prev_pointer());
       }
 
       auto offset =
@@ -324,53 +329,30 @@ class EdgeIterator {
            (edge_prop_offset_ + entries_ - entries_cursor_) * edge_prop_size_;
   }
 
+  // skips the edges deleted as of read_epoch_number_
   void find_next_valid_cursor() {
     if ((entries_cursor_ == nullptr) && (entries_ == nullptr)) {
       return;
     }
-    bool is_founded = false;
     while (true) {
       while (entries_cursor_ != entries_) {
-        vid_t vid = entries_cursor_->get_dst();
-        auto delete_flag = vid >> (sizeof(vid_t) * 8 - 1);
-        if (delete_flag == 1) {
-          auto delete_offset_mask =
-              (((vid_t) 1) << (sizeof(vid_t) * 8 - 1)) - (vid_t) 1;
-          auto delete_offset = vid & delete_offset_mask;
-          delete_offsets_.push(delete_offset);
-        } else if (delete_flag == 0) {
-          if (delete_offsets_.empty()) {
-            is_founded = true;
-            break;
-          } else if (delete_offsets_.top() !=
-                     ((entries_ - entries_cursor_ - 1) +
-                      edge_block_header_->get_prev_num_entries())) {
-            is_founded = true;
-            break;
-          } else {
-            delete_offsets_.pop();
-          }
+        if (!deletions_ || !deletions_->test(entries_ - entries_cursor_ - 1)) {
+          return;
         }
         entries_cursor_++;
       }
-      if (is_founded) {
-        break;
-      }
       if (!edge_block_header_->get_prev_pointer()) {
         break;
       }
-      edge_block_header_ =
-          (VegitoEdgeBlockHeader*) (edge_block_header_->get_prev_pointer() +
-                                    edge_blob_ptr_);
-      if (!edge_block_header_) {
-        break;
-      } else {
-        auto num_entries = edge_block_header_->get_num_entries();
-        entries_ = edge_block_header_->get_entries();
-        entries_cursor_ = entries_ - num_entries;  // at the begining
-        edge_prop_offset_ =
-            seg_header_->get_allocated_edge_num((uintptr_t) edge_block_header_);
-      }
+      edge_block_header_ = extents_->convert<VegitoEdgeBlockHeader>(
+          edge_block_header_->get_prev_pointer());
+      auto num_entries = edge_block_header_->get_num_entries();
+      entries_ = edge_block_header_->get_entries();
+      entries_cursor_ = entries_ - num_entries;  // at the begining
+      edge_prop_offset_ =
+          seg_header_->get_allocated_edge_num((uintptr_t) edge_block_header_);
+      deletions_ = edge_block_header_->get_deletion_bitmap(*extents_,
+                                                           read_epoch_number_);
     }
   }
 
@@ -388,7 +370,7 @@ class EdgeIterator {
   VegitoSegmentHeader* seg_header_;
   VegitoEdgeBlockHeader* edge_block_header_;
   EpochBlockHeader* epoch_table_header_;
-  char* edge_blob_ptr_;  // for switch block
+  const seggraph::BlockExtents* extents_;  // for switch block
 
   VegitoEdgeEntry* entries_cursor_ = nullptr;
   VegitoEdgeEntry* entries_ = nullptr;
@@ -398,7 +380,7 @@ class EdgeIterator {
 
   int64_t read_epoch_number_;
 
-  std::priority_queue<size_t> delete_offsets_;
+  const EdgeDeletionBitmap* deletions_ = nullptr;
   // for edge property
   size_t seg_block_size_;
   size_t edge_prop_offset_;
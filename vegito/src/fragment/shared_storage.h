@@ -166,6 +166,33 @@ struct ArrayMeta {
   uint64_t len_ele;  // size of array in number of elements
 };
 
+// An array in chunks of `chunk_len` elements, see seggraph::SegmentedArray.
+// The Blob lists the object ids of `max_chunks` chunks, 0 for chunks not
+// added yet, so the array is read as chunks[i / chunk_len][i % chunk_len]
+struct ChunkedArrayMeta {
+  ChunkedArrayMeta() {}
+
+  ChunkedArrayMeta(oid_t id, uint64_t chunk_len, uint64_t max_chunks)
+      : object_id(id), chunk_len(chunk_len), max_chunks(max_chunks) {}
+
+  oid_t get_object_id() const { return object_id; }
+
+  vineyard::json json() const {
+    using json = vineyard::json;
+    json res;
+    res["object_id"] = object_id;
+    res["chunk_len"] = chunk_len;
+    res["max_chunks"] = max_chunks;
+
+    return res;
+  }
+
+ private:
+  oid_t object_id;  // Blob of the object ids of chunks
+  uint64_t chunk_len;
+  uint64_t max_chunks;
+};
+
 // Meta for each vertex property (column)
 struct VPropMeta {
   VPropMeta() {}
@@ -213,11 +240,19 @@ class BlobSchema {
 
   void set_block_oid(oid_t oid) { block_oid = oid; }
 
-  void set_elabel2segs(const ArrayMeta& meta) { elabel2seg = meta; }
+  void set_block_extents(const ArrayMeta& meta) { block_extents = meta; }
+
+  void set_elabel2segs(const ChunkedArrayMeta& meta) { elabel2seg = meta; }
 
   void set_ov_block_oid(oid_t oid) { ov_block_oid = oid; }
 
-  void set_ov_elabel2segs(const ArrayMeta& meta) { ov_elabel2seg = meta; }
+  void set_ov_block_extents(const ArrayMeta& meta) {
+    ov_block_extents = meta;
+  }
+
+  void set_ov_elabel2segs(const ChunkedArrayMeta& meta) {
+    ov_elabel2seg = meta;
+  }
 
   void set_vtable_meta(const VTableMeta& meta) { vertex_table = meta; }
 
@@ -235,11 +270,13 @@ class BlobSchema {
 
   oid_t get_block_oid() const { return block_oid; }
 
+  const ArrayMeta& get_block_extents() const { return block_extents; }
+
   oid_t get_vertex_table_oid() const { return vertex_table.get_object_id(); }
 
   oid_t get_ovl2g_oid() const { return ovl2g.get_object_id(); }
 
-  const ArrayMeta& get_elabel2segs() const { return elabel2seg; }
+  const ChunkedArrayMeta& get_elabel2segs() const { return elabel2seg; }
 
   vineyard::json json() const {
     using json = vineyard::json;
@@ -247,6 +284,7 @@ class BlobSchema {
     json single_blob_schema;
     single_blob_schema["vlabel"] = vlabel;
     single_blob_schema["block_oid"] = block_oid;
+    single_blob_schema["block_extents"] = block_extents.json();
     single_blob_schema["elabel2seg"] = elabel2seg.json();
     single_blob_schema["num_vprops"] = vprops.size();
 
@@ -258,6 +296,7 @@ class BlobSchema {
 
     single_blob_schema["vprops"] = vprop_schema;
     single_blob_schema["ov_block_oid"] = ov_block_oid;
+    single_blob_schema["ov_block_extents"] = ov_block_extents.json();
     single_blob_schema["ov_elabel2seg"] = ov_elabel2seg.json();
     single_blob_schema["vertex_table"] = vertex_table.json();
     single_blob_schema["ovl2g"] = ovl2g.json();
@@ -268,14 +307,16 @@ class BlobSchema {
  private:
   uint64_t vlabel;
 
-  oid_t block_oid;       // Blob of blocks created by BlockManger
-  ArrayMeta elabel2seg;  // indexed by vertex label
+  oid_t block_oid;              // the first extent of BlockManger
+  ArrayMeta block_extents;      // object ids of all extents, 0 if unused
+  ChunkedArrayMeta elabel2seg;  // indexed by segment id
 
   // uint64_t num_vprops;
   std::vector<VPropMeta> vprops;
 
   oid_t ov_block_oid;
-  ArrayMeta ov_elabel2seg;
+  ArrayMeta ov_block_extents;
+  ChunkedArrayMeta ov_elabel2seg;
 
   VTableMeta vertex_table;  // indexed by vertex label
   ArrayMeta ovl2g;          // indexed by vertex label, array
@@ -0,0 +1,464 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_FRAGMENT_UNIFIED_LOG_H_
+#define VEGITO_SRC_FRAGMENT_UNIFIED_LOG_H_
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace gart {
+
+/**
+ * UnifiedLog is the record format between the converter and the writer.
+ *
+ * Two encodings are accepted by the writer:
+ *
+ * - text:   "op|epoch|..." pipe-delimited, kept for tests and debugging
+ *           (e.g., vegito/test/data/test_graph.txt)
+ * - binary: a length-prefixed record, which is produced by binlog_convert
+ *           by default and is decoded without any string allocation
+ *
+ * Binary record layout (host byte order, no padding):
+ *
+ *   UnifiedLogHeader (20 bytes)
+ *   add_vertex / delete_vertex : gid (u64)
+ *   add_edge / delete_edge     : elabel (i32) src_gid (u64) dst_gid (u64)
+ *   update_vertex              : gid (u64)
+ *   epoch                      : nothing, marks the start of an epoch
+ *   properties, in the property order of the label, each one is
+ *     tag (u8) followed by i64 | f64 | u32 length + bytes | nothing (null)
+ *
+ * An update_vertex log only carries the changed properties, as pairs of
+ * fields: the property index (i64), then the new value.
+ *
+ * The first byte of a binary record is kUnifiedLogMagic, which never starts
+ * a text record, so both encodings can share one topic.
+ *
+ * A Kafka message holds one text record, or binary records back to back,
+ * see ForEachUnifiedLog.
+ */
+
+constexpr uint8_t kUnifiedLogMagic = 0xC7;
+constexpr uint8_t kUnifiedLogVersion = 1;
+
+enum class LogOp : uint8_t {
+  kInvalid = 0,
+  kAddVertex = 1,
+  kAddEdge = 2,
+  kDeleteVertex = 3,
+  kDeleteEdge = 4,
+  kEpoch = 5,
+  kUpdateVertex = 6,
+};
+
+enum class LogFieldType : uint8_t {
+  kNull = 0,
+  kInt64 = 1,
+  kDouble = 2,
+  kString = 3,
+};
+
+#pragma pack(push, 1)
+struct UnifiedLogHeader {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t op;
+  uint8_t reserved;
+  uint16_t num_props;
+  uint16_t flags;
+  uint32_t length;  // total bytes of the record, including this header
+  uint64_t epoch;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(UnifiedLogHeader) == 20,
+              "UnifiedLogHeader is part of the wire format");
+
+/** A single property value of a log, pointing into the record buffer. */
+struct LogField {
+  LogFieldType type = LogFieldType::kNull;
+  int64_t i = 0;
+  double d = 0;
+  std::string_view s;
+
+  int64_t as_int64() const {
+    if (type == LogFieldType::kInt64) {
+      return i;
+    } else if (type == LogFieldType::kDouble) {
+      return static_cast<int64_t>(d);
+    } else if (type == LogFieldType::kString) {
+      int64_t ret = 0;
+      std::from_chars(s.data(), s.data() + s.size(), ret);
+      return ret;
+    }
+    return 0;
+  }
+
+  double as_double() const {
+    if (type == LogFieldType::kDouble) {
+      return d;
+    } else if (type == LogFieldType::kInt64) {
+      return static_cast<double>(i);
+    } else if (type == LogFieldType::kString) {
+      // string_view is not null-terminated, copy to the stack for strtod
+      char buf[64];
+      size_t n = s.size() < sizeof(buf) - 1 ? s.size() : sizeof(buf) - 1;
+      memcpy(buf, s.data(), n);
+      buf[n] = '\0';
+      return strtod(buf, nullptr);
+    }
+    return 0;
+  }
+};
+
+/**
+ * Sequential reader of the property fields of a log. For text logs each
+ * field is reported as a string, and is converted on demand.
+ */
+class LogFieldReader {
+ public:
+  LogFieldReader() = default;
+  LogFieldReader(const char* begin, const char* end, bool binary)
+      : cur_(begin), end_(end), binary_(binary) {}
+
+  bool next(LogField& field) {
+    if (cur_ == nullptr || cur_ >= end_) {
+      return false;
+    }
+    if (!binary_) {
+      const char* sep =
+          static_cast<const char*>(memchr(cur_, '|', end_ - cur_));
+      const char* stop = sep ? sep : end_;
+      field.type = LogFieldType::kString;
+      field.s = std::string_view(cur_, stop - cur_);
+      cur_ = sep ? sep + 1 : end_;
+      return true;
+    }
+
+    field.type = static_cast<LogFieldType>(*cur_++);
+    field.s = std::string_view();
+    switch (field.type) {
+    case LogFieldType::kInt64:
+      if (!has_bytes_(sizeof(int64_t))) {
+        return false;
+      }
+      memcpy(&field.i, cur_, sizeof(int64_t));
+      cur_ += sizeof(int64_t);
+      break;
+    case LogFieldType::kDouble:
+      if (!has_bytes_(sizeof(double))) {
+        return false;
+      }
+      memcpy(&field.d, cur_, sizeof(double));
+      cur_ += sizeof(double);
+      break;
+    case LogFieldType::kString: {
+      uint32_t len;
+      if (!has_bytes_(sizeof(uint32_t))) {
+        return false;
+      }
+      memcpy(&len, cur_, sizeof(uint32_t));
+      cur_ += sizeof(uint32_t);
+      if (!has_bytes_(len)) {
+        return false;
+      }
+      field.s = std::string_view(cur_, len);
+      cur_ += len;
+      break;
+    }
+    default:
+      field.type = LogFieldType::kNull;
+      break;
+    }
+    return true;
+  }
+
+  const char* position() const { return cur_; }
+
+ private:
+  // a truncated field ends the reader
+  bool has_bytes_(size_t n) {
+    if (static_cast<size_t>(end_ - cur_) < n) {
+      cur_ = end_;
+      return false;
+    }
+    return true;
+  }
+
+  const char* cur_ = nullptr;
+  const char* end_ = nullptr;
+  bool binary_ = false;
+};
+
+struct LogEntry;
+inline bool ParseUnifiedLog(const char* data, size_t len, LogEntry& entry);
+
+/** Decoded view of one UnifiedLog, valid while the record buffer lives. */
+struct LogEntry {
+  LogOp op = LogOp::kInvalid;
+  uint64_t epoch = 0;
+  uint64_t vid = 0;  // add_vertex / delete_vertex / update_vertex
+  int elabel = 0;    // add_edge / delete_edge
+  uint64_t src_vid = 0;
+  uint64_t dst_vid = 0;
+  std::string_view op_name;  // for error reports of text logs
+
+  LogFieldReader fields() const {
+    return LogFieldReader(props_, end_, binary_);
+  }
+
+  bool is_binary() const { return binary_; }
+
+ private:
+  const char* props_ = nullptr;
+  const char* end_ = nullptr;
+  bool binary_ = false;
+
+  friend bool ParseUnifiedLog(const char*, size_t, LogEntry&);
+};
+
+inline bool IsBinaryUnifiedLog(const char* data, size_t len) {
+  return len >= sizeof(UnifiedLogHeader) &&
+         static_cast<uint8_t>(data[0]) == kUnifiedLogMagic;
+}
+
+/** Returns the byte size of the binary record starting at data, or 0. */
+inline size_t UnifiedLogRecordSize(const char* data, size_t len) {
+  if (!IsBinaryUnifiedLog(data, len)) {
+    return 0;
+  }
+  UnifiedLogHeader header;
+  memcpy(&header, data, sizeof(header));
+  return header.length <= len ? header.length : 0;
+}
+
+/**
+ * Calls fn(record) for each record of a Kafka message. Returns false if the
+ * message ends in a truncated binary record.
+ */
+template <typename Fn>
+inline bool ForEachUnifiedLog(std::string_view msg, Fn fn) {
+  if (!IsBinaryUnifiedLog(msg.data(), msg.size())) {
+    fn(msg);
+    return true;
+  }
+  while (!msg.empty()) {
+    size_t size = UnifiedLogRecordSize(msg.data(), msg.size());
+    if (size < sizeof(UnifiedLogHeader)) {
+      return false;
+    }
+    fn(msg.substr(0, size));
+    msg.remove_prefix(size);
+  }
+  return true;
+}
+
+// binary UnifiedLogs of a fragment written by a bulk load, back to back
+inline std::string BulkLoadFileName(int fid) {
+  return "fragment_" + std::to_string(fid) + ".ulog";
+}
+
+inline LogOp ParseLogOp(std::string_view op) {
+  if (op == "add_vertex") {
+    return LogOp::kAddVertex;
+  } else if (op == "add_edge") {
+    return LogOp::kAddEdge;
+  } else if (op == "delete_vertex") {
+    return LogOp::kDeleteVertex;
+  } else if (op == "delete_edge") {
+    return LogOp::kDeleteEdge;
+  } else if (op == "epoch") {
+    return LogOp::kEpoch;
+  } else if (op == "update_vertex") {
+    return LogOp::kUpdateVertex;
+  }
+  return LogOp::kInvalid;
+}
+
+/**
+ * Parse one log (binary or text) into entry. The entry keeps pointers into
+ * data, no copy is made. Returns false if the log is malformed.
+ */
+inline bool ParseUnifiedLog(const char* data, size_t len, LogEntry& entry) {
+  const char* end = data + len;
+  // a malformed log never leaves a valid op behind
+  entry.op = LogOp::kInvalid;
+  if (IsBinaryUnifiedLog(data, len)) {
+    UnifiedLogHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != kUnifiedLogVersion || header.length > len ||
+        header.length < sizeof(header)) {
+      return false;
+    }
+    end = data + header.length;
+    const char* cur = data + sizeof(header);
+    LogOp op = static_cast<LogOp>(header.op);
+    entry.epoch = header.epoch;
+    entry.binary_ = true;
+    switch (op) {
+    case LogOp::kAddVertex:
+    case LogOp::kDeleteVertex:
+    case LogOp::kUpdateVertex:
+      if (cur + sizeof(uint64_t) > end) {
+        return false;
+      }
+      memcpy(&entry.vid, cur, sizeof(uint64_t));
+      cur += sizeof(uint64_t);
+      break;
+    case LogOp::kAddEdge:
+    case LogOp::kDeleteEdge: {
+      if (cur + sizeof(int32_t) + 2 * sizeof(uint64_t) > end) {
+        return false;
+      }
+      int32_t elabel;
+      memcpy(&elabel, cur, sizeof(int32_t));
+      cur += sizeof(int32_t);
+      entry.elabel = elabel;
+      memcpy(&entry.src_vid, cur, sizeof(uint64_t));
+      cur += sizeof(uint64_t);
+      memcpy(&entry.dst_vid, cur, sizeof(uint64_t));
+      cur += sizeof(uint64_t);
+      break;
+    }
+    case LogOp::kEpoch:
+      break;
+    default:
+      return false;
+    }
+    entry.op = op;
+    entry.props_ = cur;
+    entry.end_ = end;
+    return true;
+  }
+
+  // text format
+  entry.binary_ = false;
+  LogFieldReader reader(data, end, false);
+  LogField field;
+  if (!reader.next(field)) {
+    return false;
+  }
+  entry.op_name = field.s;
+  LogOp op = ParseLogOp(field.s);
+  if (!reader.next(field)) {
+    return false;
+  }
+  entry.epoch = static_cast<uint64_t>(field.as_int64());
+
+  int num_ids = 0;
+  if (op == LogOp::kAddVertex || op == LogOp::kDeleteVertex ||
+      op == LogOp::kUpdateVertex) {
+    num_ids = 1;
+  } else if (op == LogOp::kAddEdge || op == LogOp::kDeleteEdge) {
+    num_ids = 3;
+  }
+  uint64_t ids[3] = {0, 0, 0};
+  for (int idx = 0; idx < num_ids; idx++) {
+    if (!reader.next(field)) {
+      return false;
+    }
+    ids[idx] = static_cast<uint64_t>(field.as_int64());
+  }
+  if (num_ids == 1) {
+    entry.vid = ids[0];
+  } else if (num_ids == 3) {
+    entry.elabel = static_cast<int>(ids[0]);
+    entry.src_vid = ids[1];
+    entry.dst_vid = ids[2];
+  }
+  entry.op = op;
+  entry.props_ = reader.position();
+  entry.end_ = end;
+  return true;
+}
+
+/**
+ * Builder of binary UnifiedLog records, used by the converter. The buffer is
+ * reused across records to avoid allocation in the steady state.
+ */
+class UnifiedLogBuilder {
+ public:
+  void Begin(LogOp op, uint64_t epoch) {
+    buf_.clear();
+    UnifiedLogHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = kUnifiedLogMagic;
+    header.version = kUnifiedLogVersion;
+    header.op = static_cast<uint8_t>(op);
+    header.epoch = epoch;
+    append(&header, sizeof(header));
+    num_props_ = 0;
+  }
+
+  void PutVertex(uint64_t gid) { append(&gid, sizeof(gid)); }
+
+  void PutEdge(int32_t elabel, uint64_t src_gid, uint64_t dst_gid) {
+    append(&elabel, sizeof(elabel));
+    append(&src_gid, sizeof(src_gid));
+    append(&dst_gid, sizeof(dst_gid));
+  }
+
+  void PutInt64(int64_t val) {
+    put_tag(LogFieldType::kInt64);
+    append(&val, sizeof(val));
+  }
+
+  void PutDouble(double val) {
+    put_tag(LogFieldType::kDouble);
+    append(&val, sizeof(val));
+  }
+
+  void PutString(std::string_view val) {
+    put_tag(LogFieldType::kString);
+    uint32_t len = static_cast<uint32_t>(val.size());
+    append(&len, sizeof(len));
+    append(val.data(), val.size());
+  }
+
+  void PutNull() { put_tag(LogFieldType::kNull); }
+
+  /** Patch the header and return the finished record. */
+  const std::string& Finish() {
+    uint32_t length = static_cast<uint32_t>(buf_.size());
+    memcpy(&buf_[offsetof(UnifiedLogHeader, length)], &length, sizeof(length));
+    memcpy(&buf_[offsetof(UnifiedLogHeader, num_props)], &num_props_,
+           sizeof(num_props_));
+    return buf_;
+  }
+
+ private:
+  void append(const void* data, size_t size) {
+    buf_.append(static_cast<const char*>(data), size);
+  }
+
+  void put_tag(LogFieldType type) {
+    uint8_t tag = static_cast<uint8_t>(type);
+    append(&tag, sizeof(tag));
+    num_props_++;
+  }
+
+  std::string buf_;
+  uint16_t num_props_ = 0;
+};
+
+}  // namespace gart
+
+#endif  // VEGITO_SRC_FRAGMENT_UNIFIED_LOG_H_
@@ -15,13 +15,24 @@
 
 #include "framework/bench_runner.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <filesystem>
 #include <fstream>
+#include <thread>
 
+#include "fragment/unified_log.h"
+#include "framework/bulk_loader.h"
 #include "graph/graph_ops/process_add_edge.h"
 #include "graph/graph_ops/process_add_vertex.h"
 #include "graph/graph_ops/process_del_edge.h"
 #include "graph/graph_ops/process_del_vertex.h"
-#include "librdkafka/rdkafkacpp.h"
+#include "graph/graph_ops/process_update_vertex.h"
+#include "util/kafka_consumer.h"
+#include "util/shm_ring.h"
 
 namespace gart {
 namespace framework {
@@ -279,138 +290,384 @@ void init_graph_schema(std::string graph_schema_path,
   }
   graph_store->set_schema(graph_schema);
   graph_store->update_property_bytes();
+  graph_store->compile_prop_decoders();
 }
 
-void Runner::apply_log_to_store_(std::string log, int p_id) {
-  std::istringstream strstr(log);
-  std::string word;
-  std::vector<std::string> cmd;
-  int word_idx = 0;
-  std::string op;
-  while (getline(strstr, word, '|')) {
-    if (word_idx == 0) {
-      op = word;
-    } else {
-      if (word_idx == 1) {
-        int cur_epoch = stoi(word);
-        if (cur_epoch > latest_epoch_) {
-          graph_stores_[p_id]->update_blob(latest_epoch_);
-          graph_stores_[p_id]->insert_blob_schema(latest_epoch_);
-          graph_stores_[p_id]->get_blob_json(
-              latest_epoch_);  // put schema to etcd
-          std::cout << "update epoch " << latest_epoch_ << " frag = " << p_id
-                    << std::endl;
-          latest_epoch_ = cur_epoch;
-        }
-      }
-      cmd.push_back(word);
-    }
-    word_idx++;
+void Runner::apply_log_to_store_(std::string_view log, int p_id,
+                                 int64_t source_offset) {
+  LogEntry entry;
+  if (!ParseUnifiedLog(log.data(), log.size(), entry)) {
+    LOG(ERROR) << "Malformed unified log of size " << log.size();
+    return;
+  }
+
+  advance_epoch_(entry.epoch, p_id, source_offset);
+
+  std::chrono::steady_clock::time_point start;
+  if (observer_) {
+    start = std::chrono::steady_clock::now();
   }
-  if (op == "add_vertex") {
-    process_add_vertex(cmd, graph_stores_[p_id]);
-  } else if (op == "add_edge") {
-    process_add_edge(cmd, graph_stores_[p_id]);
-  } else if (op == "delete_vertex") {
-    process_del_vertex(cmd, graph_stores_[p_id]);
-  } else if (op == "delete_edge") {
-    process_del_edge(cmd, graph_stores_[p_id]);
-  } else {
-    LOG(ERROR) << "Unsupported operator " << op;
+  bool local = true;
+  switch (entry.op) {
+  case LogOp::kAddVertex:
+    local = process_add_vertex(entry, graph_stores_[p_id]);
+    break;
+  case LogOp::kAddEdge:
+    local = process_add_edge(entry, graph_stores_[p_id]);
+    break;
+  case LogOp::kDeleteVertex:
+    local = process_del_vertex(entry, graph_stores_[p_id]);
+    break;
+  case LogOp::kDeleteEdge:
+    process_del_edge(entry, graph_stores_[p_id]);
+    break;
+  case LogOp::kUpdateVertex:
+    local = process_update_vertex(entry, graph_stores_[p_id]);
+    break;
+  case LogOp::kEpoch:
+    break;
+  default:
+    LOG(ERROR) << "Unsupported operator " << entry.op_name;
+    return;
+  }
+  metrics_->partition(p_id)->CountLog(entry.op, local);
+  if (observer_) {
+    observer_->OnLogApplied(p_id, entry.op,
+                            std::chrono::steady_clock::now() - start);
   }
 }
 
-void Runner::start_kafka_to_process_(int p_id) {
-  std::cout << "start_kafka_to_process_" << std::endl;
-  RdKafka::Conf* conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
-  std::string rdkafka_err;
-  if (conf->set("metadata.broker.list", FLAGS_kafka_broker_list, rdkafka_err) !=
-      RdKafka::Conf::CONF_OK) {
-    LOG(WARNING) << "Failed to set metadata.broker.list: " << rdkafka_err;
+void Runner::advance_epoch_(uint64_t epoch, int p_id, int64_t source_offset) {
+  uint64_t& latest_epoch = latest_epochs_[p_id];
+  if (epoch <= latest_epoch) {
+    return;
   }
-  if (conf->set("group.id", "gart_consumer", rdkafka_err) !=
-      RdKafka::Conf::CONF_OK) {
-    LOG(WARNING) << "Failed to set group.id: " << rdkafka_err;
-  }
-  if (conf->set("enable.auto.commit", "false", rdkafka_err) !=
-      RdKafka::Conf::CONF_OK) {
-    LOG(WARNING) << "Failed to set enable.auto.commit: " << rdkafka_err;
+  // compaction retires blocks in the epoch being written, which must be
+  // ahead of the published ones
+  auto compaction = compactors_[p_id]->Pause();
+  compactors_[p_id]->set_write_epoch(epoch);
+
+  graph_stores_[p_id]->update_blob(latest_epoch);
+  // epochs without logs of this fragment share the same snapshot, they are
+  // published as well since readers pick the minimum epoch of fragments
+  for (uint64_t e = latest_epoch; e < epoch; e++) {
+    graph_stores_[p_id]->insert_blob_schema(e);
+    // put schema to etcd in the background
+    epoch_publishers_[p_id]->Publish(e);
   }
-  if (conf->set("auto.offset.reset", "earliest", rdkafka_err) !=
-      RdKafka::Conf::CONF_OK) {
-    LOG(WARNING) << "Failed to set auto.offset.reset: " << rdkafka_err;
+  latest_epoch = epoch;
+
+  // writers are quiescent here, in both the inline and pipeline modes
+  PartitionMetrics* metrics = metrics_->partition(p_id);
+  auto now = std::chrono::steady_clock::now();
+  metrics->epoch_apply.Record(now - epoch_start_times_[p_id]);
+  epoch_start_times_[p_id] = now;
+  metrics->latest_epoch = epoch;
+  graph::GraphStore::StorageStats stats =
+      graph_stores_[p_id]->get_storage_stats();
+  metrics->block_used_bytes = stats.block_used_bytes;
+  metrics->block_free_bytes = stats.block_free_bytes;
+  metrics->prop_page_allocs = stats.prop_page_allocs;
+
+  // logs before `source_offset` are all applied, so it is where to restart
+  if (!FLAGS_checkpoint_dir.empty() && source_offset >= 0 &&
+      epoch >= checkpoint_epochs_[p_id] + FLAGS_checkpoint_epoch_interval) {
+    if (graph_stores_[p_id]->save_checkpoint(checkpoint_path_(p_id), epoch,
+                                             source_offset)) {
+      checkpoint_epochs_[p_id] = epoch;
+      std::cout << "checkpoint epoch " << epoch << " frag = " << p_id
+                << " offset = " << source_offset << std::endl;
+      if (shm_consumers_[p_id]) {
+        shm_consumers_[p_id]->Commit(source_offset);
+      }
+    }
   }
+}
+
+std::string Runner::checkpoint_path_(int p_id) const {
+  return FLAGS_checkpoint_dir + "/gart_checkpoint_p" + std::to_string(p_id);
+}
 
-  RdKafka::Consumer* consumer = RdKafka::Consumer::create(conf, rdkafka_err);
+int64_t Runner::recover_from_checkpoint_(int p_id) {
+  if (FLAGS_checkpoint_dir.empty() ||
+      !std::filesystem::exists(checkpoint_path_(p_id))) {
+    return -1;  // start from the beginning of the log stream
+  }
 
-  if (!consumer) {
-    LOG(INFO) << "Failed to create consumer: " << rdkafka_err;
+  uint64_t epoch;
+  int64_t source_offset;
+  if (!graph_stores_[p_id]->load_checkpoint(checkpoint_path_(p_id), epoch,
+                                            source_offset)) {
+    LOG(ERROR) << "Recover partition " << p_id << " from checkpoint failed.";
     exit(1);
   }
+  printf("[Runner] Recover partition %d at epoch %lu, offset %ld\n", p_id,
+         epoch, source_offset);
 
-  RdKafka::Conf* tconf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
+  // blobs are rebuilt by this process, so republish the last complete epoch
+  latest_epochs_[p_id] = epoch;
+  checkpoint_epochs_[p_id] = epoch;
+  if (epoch > 0) {
+    graph_stores_[p_id]->update_blob(epoch - 1);
+    graph_stores_[p_id]->insert_blob_schema(epoch - 1);
+    epoch_publishers_[p_id]->Publish(epoch - 1);
+  }
+  return source_offset;
+}
 
-  RdKafka::Topic* topic = RdKafka::Topic::create(
-      consumer, FLAGS_kafka_unified_log_topic, tconf, rdkafka_err);
-  int32_t partition = 0;
-  int64_t start_offset = RdKafka::Topic::OFFSET_BEGINNING;
+void Runner::bulk_load_(int p_id) {
+  std::string path = FLAGS_bulk_load_dir + "/" + BulkLoadFileName(p_id);
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    LOG(ERROR) << "Bulk load file (" << path << ") open failed.";
+    exit(1);
+  }
+  // the dump may be larger than the memory, let the page cache hold it
+  size_t size = st.st_size;
+  void* addr = nullptr;
+  if (size > 0) {
+    addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+      LOG(ERROR) << "Bulk load file (" << path << ") mmap failed.";
+      exit(1);
+    }
+  }
+  close(fd);
 
-  RdKafka::ErrorCode resp = consumer->start(topic, partition, start_offset);
-  if (resp != RdKafka::ERR_NO_ERROR) {
-    LOG(WARNING) << "Failed to start consumer: " << RdKafka::err2str(resp);
+  auto start = std::chrono::steady_clock::now();
+  BulkLoader loader(graph_stores_[p_id]);
+  bool complete =
+      loader.Load(std::string_view(static_cast<const char*>(addr), size));
+  if (addr) {
+    munmap(addr, size);
+  }
+  if (!complete) {
+    LOG(ERROR) << "Bulk load file (" << path << ") is truncated.";
     exit(1);
   }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  printf("[Runner] Bulk load partition %d: %lu vertices, %lu edges, %.1f s\n",
+         p_id, loader.num_vertices(), loader.num_edges(), elapsed.count());
+
+  // epoch 0 is complete, the binlog continues from epoch 1
+  graph_stores_[p_id]->update_blob(0);
+  graph_stores_[p_id]->insert_blob_schema(0);
+  epoch_publishers_[p_id]->Publish(0);
+  latest_epochs_[p_id] = 1;
+}
+
+std::unique_ptr<LogPipeline> Runner::create_pipeline_(int p_id) {
+  if (FLAGS_num_apply_threads <= 0) {
+    return nullptr;  // apply logs on the consumer thread
+  }
+  auto pipeline = std::make_unique<LogPipeline>(
+      graph_stores_[p_id], FLAGS_num_parse_threads, FLAGS_num_apply_threads,
+      FLAGS_pipeline_max_inflight_batches,
+      [this, p_id](uint64_t epoch, int64_t source_offset) {
+        advance_epoch_(epoch, p_id, source_offset);
+      },
+      metrics_->partition(p_id));
+  pipeline->Start();
+  return pipeline;
+}
+
+// `consumer` is a KafkaConsumer or a ShmRingConsumer
+template <typename Consumer>
+void Runner::consume_logs_(int p_id, Consumer& consumer) {
+  std::unique_ptr<LogPipeline> pipeline = create_pipeline_(p_id);
+  size_t batch_size =
+      pipeline ? FLAGS_pipeline_batch_size : FLAGS_kafka_fetch_batch_size;
   while (1) {
-    RdKafka::Message* msg = consumer->consume(topic, partition, 1000);
-    std::string str;
-    const char* str_addr = static_cast<const char*>(msg->payload());
-    int str_len = static_cast<int>(msg->len());
-    if (str_len == 0) {
+    auto msgs = consumer.Consume(batch_size, 1000);
+    if (msgs->empty()) {
+      continue;
+    }
+    metrics_->partition(p_id)->kafka_lag =
+        consumer.GetLag(msgs->offset(msgs->size() - 1) + 1);
+    if (pipeline) {
+      // payloads are referenced by the batch until it is applied
+      auto batch = std::make_shared<LogBatch>();
+      for (size_t idx = 0; idx < msgs->size(); idx++) {
+        int64_t offset = msgs->offset(idx);
+        if (!ForEachUnifiedLog(msgs->payload(idx), [&](std::string_view log) {
+              batch->AppendView(log, offset);
+            })) {
+          LOG(ERROR) << "Truncated log at offset " << offset;
+        }
+      }
+      batch->release = [msgs] { msgs->Release(); };
+      pipeline->Submit(std::move(batch));
       continue;
     }
-    str.assign(str_addr, str_addr + str_len);
-    apply_log_to_store_(str, p_id);
+    for (size_t idx = 0; idx < msgs->size(); idx++) {
+      int64_t offset = msgs->offset(idx);
+      if (!ForEachUnifiedLog(msgs->payload(idx), [&](std::string_view log) {
+            apply_log_to_store_(log, p_id, offset);
+          })) {
+        LOG(ERROR) << "Truncated log at offset " << offset;
+      }
+    }
   }
 }
 
-void Runner::start_file_stream_to_process_(int p_id) {
+void Runner::start_kafka_to_process_(int p_id, int64_t start_offset) {
+  std::cout << "start_kafka_to_process_" << std::endl;
+  // the converter routes the logs of fragment p_id to partition p_id
+  util::KafkaConsumer consumer(
+      FLAGS_kafka_broker_list, FLAGS_kafka_unified_log_topic, p_id,
+      FLAGS_kafka_fetch_batch_size, FLAGS_kafka_prefetch_depth);
+  consumer.Start(start_offset >= 0 ? start_offset
+                                  : RdKafka::Topic::OFFSET_BEGINNING);
+  consume_logs_(p_id, consumer);
+}
+
+void Runner::start_shm_to_process_(int p_id, int64_t start_offset) {
+  std::cout << "start_shm_to_process_" << std::endl;
+  // offsets are positions in the ring, and the lag is in bytes; logs stay
+  // in the ring until a checkpoint covers them
+  util::ShmRingConsumer consumer(
+      util::ShmRingName(FLAGS_unified_log_shm_name, p_id),
+      static_cast<size_t>(FLAGS_unified_log_shm_size_mb) << 20,
+      !FLAGS_checkpoint_dir.empty());
+  consumer.Start(start_offset);
+  shm_consumers_[p_id] = &consumer;
+  consume_logs_(p_id, consumer);
+  shm_consumers_[p_id] = nullptr;
+}
+
+void Runner::start_file_stream_to_process_(int p_id, int64_t start_offset) {
   std::ifstream infile(FLAGS_kafka_unified_log_file);
   std::string line;
-  while (std::getline(infile, line)) {
-    apply_log_to_store_(line, p_id);
+  // the offset of a log in the file is its line number
+  int64_t line_no = 0;
+  while (line_no < start_offset && std::getline(infile, line)) {
+    line_no++;
+  }
+
+  std::unique_ptr<LogPipeline> pipeline = create_pipeline_(p_id);
+  if (!pipeline) {
+    for (; std::getline(infile, line); line_no++) {
+      apply_log_to_store_(line, p_id, line_no);
+    }
+    return;
   }
+
+  auto batch = std::make_shared<LogBatch>();
+  for (; std::getline(infile, line); line_no++) {
+    batch->Append(line, line_no);
+    if (batch->size() >= FLAGS_pipeline_batch_size) {
+      pipeline->Submit(std::move(batch));
+      batch = std::make_shared<LogBatch>();
+    }
+  }
+  pipeline->Submit(std::move(batch));
+  pipeline->Stop();
 }
 
-void Runner::load_graph_partitions_from_logs_(int mac_id,
-                                              int total_partitions) {
+void Runner::load_graph_partitions_from_logs_(
+    int mac_id, int total_partitions,
+    const std::vector<int>& local_partitions) {
   int num_gp_backups = total_partitions;
-  bool load_from_kafka = true;
   graph_stores_.assign(num_gp_backups, nullptr);
   rg_maps_.assign(num_gp_backups, nullptr);
-  int p_id = mac_id;
+  epoch_publishers_.resize(num_gp_backups);
+  compactors_.resize(num_gp_backups);
+  latest_epochs_.assign(num_gp_backups, 0);
+  checkpoint_epochs_.assign(num_gp_backups, 0);
+  shm_consumers_.assign(num_gp_backups, nullptr);
+  metrics_ = std::make_unique<IngestMetrics>(num_gp_backups);
+  epoch_start_times_.resize(num_gp_backups);
+  if (!FLAGS_checkpoint_dir.empty()) {
+    std::filesystem::create_directories(FLAGS_checkpoint_dir);
+  }
 
-  printf("\n***** Load Graph Partition %d ****\n", p_id);
+  // partitions in the process share one etcd connection
+  auto etcd_client = std::make_shared<etcd::Client>(FLAGS_etcd_endpoint);
+  for (int p_id : local_partitions) {
+    printf("\n***** Load Graph Partition %d ****\n", p_id);
 
-  // load graph
-  graph_stores_[p_id] = new graph::GraphStore(
-      p_id, gart::framework::config.getServerID(), total_partitions);
-  rg_maps_[p_id] = new graph::RGMapping(p_id);
-  init_graph_schema(FLAGS_schema_file_path, FLAGS_table_schema_file_path,
-                    graph_stores_[p_id], rg_maps_[p_id]);
-  graph_stores_[p_id]->put_schema();
+    // load graph
+    graph_stores_[p_id] =
+        new graph::GraphStore(p_id, mac_id, total_partitions,
+                              local_partitions.size(), etcd_client);
+    rg_maps_[p_id] = new graph::RGMapping(p_id);
+    init_graph_schema(FLAGS_schema_file_path, FLAGS_table_schema_file_path,
+                      graph_stores_[p_id], rg_maps_[p_id]);
+    graph_stores_[p_id]->put_schema();
+    PartitionMetrics* metrics =
+        metrics_->AddPartition(p_id, graph_stores_[p_id]);
+    auto publish_callback = [this, p_id, metrics](
+                                uint64_t epoch,
+                                IngestObserver::Duration latency) {
+      metrics->epoch_publish.Record(latency);
+      metrics->published_epoch = epoch;
+      metrics->published_time_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(
+              std::chrono::system_clock::now().time_since_epoch())
+              .count();
+      if (observer_) {
+        observer_->OnEpochPublished(p_id, epoch, latency);
+      }
+    };
+    epoch_publishers_[p_id] = std::make_unique<EpochPublisher>(
+        graph_stores_[p_id], std::move(publish_callback));
+    epoch_publishers_[p_id]->Start();
+    compactors_[p_id] = std::make_unique<SegmentCompactor>(
+        graph_stores_[p_id],
+        std::chrono::milliseconds(FLAGS_compaction_interval_ms));
+  }
+  metrics_->Start();
+
+  // each partition has its own consumer and writer threads
+  std::vector<std::thread> writers;
+  for (int p_id : local_partitions) {
+    writers.emplace_back([this, p_id] {
+      // restored by the writer thread, which reuses the freed blocks
+      int64_t start_offset = recover_from_checkpoint_(p_id);
+      // a checkpoint already holds the bulk loaded graph
+      if (start_offset < 0 && !FLAGS_bulk_load_dir.empty()) {
+        bulk_load_(p_id);
+      }
+      epoch_start_times_[p_id] = std::chrono::steady_clock::now();
+      // compaction must not run with recovery or the bulk load
+      if (FLAGS_compaction_interval_ms > 0) {
+        compactors_[p_id]->set_write_epoch(latest_epochs_[p_id]);
+        compactors_[p_id]->Start();
+      }
+      if (observer_) {
+        observer_->OnStreamBegin(p_id);
+      }
 #ifndef WITH_TEST
-  start_kafka_to_process_(p_id);
+      if (FLAGS_unified_log_shm_name.empty()) {
+        start_kafka_to_process_(p_id, start_offset);
+      } else {
+        start_shm_to_process_(p_id, start_offset);
+      }
 #else
-  start_file_stream_to_process_(p_id);
+      start_file_stream_to_process_(p_id, start_offset);
 #endif
+      if (observer_) {
+        observer_->OnStreamEnd(p_id);
+      }
+      compactors_[p_id]->Stop();
+      epoch_publishers_[p_id]->Stop();
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  metrics_->Stop();
 }
 
 void Runner::run() {
   /*************** Load Data ****************/
   int mac_id = gart::framework::config.getServerID();
-  int total_partitions = gart::framework::config.getNumServers();
+  int total_partitions = gart::framework::config.getNumPartitions();
 
-  load_graph_partitions_from_logs_(mac_id, total_partitions);
+  load_graph_partitions_from_logs_(
+      mac_id, total_partitions, gart::framework::config.getLocalPartitions());
 
   printf("[Runner] Complete Loading!\n");
   fflush(stdout);
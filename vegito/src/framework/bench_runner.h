@@ -16,12 +16,43 @@
 #ifndef VEGITO_SRC_FRAMEWORK_BENCH_RUNNER_H_
 #define VEGITO_SRC_FRAMEWORK_BENCH_RUNNER_H_
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "framework/epoch_publisher.h"
+#include "framework/segment_compactor.h"
+#include "framework/ingest_metrics.h"
+#include "framework/log_pipeline.h"
 #include "graph/ddl.h"
 #include "graph/graph_store.h"
+#include "util/shm_ring.h"
 
 namespace gart {
 namespace framework {
 
+/**
+ * Receives ingestion events of a Runner, e.g., for benchmarks. Events of a
+ * partition come from its writer thread, except OnEpochPublished(), which
+ * comes from its epoch publisher.
+ */
+class IngestObserver {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  virtual ~IngestObserver() {}
+
+  virtual void OnStreamBegin(int p_id) {}
+  virtual void OnStreamEnd(int p_id) {}
+
+  // only reported when logs are applied on the writer thread
+  virtual void OnLogApplied(int p_id, LogOp op, Duration latency) {}
+
+  virtual void OnEpochPublished(int p_id, uint64_t epoch, Duration latency) {}
+};
+
 /* Bench runner is used to bootstrap system */
 class Runner {
  public:
@@ -29,19 +60,44 @@ class Runner {
 
   void run();
 
+  // must be set before run()
+  void set_observer(IngestObserver* observer) { observer_ = observer; }
+
  protected:
   // for graph
   std::vector<graph::GraphStore*> graph_stores_;
   std::vector<graph::RGMapping*> rg_maps_;
+  std::vector<std::unique_ptr<EpochPublisher>> epoch_publishers_;
+  std::vector<std::unique_ptr<SegmentCompactor>> compactors_;
+
+  std::vector<uint64_t> latest_epochs_;  // latest epoch of each partition
+  std::vector<uint64_t> checkpoint_epochs_;  // epoch of the last checkpoint
+  // consumers of partitions reading a shared memory ring, or nullptr
+  std::vector<util::ShmRingConsumer*> shm_consumers_;
+
+  std::unique_ptr<IngestMetrics> metrics_;
+  // when each partition started to apply its latest epoch
+  std::vector<std::chrono::steady_clock::time_point> epoch_start_times_;
 
-  uint64_t latest_epoch_ = 0;
+  IngestObserver* observer_ = nullptr;
 
  private:
   void load_graph_partitions_(int mac_id, int total_partitions);
-  void load_graph_partitions_from_logs_(int mac_id, int total_partitions);
-  void apply_log_to_store_(std::string log, int p_id);
-  void start_kafka_to_process_(int p_id);
-  void start_file_stream_to_process_(int p_id);
+  void load_graph_partitions_from_logs_(
+      int mac_id, int total_partitions,
+      const std::vector<int>& local_partitions);
+  void apply_log_to_store_(std::string_view log, int p_id,
+                           int64_t source_offset = -1);
+  void advance_epoch_(uint64_t epoch, int p_id, int64_t source_offset);
+  std::string checkpoint_path_(int p_id) const;
+  int64_t recover_from_checkpoint_(int p_id);
+  void bulk_load_(int p_id);
+  std::unique_ptr<LogPipeline> create_pipeline_(int p_id);
+  template <typename Consumer>
+  void consume_logs_(int p_id, Consumer& consumer);
+  void start_kafka_to_process_(int p_id, int64_t start_offset);
+  void start_shm_to_process_(int p_id, int64_t start_offset);
+  void start_file_stream_to_process_(int p_id, int64_t start_offset);
 };
 
 }  // namespace framework
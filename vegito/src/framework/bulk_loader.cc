@@ -0,0 +1,85 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "framework/bulk_loader.h"
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "fragment/unified_log.h"
+#include "graph/graph_ops/process_add_edge.h"
+#include "graph/graph_ops/process_add_vertex.h"
+
+namespace gart {
+namespace framework {
+
+bool BulkLoader::Load(std::string_view logs) {
+  std::vector<std::string_view> edges;
+  LogEntry entry;
+  bool complete = ForEachUnifiedLog(logs, [&](std::string_view log) {
+    if (!ParseUnifiedLog(log.data(), log.size(), entry)) {
+      LOG(ERROR) << "Malformed unified log of size " << log.size();
+    } else if (entry.op == LogOp::kAddVertex) {
+      num_vertices_ += graph::process_add_vertex(entry, graph_store_);
+    } else if (entry.op == LogOp::kAddEdge) {
+      edges.push_back(log);
+    } else if (entry.op != LogOp::kEpoch) {
+      LOG(ERROR) << "Unexpected operator "
+                 << static_cast<int>(entry.op) << " in a bulk load";
+    }
+  });
+
+  // degrees of the vertices of each segment, by (graph, label, dir, segment)
+  using SegmentKey = std::tuple<seggraph::SegGraph*, seggraph::label_t,
+                                seggraph::dir_t, seggraph::segid_t>;
+  std::map<SegmentKey, std::vector<uint32_t>> degrees;
+  graph::EdgeHalf halves[2];
+  for (std::string_view log : edges) {
+    if (!ParseUnifiedLog(log.data(), log.size(), entry)) {
+      LOG(ERROR) << "Malformed unified log of size " << log.size();
+      continue;
+    }
+    if (!graph::is_local_edge(entry, graph_store_)) {
+      continue;
+    }
+    graph::resolve_edge_halves(entry, 0, graph_store_, halves);
+    for (auto& half : halves) {
+      SegmentKey key(half.graph, entry.elabel, half.dir,
+                     half.graph->get_vertex_seg_id(half.v));
+      std::vector<uint32_t>& counts = degrees[key];
+      counts.resize(VERTEX_PER_SEG);
+      counts[half.graph->get_vertex_seg_idx(half.v)]++;
+    }
+  }
+  for (auto& [key, counts] : degrees) {
+    auto& [graph, label, dir, segid] = key;
+    auto writer = graph->create_graph_writer(0);
+    writer.reserve_segment(segid, label, dir, counts.data(),
+                           graph::get_edge_prop_bytes(label, graph_store_));
+  }
+
+  for (std::string_view log : edges) {
+    if (!ParseUnifiedLog(log.data(), log.size(), entry)) {
+      LOG(ERROR) << "Malformed unified log of size " << log.size();
+      continue;
+    }
+    num_edges_ += graph::process_add_edge(entry, graph_store_);
+  }
+  return complete;
+}
+
+}  // namespace framework
+}  // namespace gart
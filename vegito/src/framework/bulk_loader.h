@@ -0,0 +1,61 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_FRAMEWORK_BULK_LOADER_H_
+#define VEGITO_SRC_FRAMEWORK_BULK_LOADER_H_
+
+#include <cstdint>
+#include <string_view>
+
+#include "graph/graph_store.h"
+
+namespace gart {
+namespace framework {
+
+/**
+ * Builds a fragment from the UnifiedLogs of a bulk load (written by
+ * binlog_convert --bulk_load_dir), instead of applying them one by one:
+ *
+ *   1. vertices are inserted in the order of their offsets, so property
+ *      columns are filled sequentially;
+ *   2. edges are resolved to local ids, which registers outer vertices,
+ *      and counted by vertex, label and direction;
+ *   3. each segment is allocated once, with an edge block of each vertex
+ *      sized for its degree (EpochGraphWriter::reserve_segment);
+ *   4. edges are put into the reserved blocks, with no copy or merge.
+ *
+ * Everything is written at epoch 0, the caller publishes it.
+ */
+class BulkLoader {
+ public:
+  explicit BulkLoader(graph::GraphStore* graph_store)
+      : graph_store_(graph_store) {}
+
+  // `logs` are binary UnifiedLogs back to back, false if one is truncated
+  bool Load(std::string_view logs);
+
+  uint64_t num_vertices() const { return num_vertices_; }
+  uint64_t num_edges() const { return num_edges_; }
+
+ private:
+  graph::GraphStore* graph_store_;
+  uint64_t num_vertices_ = 0;
+  uint64_t num_edges_ = 0;
+};
+
+}  // namespace framework
+}  // namespace gart
+
+#endif  // VEGITO_SRC_FRAMEWORK_BULK_LOADER_H_
@@ -16,6 +16,11 @@
 #include "config.h"        // NOLINT(build/include_subdir)
 #include "system_flags.h"  // NOLINT(build/include_subdir)
 
+#include <fstream>
+
+#include "glog/logging.h"
+#include "vineyard/common/util/json.h"
+
 namespace gart {
 namespace framework {
 
@@ -25,6 +30,56 @@ void Config::parse_sys_args(int argc, char** argv) {
   ipc_socket_ = FLAGS_v6d_ipc_socket;
   num_servers_ = FLAGS_server_num;
   server_id_ = FLAGS_server_id;
+  num_partitions_ = FLAGS_num_partitions > 0 ? FLAGS_num_partitions
+                                             : FLAGS_server_num;
+  parse_partition_map_();
+}
+
+void Config::parse_partition_map_() {
+  local_partitions_.clear();
+  if (FLAGS_partition_map_file.empty()) {
+    // round-robin
+    for (int p_id = server_id_; p_id < num_partitions_; p_id += num_servers_) {
+      local_partitions_.push_back(p_id);
+    }
+    if (local_partitions_.empty()) {
+      LOG(ERROR) << "No partition is mapped to server " << server_id_;
+      exit(1);
+    }
+    return;
+  }
+
+  using json = vineyard::json;
+  std::ifstream map_file(FLAGS_partition_map_file);
+  if (!map_file.is_open()) {
+    LOG(ERROR) << "partition map file (" << FLAGS_partition_map_file
+               << ") open failed. Not exist or permission denied.";
+    exit(1);
+  }
+  json partition_map;
+  try {
+    partition_map = json::parse(map_file);
+  } catch (json::parse_error& e) {
+    LOG(ERROR) << "Parse partition map file (" << FLAGS_partition_map_file
+               << ") failed: " << e.what();
+    exit(1);
+  }
+
+  // {"<server id>": [<partition id>, ...], ...}
+  auto iter = partition_map.find(std::to_string(server_id_));
+  if (iter == partition_map.end()) {
+    LOG(ERROR) << "No partition is mapped to server " << server_id_;
+    exit(1);
+  }
+  for (const auto& p_id : *iter) {
+    int pid = p_id.get<int>();
+    if (pid < 0 || pid >= num_partitions_) {
+      LOG(ERROR) << "Invalid partition " << pid << " of server " << server_id_
+                 << ", the number of partitions is " << num_partitions_;
+      exit(1);
+    }
+    local_partitions_.push_back(pid);
+  }
 }
 
 void Config::printConfig() const {}
@@ -17,6 +17,7 @@
 #define VEGITO_SRC_FRAMEWORK_CONFIG_H_
 
 #include <string>
+#include <vector>
 
 namespace gart {
 namespace framework {
@@ -31,6 +32,12 @@ class Config {
   inline int getNumServers() const { return num_servers_; }  // #machines
   inline int getServerID() const { return server_id_; }      // machine id
 
+  // partitions (i.e., fragments) of the graph, and those hosted by this server
+  inline int getNumPartitions() const { return num_partitions_; }
+  inline const std::vector<int>& getLocalPartitions() const {
+    return local_partitions_;
+  }
+
   // 3. Property Store
   inline int getPropertyType() const { return property_type_; }
 
@@ -40,9 +47,13 @@ class Config {
   void printConfig() const;
 
  private:
+  void parse_partition_map_();
+
   std::string exe_name_;
   int num_servers_ = 1;
   int server_id_ = 0;
+  int num_partitions_ = 1;
+  std::vector<int> local_partitions_;
 
   // 0 for kv-store, 1 for row-store, 2 for column-store, 3 for naive col
   // FIXME: fix this hard code according PropertyStoreType
@@ -0,0 +1,82 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "framework/epoch_publisher.h"
+
+#include <iostream>
+
+namespace gart {
+namespace framework {
+
+void EpochPublisher::Start() {
+  thread_ = std::thread([this] { publish_loop_(); });
+}
+
+void EpochPublisher::Publish(uint64_t epoch) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_epochs_.push_back(epoch);
+    if (publish_callback_) {
+      pending_times_.push_back(std::chrono::steady_clock::now());
+    }
+  }
+  cv_.notify_one();
+}
+
+void EpochPublisher::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void EpochPublisher::publish_loop_() {
+  std::vector<uint64_t> epochs;
+  std::vector<std::chrono::steady_clock::time_point> times;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this] { return stop_ || !pending_epochs_.empty(); });
+      if (pending_epochs_.empty()) {
+        return;
+      }
+      epochs.swap(pending_epochs_);
+      times.swap(pending_times_);
+    }
+
+    graph_store_->put_blob_json(epochs);
+    if (publish_callback_) {
+      auto now = std::chrono::steady_clock::now();
+      for (size_t idx = 0; idx < epochs.size(); idx++) {
+        publish_callback_(epochs[idx], now - times[idx]);
+      }
+    }
+    std::cout << "update epoch " << epochs.back()
+              << " frag = " << graph_store_->get_local_pid();
+    if (epochs.size() > 1) {
+      std::cout << " (coalesced " << epochs.size() << " epochs)";
+    }
+    std::cout << std::endl;
+    epochs.clear();
+    times.clear();
+  }
+}
+
+}  // namespace framework
+}  // namespace gart
@@ -0,0 +1,78 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_FRAMEWORK_EPOCH_PUBLISHER_H_
+#define VEGITO_SRC_FRAMEWORK_EPOCH_PUBLISHER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "graph/graph_store.h"
+
+namespace gart {
+namespace framework {
+
+/**
+ * Publishes blob schemas of finished epochs to etcd in the background.
+ *
+ * The apply thread snapshots the blob schema of an epoch (update_blob and
+ * insert_blob_schema) and hands the epoch over with Publish(). Epochs that
+ * pile up while etcd is slow are published together in one round.
+ */
+class EpochPublisher {
+ public:
+  // called once an epoch is in etcd, with the time since its Publish()
+  using PublishCallback = std::function<void(
+      uint64_t epoch, std::chrono::steady_clock::duration latency)>;
+
+  explicit EpochPublisher(graph::GraphStore* graph_store,
+                          PublishCallback publish_callback = nullptr)
+      : graph_store_(graph_store),
+        publish_callback_(std::move(publish_callback)) {}
+
+  ~EpochPublisher() { Stop(); }
+
+  void Start();
+
+  // the blob schema of `epoch` must have been inserted
+  void Publish(uint64_t epoch);
+
+  // publish the pending epochs, and stop the publisher
+  void Stop();
+
+ private:
+  void publish_loop_();
+
+  graph::GraphStore* graph_store_;
+  PublishCallback publish_callback_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::vector<uint64_t> pending_epochs_;
+  // when the pending epochs were handed over, if there is a callback
+  std::vector<std::chrono::steady_clock::time_point> pending_times_;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
+
+}  // namespace framework
+}  // namespace gart
+
+#endif  // VEGITO_SRC_FRAMEWORK_EPOCH_PUBLISHER_H_
@@ -0,0 +1,197 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "framework/ingest_metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "glog/logging.h"
+
+#include "system_flags.h"  // NOLINT(build/include_subdir)
+
+namespace gart {
+namespace framework {
+
+namespace {
+int64_t now_ms() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+const char* log_op_name(int op) {
+  switch (static_cast<LogOp>(op)) {
+  case LogOp::kAddVertex:
+    return "add_vertex";
+  case LogOp::kAddEdge:
+    return "add_edge";
+  case LogOp::kDeleteVertex:
+    return "delete_vertex";
+  case LogOp::kDeleteEdge:
+    return "delete_edge";
+  case LogOp::kEpoch:
+    return "epoch";
+  case LogOp::kUpdateVertex:
+    return "update_vertex";
+  default:
+    return "invalid";
+  }
+}
+}  // namespace
+
+void LatencyHistogram::Record(Duration duration) {
+  uint64_t us = std::max<int64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+      0);
+  int bucket = us == 0 ? 0 : 64 - __builtin_clzll(us);
+  if (bucket >= kNumBuckets) {
+    bucket = kNumBuckets - 1;
+  }
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_us_.fetch_add(us, std::memory_order_relaxed);
+  uint64_t max_us = max_us_.load(std::memory_order_relaxed);
+  while (us > max_us &&
+         !max_us_.compare_exchange_weak(max_us, us,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+vineyard::json LatencyHistogram::ToJson() const {
+  vineyard::json ret;
+  ret["count"] = count_.load(std::memory_order_relaxed);
+  ret["sum_us"] = sum_us_.load(std::memory_order_relaxed);
+  ret["max_us"] = max_us_.load(std::memory_order_relaxed);
+  // upper bounds of non-empty buckets, "le" in microseconds
+  vineyard::json buckets = vineyard::json::array();
+  for (int i = 0; i < kNumBuckets; i++) {
+    uint64_t cnt = buckets_[i].load(std::memory_order_relaxed);
+    if (cnt == 0) {
+      continue;
+    }
+    vineyard::json bucket;
+    if (i == kNumBuckets - 1) {
+      bucket["le_us"] = "inf";
+    } else {
+      bucket["le_us"] = (uint64_t(1) << i) - 1;
+    }
+    bucket["count"] = cnt;
+    buckets.push_back(bucket);
+  }
+  ret["buckets"] = buckets;
+  return ret;
+}
+
+vineyard::json PartitionMetrics::ToJson() const {
+  vineyard::json ret;
+  vineyard::json applied_json;
+  for (int op = 1; op < kNumLogOps; op++) {
+    applied_json[log_op_name(op)] = applied[op].load();
+  }
+  ret["applied"] = applied_json;
+  ret["filtered"] = filtered.load();
+
+  ret["latest_epoch"] = latest_epoch.load();
+  ret["published_epoch"] = published_epoch.load();
+  int64_t published_time = published_time_ms.load();
+  // how long readers have been seeing the same snapshot
+  ret["published_age_ms"] =
+      published_time == 0 ? -1 : now_ms() - published_time;
+  ret["kafka_lag"] = kafka_lag.load();
+
+  ret["block_used_bytes"] = block_used_bytes.load();
+  ret["block_free_bytes"] = block_free_bytes.load();
+  ret["prop_page_allocs"] = prop_page_allocs.load();
+
+  ret["epoch_apply"] = epoch_apply.ToJson();
+  ret["epoch_publish"] = epoch_publish.ToJson();
+  return ret;
+}
+
+PartitionMetrics* IngestMetrics::AddPartition(int p_id,
+                                              graph::GraphStore* graph_store) {
+  partitions_[p_id] = std::make_unique<PartitionMetrics>();
+  local_partitions_.emplace_back(p_id, graph_store);
+  return partitions_[p_id].get();
+}
+
+void IngestMetrics::Start() {
+  if (FLAGS_metrics_interval_ms <= 0) {
+    return;
+  }
+  thread_ = std::thread([this] { export_loop_(); });
+}
+
+void IngestMetrics::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      return;
+    }
+    stop_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+    export_();
+  }
+}
+
+void IngestMetrics::export_loop_() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!cv_.wait_for(lock,
+                       std::chrono::milliseconds(FLAGS_metrics_interval_ms),
+                       [this] { return stop_; })) {
+    lock.unlock();
+    export_();
+    lock.lock();
+  }
+}
+
+void IngestMetrics::export_() {
+  vineyard::json all;
+  all["time_ms"] = now_ms();
+  vineyard::json partitions = vineyard::json::array();
+  for (auto& [p_id, graph_store] : local_partitions_) {
+    vineyard::json metrics = partitions_[p_id]->ToJson();
+    metrics["partition"] = p_id;
+    graph_store->put_metrics_json(metrics.dump());
+    partitions.push_back(metrics);
+  }
+  all["partitions"] = partitions;
+
+  if (FLAGS_metrics_file.empty()) {
+    return;
+  }
+  // readers never see a partially written file
+  std::string tmp_path = FLAGS_metrics_file + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    out << all.dump(2) << std::endl;
+    if (!out) {
+      LOG(ERROR) << "Write metrics file (" << tmp_path << ") failed.";
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), FLAGS_metrics_file.c_str()) != 0) {
+    LOG(ERROR) << "Rename metrics file to " << FLAGS_metrics_file
+               << " failed.";
+  }
+}
+
+}  // namespace framework
+}  // namespace gart
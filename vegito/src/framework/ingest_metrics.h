@@ -0,0 +1,131 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_FRAMEWORK_INGEST_METRICS_H_
+#define VEGITO_SRC_FRAMEWORK_INGEST_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vineyard/common/util/json.h"
+
+#include "fragment/unified_log.h"
+#include "graph/graph_store.h"
+
+namespace gart {
+namespace framework {
+
+// histogram of durations in power-of-two buckets of microseconds
+class LatencyHistogram {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  // bucket i counts durations in [2^(i-1), 2^i) us, the last one is open
+  static constexpr int kNumBuckets = 32;
+
+  void Record(Duration duration);
+
+  vineyard::json ToJson() const;
+
+ private:
+  std::atomic<uint64_t> buckets_[kNumBuckets] = {};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_us_{0};
+  std::atomic<uint64_t> max_us_{0};
+};
+
+/**
+ * Ingest metrics of one partition. Counters are updated by the writer and
+ * the epoch publisher of the partition, and read by the exporter.
+ */
+struct PartitionMetrics {
+  static constexpr int kNumLogOps =
+      static_cast<int>(LogOp::kUpdateVertex) + 1;
+
+  void CountLog(LogOp op, bool local) {
+    if (local) {
+      applied[static_cast<int>(op)].fetch_add(1, std::memory_order_relaxed);
+    } else {
+      filtered.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  vineyard::json ToJson() const;
+
+  std::atomic<uint64_t> applied[kNumLogOps] = {};  // by LogOp
+  std::atomic<uint64_t> filtered{0};  // logs of other fragments
+
+  std::atomic<uint64_t> latest_epoch{0};  // being applied
+  std::atomic<uint64_t> published_epoch{0};
+  std::atomic<int64_t> published_time_ms{0};  // of published_epoch, in UTC
+
+  std::atomic<int64_t> kafka_lag{-1};  // -1 if not consuming from Kafka
+
+  // sampled at epoch boundaries
+  std::atomic<uint64_t> block_used_bytes{0};
+  std::atomic<uint64_t> block_free_bytes{0};
+  std::atomic<uint64_t> prop_page_allocs{0};
+
+  LatencyHistogram epoch_apply;    // between two epoch boundaries
+  LatencyHistogram epoch_publish;  // from the publish to etcd
+};
+
+/**
+ * Metrics of the partitions in the writer process. The exporter thread
+ * puts them to etcd every FLAGS_metrics_interval_ms, as
+ * gart_ingest_metrics_p<pid> next to gart_latest_epoch_p<pid>, and rewrites
+ * FLAGS_metrics_file with all local partitions if it is set.
+ */
+class IngestMetrics {
+ public:
+  explicit IngestMetrics(int total_partitions)
+      : partitions_(total_partitions) {}
+
+  ~IngestMetrics() { Stop(); }
+
+  // creates the metrics of a local partition, before Start()
+  PartitionMetrics* AddPartition(int p_id, graph::GraphStore* graph_store);
+
+  PartitionMetrics* partition(int p_id) { return partitions_[p_id].get(); }
+
+  void Start();
+
+  // export once more, and stop the exporter
+  void Stop();
+
+ private:
+  void export_loop_();
+  void export_();
+
+  std::vector<std::unique_ptr<PartitionMetrics>> partitions_;
+  std::vector<std::pair<int, graph::GraphStore*>> local_partitions_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
+
+}  // namespace framework
+}  // namespace gart
+
+#endif  // VEGITO_SRC_FRAMEWORK_INGEST_METRICS_H_
@@ -0,0 +1,352 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "framework/log_pipeline.h"
+
+#include "graph/graph_ops/process_add_edge.h"
+#include "graph/graph_ops/process_add_vertex.h"
+#include "graph/graph_ops/process_del_edge.h"
+#include "graph/graph_ops/process_del_vertex.h"
+#include "graph/graph_ops/process_update_vertex.h"
+
+namespace gart {
+namespace framework {
+
+namespace {
+// upper bound of half-edges queued in apply workers, for back pressure
+constexpr size_t kMaxInflightTasks = 1ul << 20;
+}  // namespace
+
+LogPipeline::LogPipeline(graph::GraphStore* graph_store, int num_parse_threads,
+                         int num_apply_threads, size_t max_inflight_batches,
+                         EpochCallback epoch_callback,
+                         PartitionMetrics* metrics)
+    : graph_store_(graph_store),
+      num_parse_threads_(std::max(num_parse_threads, 1)),
+      num_apply_threads_(std::max(num_apply_threads, 1)),
+      max_inflight_batches_(std::max(max_inflight_batches, size_t(1))),
+      epoch_callback_(std::move(epoch_callback)),
+      metrics_(metrics) {}
+
+LogPipeline::~LogPipeline() { Stop(); }
+
+void LogPipeline::Start() {
+  for (int i = 0; i < num_apply_threads_; i++) {
+    workers_.emplace_back(new Worker());
+    Worker* worker = workers_.back().get();
+    worker->thread = std::thread([this, worker] { apply_loop_(worker); });
+  }
+  for (int i = 0; i < num_parse_threads_; i++) {
+    parse_threads_.emplace_back([this] { parse_loop_(); });
+  }
+  sequence_thread_ = std::thread([this] { sequence_loop_(); });
+}
+
+void LogPipeline::Submit(std::shared_ptr<LogBatch> batch) {
+  if (!batch || batch->empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  submit_cv_.wait(lock, [this] {
+    return sequence_queue_.size() < max_inflight_batches_;
+  });
+  parse_queue_.push_back(batch);
+  sequence_queue_.push_back(std::move(batch));
+  parse_cv_.notify_one();
+}
+
+void LogPipeline::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_) {
+      return;
+    }
+    stop_ = true;
+  }
+  parse_cv_.notify_all();
+  sequence_cv_.notify_all();
+  for (auto& thread : parse_threads_) {
+    thread.join();
+  }
+  if (sequence_thread_.joinable()) {
+    sequence_thread_.join();
+  }
+
+  // the sequencer has drained the workers before exiting
+  for (auto& worker : workers_) {
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->stop = true;
+    }
+    worker->cv.notify_one();
+    worker->thread.join();
+  }
+}
+
+void LogPipeline::parse_loop_() {
+  while (true) {
+    std::shared_ptr<LogBatch> batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      parse_cv_.wait(lock, [this] { return stop_ || !parse_queue_.empty(); });
+      if (parse_queue_.empty()) {
+        return;
+      }
+      batch = std::move(parse_queue_.front());
+      parse_queue_.pop_front();
+    }
+
+    parse_batch_(*batch);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      batch->is_parsed_ = true;
+    }
+    sequence_cv_.notify_one();
+  }
+}
+
+void LogPipeline::parse_batch_(LogBatch& batch) {
+  gart::IdParser<seggraph::vertex_t> parser;
+  parser.Init(graph_store_->get_total_partitions(),
+              graph_store_->get_total_vertex_label_num());
+
+  batch.parsed_.resize(batch.size());
+  for (size_t idx = 0; idx < batch.size(); idx++) {
+    std::string_view log = batch.at(idx);
+    LogBatch::ParsedLog& parsed = batch.parsed_[idx];
+    parsed.local = false;
+    parsed.prop_offset = batch.props_.size();
+    if (!ParseUnifiedLog(log.data(), log.size(), parsed.entry)) {
+      LOG(ERROR) << "Malformed unified log of size " << log.size();
+      continue;
+    }
+
+    const LogEntry& entry = parsed.entry;
+    switch (entry.op) {
+    case LogOp::kAddVertex: {
+      if (parser.GetFid(entry.vid) != graph_store_->get_local_pid()) {
+        break;
+      }
+      const graph::PropRowDecoder& decoder =
+          graph_store_->get_prop_decoder(parser.GetLabelId(entry.vid));
+      batch.props_.resize(parsed.prop_offset + decoder.row_bytes);
+      decoder.decode(entry.fields(), batch.props_.data() + parsed.prop_offset);
+      parsed.local = true;
+      break;
+    }
+    case LogOp::kAddEdge: {
+      if (!graph::is_local_edge(entry, graph_store_)) {
+        break;
+      }
+      const graph::PropRowDecoder& decoder =
+          graph::get_edge_prop_decoder(entry.elabel, graph_store_);
+      batch.props_.resize(parsed.prop_offset + decoder.row_bytes);
+      decoder.decode(entry.fields(), batch.props_.data() + parsed.prop_offset);
+      parsed.local = true;
+      break;
+    }
+    case LogOp::kUpdateVertex:
+      // decoded when applied, as only the changed columns are present
+      parsed.local =
+          parser.GetFid(entry.vid) == graph_store_->get_local_pid();
+      break;
+    default:
+      // deletions are filtered by their own handlers
+      parsed.local = true;
+      break;
+    }
+  }
+}
+
+void LogPipeline::sequence_loop_() {
+  while (true) {
+    std::shared_ptr<LogBatch> batch;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      sequence_cv_.wait(lock, [this] {
+        return (!sequence_queue_.empty() &&
+                sequence_queue_.front()->is_parsed_) ||
+               (stop_ && sequence_queue_.empty());
+      });
+      if (sequence_queue_.empty()) {
+        break;
+      }
+      batch = std::move(sequence_queue_.front());
+      sequence_queue_.pop_front();
+    }
+    submit_cv_.notify_one();
+
+    sequence_batch_(batch);
+  }
+  drain_();
+}
+
+void LogPipeline::sequence_batch_(const std::shared_ptr<LogBatch>& batch) {
+  for (size_t idx = 0; idx < batch->parsed_.size(); idx++) {
+    const LogBatch::ParsedLog& parsed = batch->parsed_[idx];
+    const LogEntry& entry = parsed.entry;
+    if (entry.op == LogOp::kInvalid) {
+      if (!entry.op_name.empty()) {
+        LOG(ERROR) << "Unsupported operator " << entry.op_name;
+      }
+      continue;
+    }
+
+    // epoch barrier: publish only after all logs of the epoch are applied
+    if (entry.epoch > epoch_) {
+      dispatch_(batch);
+      drain_();
+      advance_epoch_(entry.epoch, batch->source_offset(idx));
+    }
+
+    if (metrics_) {
+      metrics_->CountLog(entry.op, parsed.local);
+    }
+    if (!parsed.local) {
+      continue;
+    }
+
+    int write_epoch = static_cast<int>(entry.epoch);
+    switch (entry.op) {
+    case LogOp::kAddVertex:
+      graph::insert_vertex(entry.vid, write_epoch,
+                           batch->props_.data() + parsed.prop_offset,
+                           graph_store_);
+      break;
+    case LogOp::kAddEdge: {
+      graph::EdgeHalf halves[2];
+      graph::resolve_edge_halves(entry, write_epoch, graph_store_, halves);
+      std::string_view edge_data(
+          batch->props_.data() + parsed.prop_offset,
+          graph::get_edge_prop_bytes(entry.elabel, graph_store_));
+      for (auto& half : halves) {
+        Worker* worker = workers_[shard_of_(half.graph, half.v)].get();
+        worker->pending.push_back(
+            {half.graph, half.v, half.nbr,
+             static_cast<seggraph::label_t>(entry.elabel), half.dir,
+             write_epoch, edge_data});
+      }
+      break;
+    }
+    case LogOp::kDeleteVertex:
+      // deletions scan adjacency lists, so run them exclusively
+      dispatch_(batch);
+      drain_();
+      graph::process_del_vertex(entry, graph_store_);
+      break;
+    case LogOp::kDeleteEdge:
+      dispatch_(batch);
+      drain_();
+      graph::process_del_edge(entry, graph_store_);
+      break;
+    case LogOp::kUpdateVertex:
+      // edge workers never touch vertex properties
+      graph::process_update_vertex(entry, graph_store_);
+      break;
+    default:
+      break;
+    }
+  }
+  dispatch_(batch);
+}
+
+void LogPipeline::apply_loop_(Worker* worker) {
+  while (true) {
+    ShardWork work;
+    {
+      std::unique_lock<std::mutex> lock(worker->mutex);
+      worker->cv.wait(
+          lock, [worker] { return worker->stop || !worker->queue.empty(); });
+      if (worker->queue.empty()) {
+        return;
+      }
+      work = std::move(worker->queue.front());
+      worker->queue.pop_front();
+    }
+
+    // consecutive tasks of the same graph and epoch go in one batch
+    std::vector<seggraph::EdgeUpdate> edges;
+    for (size_t begin = 0; begin < work.tasks.size();) {
+      const EdgeTask& first = work.tasks[begin];
+      size_t end = begin;
+      edges.clear();
+      for (; end < work.tasks.size(); end++) {
+        const EdgeTask& task = work.tasks[end];
+        if (task.graph != first.graph || task.epoch != first.epoch) {
+          break;
+        }
+        edges.push_back({task.v, task.label, task.dir, task.nbr, task.data});
+      }
+      auto writer = first.graph->create_graph_writer(first.epoch);
+      writer.put_edges(edges.data(), edges.size());
+      begin = end;
+    }
+
+    size_t num_tasks = work.tasks.size();
+    work.batch.reset();
+    {
+      std::lock_guard<std::mutex> lock(drain_mutex_);
+      inflight_tasks_ -= num_tasks;
+    }
+    drain_cv_.notify_all();
+  }
+}
+
+void LogPipeline::dispatch_(const std::shared_ptr<LogBatch>& batch) {
+  for (auto& worker : workers_) {
+    if (worker->pending.empty()) {
+      continue;
+    }
+    size_t num_tasks = worker->pending.size();
+    {
+      std::unique_lock<std::mutex> lock(drain_mutex_);
+      drain_cv_.wait(lock,
+                     [this] { return inflight_tasks_ < kMaxInflightTasks; });
+      inflight_tasks_ += num_tasks;
+    }
+
+    ShardWork work;
+    work.tasks.swap(worker->pending);
+    work.batch = batch;
+    {
+      std::lock_guard<std::mutex> lock(worker->mutex);
+      worker->queue.push_back(std::move(work));
+    }
+    worker->cv.notify_one();
+  }
+}
+
+void LogPipeline::drain_() {
+  std::unique_lock<std::mutex> lock(drain_mutex_);
+  drain_cv_.wait(lock, [this] { return inflight_tasks_ == 0; });
+}
+
+void LogPipeline::advance_epoch_(uint64_t epoch, int64_t source_offset) {
+  epoch_ = epoch;
+  if (epoch_callback_) {
+    epoch_callback_(epoch, source_offset);
+  }
+}
+
+size_t LogPipeline::shard_of_(const seggraph::SegGraph* graph,
+                              seggraph::vertex_t v) const {
+  size_t hash = std::hash<const void*>()(graph) ^
+                (graph->get_vertex_seg_id(v) * 0x9E3779B97F4A7C15ul);
+  return hash % workers_.size();
+}
+
+}  // namespace framework
+}  // namespace gart
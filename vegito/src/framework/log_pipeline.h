@@ -0,0 +1,207 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_FRAMEWORK_LOG_PIPELINE_H_
+#define VEGITO_SRC_FRAMEWORK_LOG_PIPELINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "fragment/unified_log.h"
+#include "framework/ingest_metrics.h"
+#include "graph/graph_store.h"
+
+namespace gart {
+namespace framework {
+
+/**
+ * A batch of UnifiedLogs. Payloads are either copied into the batch
+ * (Append) or referenced (AppendView); in the latter case the owner is
+ * notified through `release` once the whole batch has been applied.
+ *
+ * Each log may carry its offset in the source stream (e.g., the Kafka
+ * offset), which is reported at epoch boundaries for checkpointing.
+ */
+class LogBatch {
+ public:
+  ~LogBatch() {
+    if (release) {
+      release();
+    }
+  }
+
+  void Append(std::string_view log, int64_t source_offset = -1) {
+    slots_.push_back({nullptr, buffer_.size(), log.size(), source_offset});
+    buffer_.append(log.data(), log.size());
+  }
+
+  void AppendView(std::string_view log, int64_t source_offset = -1) {
+    slots_.push_back({log.data(), 0, log.size(), source_offset});
+  }
+
+  size_t size() const { return slots_.size(); }
+
+  bool empty() const { return slots_.empty(); }
+
+  std::string_view at(size_t idx) const {
+    const Slot& slot = slots_[idx];
+    const char* data = slot.ptr ? slot.ptr : buffer_.data() + slot.offset;
+    return std::string_view(data, slot.len);
+  }
+
+  int64_t source_offset(size_t idx) const {
+    return slots_[idx].source_offset;
+  }
+
+  std::function<void()> release;
+
+ private:
+  friend class LogPipeline;
+
+  struct Slot {
+    const char* ptr;  // nullptr if the payload is in buffer_
+    size_t offset;
+    size_t len;
+    int64_t source_offset;
+  };
+
+  // filled by parse threads
+  struct ParsedLog {
+    LogEntry entry;
+    size_t prop_offset;  // decoded properties in props_
+    bool local;          // whether the log touches the local fragment
+  };
+
+  std::vector<Slot> slots_;
+  std::string buffer_;
+
+  std::vector<ParsedLog> parsed_;
+  std::vector<char> props_;
+  bool is_parsed_ = false;
+};
+
+/**
+ * Multi-threaded apply pipeline of one fragment:
+ *
+ *   consumer --Submit()--> parse threads --> sequencer --> apply workers
+ *
+ * - parse threads decode logs and their properties, batches in parallel;
+ * - the sequencer walks batches in log order, creates vertices, resolves
+ *   outer vertices, and splits each edge into two half-edge inserts;
+ * - apply workers run put_edges(). Half-edges are sharded by the segment of
+ *   the vertex they are appended to, so a segment is only written by one
+ *   worker, and the per-vertex order of edges is kept.
+ *
+ * Deletions run on the sequencer after the workers are drained, and an epoch
+ * is published (through `epoch_callback`) only after every worker has
+ * drained the logs of the previous epoch. The callback also gets the source
+ * offset of the first log of the new epoch.
+ */
+class LogPipeline {
+ public:
+  using EpochCallback =
+      std::function<void(uint64_t epoch, int64_t source_offset)>;
+
+  LogPipeline(graph::GraphStore* graph_store, int num_parse_threads,
+              int num_apply_threads, size_t max_inflight_batches,
+              EpochCallback epoch_callback,
+              PartitionMetrics* metrics = nullptr);
+
+  ~LogPipeline();
+
+  void Start();
+
+  // blocks if there are too many batches in flight
+  void Submit(std::shared_ptr<LogBatch> batch);
+
+  // wait for all submitted batches to be applied, and stop the threads
+  void Stop();
+
+ private:
+  struct EdgeTask {
+    seggraph::SegGraph* graph;
+    seggraph::vertex_t v;
+    seggraph::vertex_t nbr;
+    seggraph::label_t label;
+    seggraph::dir_t dir;
+    int epoch;
+    std::string_view data;
+  };
+
+  struct ShardWork {
+    std::vector<EdgeTask> tasks;
+    std::shared_ptr<LogBatch> batch;  // keeps edge properties alive
+  };
+
+  struct Worker {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<ShardWork> queue;
+    std::vector<EdgeTask> pending;  // owned by the sequencer
+    std::thread thread;
+    bool stop = false;
+  };
+
+  void parse_loop_();
+  void parse_batch_(LogBatch& batch);
+  void sequence_loop_();
+  void sequence_batch_(const std::shared_ptr<LogBatch>& batch);
+  void apply_loop_(Worker* worker);
+
+  void dispatch_(const std::shared_ptr<LogBatch>& batch);
+  void drain_();
+  void advance_epoch_(uint64_t epoch, int64_t source_offset);
+
+  size_t shard_of_(const seggraph::SegGraph* graph,
+                   seggraph::vertex_t v) const;
+
+  graph::GraphStore* graph_store_;
+  int num_parse_threads_;
+  int num_apply_threads_;
+  size_t max_inflight_batches_;
+  EpochCallback epoch_callback_;
+  PartitionMetrics* metrics_;  // counts logs on the sequencer, if not null
+  uint64_t epoch_ = 0;
+
+  std::mutex mutex_;  // protects the batch queues and `stop_`
+  std::condition_variable parse_cv_;
+  std::condition_variable sequence_cv_;
+  std::condition_variable submit_cv_;
+  std::deque<std::shared_ptr<LogBatch>> parse_queue_;
+  std::deque<std::shared_ptr<LogBatch>> sequence_queue_;  // in log order
+  bool stop_ = false;
+
+  std::vector<std::thread> parse_threads_;
+  std::thread sequence_thread_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  // number of edge tasks dispatched but not applied
+  std::mutex drain_mutex_;
+  std::condition_variable drain_cv_;
+  size_t inflight_tasks_ = 0;
+};
+
+}  // namespace framework
+}  // namespace gart
+
+#endif  // VEGITO_SRC_FRAMEWORK_LOG_PIPELINE_H_
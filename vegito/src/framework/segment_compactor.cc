@@ -0,0 +1,80 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "framework/segment_compactor.h"
+
+#include <iostream>
+#include <vector>
+
+namespace gart {
+namespace framework {
+
+void SegmentCompactor::Start() {
+  thread_ = std::thread([this] { compact_loop_(); });
+}
+
+void SegmentCompactor::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void SegmentCompactor::compact_loop_() {
+  std::vector<seggraph::SegGraph*> graphs = graph_store_->get_seg_graphs();
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!cv_.wait_for(lock, interval_, [this] { return stop_; })) {
+    // etcd may be slow, so the writer is not held off meanwhile
+    lock.unlock();
+    int64_t min_reader_epoch;
+    bool ok = graph_store_->get_min_reader_epoch(min_reader_epoch);
+    lock.lock();
+    if (!ok) {
+      continue;  // nothing is known to be unread
+    }
+
+    size_t saved_bytes = 0, freed_bytes = 0;
+    for (seggraph::SegGraph* graph : graphs) {
+      graph->set_min_reader_epoch(min_reader_epoch);
+      // the last segment may be being created, and is the newest anyway
+      for (seggraph::segid_t segid = 0; segid < graph->get_max_seg_id();
+           segid++) {
+        auto writer = graph->create_graph_writer(write_epoch_);
+        saved_bytes += writer.compact_segments(segid);
+        // let the writer advance the epoch between segments
+        lock.unlock();
+        lock.lock();
+        if (stop_) {
+          return;
+        }
+      }
+      freed_bytes += graph->recycle_segments(write_epoch_);
+    }
+
+    if (saved_bytes > 0 || freed_bytes > 0) {
+      std::cout << "compact epoch " << write_epoch_
+                << " frag = " << graph_store_->get_local_pid()
+                << " saved = " << saved_bytes << " freed = " << freed_bytes
+                << std::endl;
+    }
+  }
+}
+
+}  // namespace framework
+}  // namespace gart
@@ -0,0 +1,78 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_FRAMEWORK_SEGMENT_COMPACTOR_H_
+#define VEGITO_SRC_FRAMEWORK_SEGMENT_COMPACTOR_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "graph/graph_store.h"
+
+namespace gart {
+namespace framework {
+
+/**
+ * Frees topology blocks that no reader may read, and rewrites segments that
+ * fit in half of their size once deleted edges are dropped, in the
+ * background.
+ *
+ * Readers pin the epoch they read under gart_reader_epoch_p<pid>_<reader> in
+ * etcd, best with a lease so that the pin of a failed reader expires. Other
+ * readers are assumed to lag at most SegGraph::LAG_EPOCH_NUMBER epochs.
+ * Blocks retired in an epoch are freed once all pins are past it.
+ */
+class SegmentCompactor {
+ public:
+  SegmentCompactor(graph::GraphStore* graph_store,
+                   std::chrono::milliseconds interval)
+      : graph_store_(graph_store), interval_(interval) {}
+
+  ~SegmentCompactor() { Stop(); }
+
+  void Start();
+
+  void Stop();
+
+  // holds off compaction, so that the writer may advance the epoch or save a
+  // checkpoint
+  std::unique_lock<std::mutex> Pause() {
+    return std::unique_lock<std::mutex>(mutex_);
+  }
+
+  // while paused, and before the epochs before it are published; blocks are
+  // retired in the epoch being written
+  void set_write_epoch(uint64_t epoch) { write_epoch_ = epoch; }
+
+ private:
+  void compact_loop_();
+
+  graph::GraphStore* graph_store_;
+  std::chrono::milliseconds interval_;
+  uint64_t write_epoch_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool stop_ = false;
+
+  std::thread thread_;
+};
+
+}  // namespace framework
+}  // namespace gart
+
+#endif  // VEGITO_SRC_FRAMEWORK_SEGMENT_COMPACTOR_H_
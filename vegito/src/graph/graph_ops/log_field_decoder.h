@@ -0,0 +1,164 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_GRAPH_GRAPH_OPS_LOG_FIELD_DECODER_H_
+#define VEGITO_SRC_GRAPH_GRAPH_OPS_LOG_FIELD_DECODER_H_
+
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "fragment/unified_log.h"
+#include "graph/type_def.h"
+#include "property/property.h"
+
+namespace gart {
+namespace graph {
+
+// decode one UnifiedLog field into a property slot of a fixed dtype
+using FieldDecoder = void (*)(const LogField& field, char* dst);
+
+template <PropertyStoreDataType DTYPE>
+inline void decode_field(const LogField& field, char* dst);
+
+template <>
+inline void decode_field<INT>(const LogField& field, char* dst) {
+  *reinterpret_cast<int*>(dst) = static_cast<int>(field.as_int64());
+}
+
+template <>
+inline void decode_field<FLOAT>(const LogField& field, char* dst) {
+  *reinterpret_cast<float*>(dst) = static_cast<float>(field.as_double());
+}
+
+template <>
+inline void decode_field<DOUBLE>(const LogField& field, char* dst) {
+  *reinterpret_cast<double*>(dst) = field.as_double();
+}
+
+template <>
+inline void decode_field<LONG>(const LogField& field, char* dst) {
+  *reinterpret_cast<uint64_t*>(dst) = static_cast<uint64_t>(field.as_int64());
+}
+
+template <>
+inline void decode_field<CHAR>(const LogField& field, char* dst) {
+  if (field.type == LogFieldType::kString) {
+    *dst = field.s.empty() ? '\0' : field.s[0];
+  } else {
+    *dst = static_cast<char>(field.as_int64());
+  }
+}
+
+template <>
+inline void decode_field<STRING>(const LogField& field, char* dst) {
+  new (dst) ldbc::String(field.s.data(), field.s.size());
+}
+
+template <>
+inline void decode_field<TEXT>(const LogField& field, char* dst) {
+  new (dst) ldbc::Text(field.s.data(), field.s.size());
+}
+
+template <>
+inline void decode_field<DATE>(const LogField& field, char* dst) {
+  new (dst) ldbc::Date(field.s.data(), field.s.size());
+}
+
+template <>
+inline void decode_field<DATETIME>(const LogField& field, char* dst) {
+  new (dst) ldbc::DateTime(field.s.data(), field.s.size());
+}
+
+template <>
+inline void decode_field<LONGSTRING>(const LogField& field, char* dst) {
+  new (dst) ldbc::LongString(field.s.data(), field.s.size());
+}
+
+inline FieldDecoder get_field_decoder(PropertyStoreDataType dtype) {
+  switch (dtype) {
+  case INT:
+    return decode_field<INT>;
+  case FLOAT:
+    return decode_field<FLOAT>;
+  case DOUBLE:
+    return decode_field<DOUBLE>;
+  case LONG:
+    return decode_field<LONG>;
+  case CHAR:
+    return decode_field<CHAR>;
+  case STRING:
+    return decode_field<STRING>;
+  case TEXT:
+    return decode_field<TEXT>;
+  case DATE:
+    return decode_field<DATE>;
+  case DATETIME:
+    return decode_field<DATETIME>;
+  case LONGSTRING:
+    return decode_field<LONGSTRING>;
+  default:
+    assert(false);
+    return nullptr;
+  }
+}
+
+// a property column of a label, resolved when the schema is loaded
+struct PropColumnDecoder {
+  uint32_t offset;  // in the property row
+  uint32_t width;
+  PropertyStoreDataType dtype;
+  FieldDecoder decode;
+};
+
+// the property row layout of a label, with columns in log field order
+struct PropRowDecoder {
+  std::vector<PropColumnDecoder> cols;
+  uint64_t row_bytes = 0;
+
+  void add_column(uint64_t offset, uint64_t width,
+                  PropertyStoreDataType dtype) {
+    cols.push_back({static_cast<uint32_t>(offset),
+                    static_cast<uint32_t>(width), dtype,
+                    get_field_decoder(dtype)});
+  }
+
+  // columns without a field in the log are zeroed
+  void decode(LogFieldReader fields, char* row) const {
+    LogField field;
+    size_t idx = 0;
+    for (; idx < cols.size() && fields.next(field); idx++) {
+      cols[idx].decode(field, row + cols[idx].offset);
+    }
+    for (; idx < cols.size(); idx++) {
+      memset(row + cols[idx].offset, 0, cols[idx].width);
+    }
+  }
+};
+
+// scratch property row of the calling thread, valid until the next call
+inline char* thread_prop_row(size_t bytes) {
+  thread_local std::vector<char> row;
+  if (row.size() < bytes) {
+    row.resize(bytes);
+  }
+  return row.data();
+}
+
+}  // namespace graph
+}  // namespace gart
+
+#endif  // VEGITO_SRC_GRAPH_GRAPH_OPS_LOG_FIELD_DECODER_H_
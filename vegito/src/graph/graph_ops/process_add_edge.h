@@ -19,6 +19,8 @@
 #include <string>
 #include <vector>
 
+#include "fragment/unified_log.h"
+#include "graph/graph_ops/log_field_decoder.h"
 #include "graph/graph_store.h"
 #include "graph/type_def.h"
 
@@ -26,13 +28,46 @@ namespace gart {
 namespace graph {
 using SegGraph = seggraph::SegGraph;
 using vertex_t = seggraph::vertex_t;
-void process_add_edge(std::vector<std::string> cmd,
-                      graph::GraphStore* graph_store) {
-  int write_epoch = 0, write_seq = 0;
-  write_epoch = stoi(cmd[0]);
-  int elabel = stoi(cmd[1]);
-  uint64_t src_vid = static_cast<uint64_t>(stoll(cmd[2]));
-  uint64_t dst_vid = static_cast<uint64_t>(stoll(cmd[3]));
+// one direction of an edge, written into the adjacency list of `v` in `graph`
+struct EdgeHalf {
+  SegGraph* graph;
+  vertex_t v;
+  seggraph::dir_t dir;
+  vertex_t nbr;
+};
+
+inline const PropRowDecoder& get_edge_prop_decoder(
+    int elabel, graph::GraphStore* graph_store) {
+  return graph_store->get_prop_decoder(
+      elabel + graph_store->get_total_vertex_label_num());
+}
+
+inline uint64_t get_edge_prop_bytes(int elabel,
+                                    graph::GraphStore* graph_store) {
+  return get_edge_prop_decoder(elabel, graph_store).row_bytes;
+}
+
+// whether an add_edge log touches the local fragment
+inline bool is_local_edge(const LogEntry& log,
+                          graph::GraphStore* graph_store) {
+  gart::IdParser<seggraph::vertex_t> parser;
+  parser.Init(graph_store->get_total_partitions(),
+              graph_store->get_total_vertex_label_num());
+  return parser.GetFid(log.src_vid) == graph_store->get_local_pid() ||
+         parser.GetFid(log.dst_vid) == graph_store->get_local_pid();
+}
+
+/**
+ * Map the endpoints of an edge to local ids, and register the remote endpoint
+ * as an outer vertex on first sight. Fills the out-edge and in-edge halves.
+ * The caller must serialize calls, since outer vertex maps are not
+ * thread-safe.
+ */
+inline void resolve_edge_halves(const LogEntry& log, int write_epoch,
+                                graph::GraphStore* graph_store,
+                                EdgeHalf halves[2]) {
+  uint64_t src_vid = log.src_vid;
+  uint64_t dst_vid = log.dst_vid;
   gart::IdParser<seggraph::vertex_t> parser;
   parser.Init(graph_store->get_total_partitions(),
               graph_store->get_total_vertex_label_num());
@@ -40,10 +75,6 @@ void process_add_edge(std::vector<std::string> cmd,
       (((vertex_t) 1) << parser.GetOffsetWidth()) - (seggraph::vertex_t) 1;
   auto src_fid = parser.GetFid(src_vid);
   auto dst_fid = parser.GetFid(dst_vid);
-  if (src_fid != graph_store->get_local_pid() &&
-      dst_fid != graph_store->get_local_pid()) {
-    return;
-  }
   auto src_label = parser.GetLabelId(src_vid);
   auto dst_label = parser.GetLabelId(dst_vid);
 
@@ -51,63 +82,14 @@ void process_add_edge(std::vector<std::string> cmd,
       graph_store->get_graph<seggraph::SegGraph>(src_label);
   seggraph::SegGraph* dst_graph =
       graph_store->get_graph<seggraph::SegGraph>(dst_label);
-  // this `auto` is necessary, the p_write may Transaction or EpochGraphWriter
-  auto src_writer = src_graph->create_graph_writer(write_epoch);  // write epoch
-  auto dst_writer = dst_graph->create_graph_writer(write_epoch);  // write epoch
-
-  // process edge prop
-  uint64_t edge_prop_bytes = graph_store->get_edge_prop_total_bytes(
-      elabel + graph_store->get_total_vertex_label_num());
-  char* prop_buffer = reinterpret_cast<char*>(malloc(edge_prop_bytes));
-  for (auto idx = 4; idx < cmd.size(); idx++) {
-    auto dtype = graph_store->get_edge_property_dtypes(
-        elabel + graph_store->get_total_vertex_label_num(), idx - 4);
-    uint64_t property_offset = graph_store->get_edge_prop_prefix_bytes(
-        elabel + graph_store->get_total_vertex_label_num(), idx - 4);
-    if (dtype == INT) {
-      *reinterpret_cast<int*>(prop_buffer + property_offset) =
-          std::stoi(cmd[idx]);
-    } else if (dtype == FLOAT) {
-      *reinterpret_cast<float*>(prop_buffer + property_offset) =
-          std::stof(cmd[idx]);
-    } else if (dtype == DOUBLE) {
-      *reinterpret_cast<double*>(prop_buffer + property_offset) =
-          std::stod(cmd[idx]);
-    } else if (dtype == LONG) {
-      *reinterpret_cast<uint64_t*>(prop_buffer + property_offset) =
-          std::stoll(cmd[idx]);
-    } else if (dtype == CHAR) {
-      *(prop_buffer + property_offset) = cmd[idx].at(0);
-    } else if (dtype == STRING) {
-      ldbc::String tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::String*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == TEXT) {
-      ldbc::Text tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::Text*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == DATE) {
-      ldbc::Date tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::Date*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == DATETIME) {
-      ldbc::DateTime tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::DateTime*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == LONGSTRING) {
-      ldbc::LongString tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::LongString*>(prop_buffer + property_offset) = tmp;
-    } else {
-      assert(false);
-    }
-  }
-  std::string buf(prop_buffer, edge_prop_bytes);
-  std::string_view edge_data(buf);
-  free(prop_buffer);
 
   if (src_fid == graph_store->get_local_pid() &&
       dst_fid != graph_store->get_local_pid()) {
     seggraph::SegGraph* ov_graph = graph_store->get_ov_graph(dst_label);
-    auto ov_writer = ov_graph->create_graph_writer(write_epoch);
     uint64_t ov = graph_store->get_lid(dst_label, dst_vid);
     if (ov == uint64_t(-1)) {
       // we need to add dst_vertex to outer vertices
+      auto ov_writer = ov_graph->create_graph_writer(write_epoch);
       ov = ov_writer.new_vertex();
       graph_store->set_lid(dst_label, dst_vid, ov);
       auto dst_lid = parser.GenerateId(0, dst_label, max_outer_id_offset - ov);
@@ -117,14 +99,14 @@ void process_add_edge(std::vector<std::string> cmd,
     auto src_offset = parser.GetOffset(src_vid);
     auto src_lid = parser.GenerateId(0, src_label, src_offset);
     auto dst_lid = parser.GenerateId(0, dst_label, max_outer_id_offset - ov);
-    src_writer.put_edge(src_offset, elabel, seggraph::EOUT, dst_lid, edge_data);
-    ov_writer.put_edge(ov, elabel, seggraph::EIN, src_lid, edge_data);
+    halves[0] = {src_graph, (vertex_t) src_offset, seggraph::EOUT, dst_lid};
+    halves[1] = {ov_graph, (vertex_t) ov, seggraph::EIN, src_lid};
   } else if (src_fid != graph_store->get_local_pid() &&
              dst_fid == graph_store->get_local_pid()) {
     SegGraph* ov_graph = graph_store->get_ov_graph(src_label);
-    auto ov_writer = ov_graph->create_graph_writer(write_epoch);
     uint64_t ov = graph_store->get_lid(src_label, src_vid);
     if (ov == uint64_t(-1)) {
+      auto ov_writer = ov_graph->create_graph_writer(write_epoch);
       ov = ov_writer.new_vertex();
       graph_store->set_lid(src_label, src_vid, ov);
       auto src_lid = parser.GenerateId(0, src_label, max_outer_id_offset - ov);
@@ -134,8 +116,8 @@ void process_add_edge(std::vector<std::string> cmd,
     auto dst_offset = parser.GetOffset(dst_vid);
     auto src_lid = parser.GenerateId(0, src_label, max_outer_id_offset - ov);
     auto dst_lid = parser.GenerateId(0, dst_label, dst_offset);
-    ov_writer.put_edge(ov, elabel, seggraph::EOUT, dst_lid, edge_data);
-    dst_writer.put_edge(dst_offset, elabel, seggraph::EIN, src_lid, edge_data);
+    halves[0] = {ov_graph, (vertex_t) ov, seggraph::EOUT, dst_lid};
+    halves[1] = {dst_graph, (vertex_t) dst_offset, seggraph::EIN, src_lid};
   } else {
     auto src_offset = parser.GetOffset(src_vid);
     auto dst_offset = parser.GetOffset(dst_vid);
@@ -143,9 +125,34 @@ void process_add_edge(std::vector<std::string> cmd,
     vertex_t dst_lid = parser.GenerateId(0, dst_label, dst_offset);
 
     // inner edges
-    src_writer.put_edge(src_offset, elabel, seggraph::EOUT, dst_lid, edge_data);
-    dst_writer.put_edge(dst_offset, elabel, seggraph::EIN, src_lid, edge_data);
+    halves[0] = {src_graph, (vertex_t) src_offset, seggraph::EOUT, dst_lid};
+    halves[1] = {dst_graph, (vertex_t) dst_offset, seggraph::EIN, src_lid};
+  }
+}
+
+// returns false if neither endpoint is in the local fragment
+inline bool process_add_edge(const LogEntry& log,
+                             graph::GraphStore* graph_store) {
+  if (!is_local_edge(log, graph_store)) {
+    return false;
+  }
+  int write_epoch = static_cast<int>(log.epoch);
+
+  // process edge prop
+  const PropRowDecoder& decoder =
+      get_edge_prop_decoder(log.elabel, graph_store);
+  char* prop_buffer = thread_prop_row(decoder.row_bytes);
+  decoder.decode(log.fields(), prop_buffer);
+  std::string_view edge_data(prop_buffer, decoder.row_bytes);
+
+  EdgeHalf halves[2];
+  resolve_edge_halves(log, write_epoch, graph_store, halves);
+  for (auto& half : halves) {
+    // this `auto` is necessary, the writer may Transaction or EpochGraphWriter
+    auto writer = half.graph->create_graph_writer(write_epoch);
+    writer.put_edge(half.v, log.elabel, half.dir, half.nbr, edge_data);
   }
+  return true;
 }
 
 }  // namespace graph
@@ -16,24 +16,20 @@
 #ifndef VEGITO_SRC_GRAPH_GRAPH_OPS_PROCESS_ADD_VERTEX_H_
 #define VEGITO_SRC_GRAPH_GRAPH_OPS_PROCESS_ADD_VERTEX_H_
 
+#include "fragment/unified_log.h"
+#include "graph/graph_ops/log_field_decoder.h"
 #include "graph/graph_store.h"
 #include "graph/type_def.h"
 
 namespace gart {
 namespace graph {
-void process_add_vertex(std::vector<std::string> cmd,
-                        graph::GraphStore* graph_store) {
-  int write_epoch = 0, write_seq = 0;
-  write_epoch = stoi(cmd[0]);
-  uint64_t vid = static_cast<uint64_t>(stoll(cmd[1]));
+// insert an inner vertex with properties already decoded in prop_buffer
+inline void insert_vertex(uint64_t vid, int write_epoch, char* prop_buffer,
+                          graph::GraphStore* graph_store) {
+  int write_seq = 0;
   gart::IdParser<seggraph::vertex_t> parser;
   parser.Init(graph_store->get_total_partitions(),
               graph_store->get_total_vertex_label_num());
-
-  auto fid = parser.GetFid(vid);
-  if (fid != graph_store->get_local_pid()) {
-    return;
-  }
   auto vlabel = parser.GetLabelId(vid);
   seggraph::SegGraph* graph =
       graph_store->get_graph<seggraph::SegGraph>(vlabel);
@@ -50,48 +46,27 @@ void process_add_vertex(std::vector<std::string> cmd,
   graph_store->add_inner(vlabel, lid);
 
   // insert property
-  auto prop_schema = graph_store->get_property_schema(vlabel);
-  uint64_t prop_byte_size = graph_store->get_total_property_bytes(vlabel);
-  char* prop_buffer = reinterpret_cast<char*>(malloc(prop_byte_size));
-  for (auto idx = 2; idx < cmd.size(); idx++) {
-    auto dtype = prop_schema.cols[idx - 2].vtype;
-    uint64_t property_offset =
-        graph_store->get_prefix_property_bytes(vlabel, idx - 2);
-    if (dtype == INT) {
-      *reinterpret_cast<int*>(prop_buffer + property_offset) =
-          std::stoi(cmd[idx]);
-    } else if (dtype == FLOAT) {
-      *reinterpret_cast<float*>(prop_buffer + property_offset) =
-          std::stof(cmd[idx]);
-    } else if (dtype == DOUBLE) {
-      *reinterpret_cast<double*>(prop_buffer + property_offset) =
-          std::stod(cmd[idx]);
-    } else if (dtype == LONG) {
-      *reinterpret_cast<uint64_t*>(prop_buffer + property_offset) =
-          std::stoll(cmd[idx]);
-    } else if (dtype == CHAR) {
-      *(prop_buffer + property_offset) = cmd[idx].at(0);
-    } else if (dtype == STRING) {
-      ldbc::String tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::String*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == TEXT) {
-      ldbc::Text tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::Text*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == DATE) {
-      ldbc::Date tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::Date*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == DATETIME) {
-      ldbc::DateTime tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::DateTime*>(prop_buffer + property_offset) = tmp;
-    } else if (dtype == LONGSTRING) {
-      ldbc::LongString tmp(cmd[idx].c_str(), cmd[idx].length());
-      *reinterpret_cast<ldbc::LongString*>(prop_buffer + property_offset) = tmp;
-    } else {
-      assert(false);
-    }
-  }
   property->insert(v, vid, prop_buffer, write_seq, write_epoch);
-  free(prop_buffer);
+}
+
+// returns false if the vertex belongs to another fragment
+inline bool process_add_vertex(const LogEntry& log,
+                               graph::GraphStore* graph_store) {
+  gart::IdParser<seggraph::vertex_t> parser;
+  parser.Init(graph_store->get_total_partitions(),
+              graph_store->get_total_vertex_label_num());
+
+  auto fid = parser.GetFid(log.vid);
+  if (fid != graph_store->get_local_pid()) {
+    return false;
+  }
+  auto vlabel = parser.GetLabelId(log.vid);
+  const PropRowDecoder& decoder = graph_store->get_prop_decoder(vlabel);
+  char* prop_buffer = thread_prop_row(decoder.row_bytes);
+  decoder.decode(log.fields(), prop_buffer);
+  insert_vertex(log.vid, static_cast<int>(log.epoch), prop_buffer,
+                graph_store);
+  return true;
 }
 
 }  // namespace graph
@@ -16,6 +16,7 @@
 #ifndef VEGITO_SRC_GRAPH_GRAPH_OPS_PROCESS_DEL_EDGE_H_
 #define VEGITO_SRC_GRAPH_GRAPH_OPS_PROCESS_DEL_EDGE_H_
 
+#include "fragment/unified_log.h"
 #include "graph/graph_store.h"
 #include "graph/type_def.h"
 
@@ -23,26 +24,19 @@ namespace gart {
 namespace graph {
 using SegGraph = seggraph::SegGraph;
 using vertex_t = seggraph::vertex_t;
-void process_del_edge(std::vector<std::string> cmd,
-                      graph::GraphStore* graph_store) {
+inline void process_del_edge(const LogEntry& log,
+                             graph::GraphStore* graph_store) {
   int write_epoch = 0, write_seq = 0;
-  write_epoch = stoi(cmd[0]);
-  int elabel = stoi(cmd[1]);
-  uint64_t src_vid = static_cast<uint64_t>(stoll(cmd[2]));
-  uint64_t dst_vid = static_cast<uint64_t>(stoll(cmd[3]));
+  write_epoch = static_cast<int>(log.epoch);
+  int elabel = log.elabel;
+  uint64_t src_vid = log.src_vid;
+  uint64_t dst_vid = log.dst_vid;
   gart::IdParser<vertex_t> parser;
   parser.Init(graph_store->get_total_partitions(),
               graph_store->get_total_vertex_label_num());
   auto max_outer_id_offset =
       (((vertex_t) 1) << parser.GetOffsetWidth()) - (vertex_t) 1;
 
-  uint64_t edge_prop_bytes = graph_store->get_edge_prop_total_bytes(
-      elabel + graph_store->get_total_vertex_label_num());
-  char* prop_buffer = reinterpret_cast<char*>(malloc(edge_prop_bytes));
-  memset(prop_buffer, 0, edge_prop_bytes);
-  std::string buf(prop_buffer, edge_prop_bytes);
-  std::string_view edge_data(buf);
-  free(prop_buffer);
   auto src_fid = parser.GetFid(src_vid);
   auto dst_fid = parser.GetFid(dst_vid);
   if (src_fid != graph_store->get_local_pid() &&
@@ -86,162 +80,20 @@ void process_del_edge(std::vector<std::string> cmd,
     dst_graph = graph_store->get_graph<seggraph::SegGraph>(dst_label);
   }
 
-  {
-    auto src_writer =
-        src_graph->create_graph_writer(write_epoch);  // write epoch
-    auto dst_writer = dst_graph->create_graph_writer(write_epoch);
-
-    seggraph::segid_t src_segid =
-        src_graph->get_vertex_seg_id(src_offset_reverse);
-    uint32_t src_segidx = src_graph->get_vertex_seg_idx(src_offset_reverse);
-    seggraph::VegitoSegmentHeader* src_segment =
-        src_writer.locate_segment(src_segid, elabel, seggraph::EOUT);
-    assert(src_segment != nullptr);
-
-    uintptr_t src_edge_block_pointer = src_segment->get_region_ptr(src_segidx);
-    seggraph::VegitoEdgeBlockHeader* src_edge_block =
-        src_graph->get_block_manager().convert<seggraph::VegitoEdgeBlockHeader>(
-            src_edge_block_pointer);
-    assert(src_edge_block != nullptr);
-    size_t src_num_entries = src_edge_block->get_num_entries();
-    seggraph::VegitoEdgeEntry* src_entries = src_edge_block->get_entries();
-    seggraph::VegitoEdgeEntry* src_entries_cursor =
-        src_entries - src_num_entries;
-
-    std::vector<uint64_t> src_prefix_sum;
-    seggraph::VegitoEdgeBlockHeader* src_cur_header = src_edge_block;
-    while (src_cur_header) {
-      src_prefix_sum.push_back(src_cur_header->get_num_entries());
-
-      src_cur_header = src_graph->get_block_manager()
-                           .convert<seggraph::VegitoEdgeBlockHeader>(
-                               src_cur_header->get_prev_pointer());
-    }
-
-    src_prefix_sum[0] = 0;
-    for (auto i = 0; i < src_prefix_sum.size() - 1; i++) {
-      src_prefix_sum[i] = 0;
-      for (auto j = i + 1; j < src_prefix_sum.size(); j++) {
-        src_prefix_sum[i] += src_prefix_sum[j];
-      }
-    }
-    src_prefix_sum[src_prefix_sum.size() - 1] = 0;
-
-    int src_segment_idx = 0;
-    bool is_founded = false;
-
-    while (true) {
-      while (src_entries_cursor != src_entries) {
-        seggraph::vertex_t vid = src_entries_cursor->get_dst();
-
-        auto delete_flag = vid >> (sizeof(seggraph::vertex_t) * 8 - 1);
-        if (parser.GetOffset(vid) == dst_offset && delete_flag != 1) {
-          is_founded = true;
-          auto del_loc = src_entries - src_entries_cursor - 1 +
-                         src_prefix_sum[src_segment_idx];
-
-          auto mask = ((seggraph::vertex_t) 1)
-                      << (sizeof(seggraph::vertex_t) * 8 - 1);
-          del_loc = del_loc | mask;
-          src_writer.put_edge(src_offset_reverse, elabel, seggraph::EOUT,
-                              del_loc, edge_data);
-          break;
-        }
-        src_entries_cursor++;
-      }
-      if (is_founded == true) {
-        break;
-      }
-      src_edge_block = src_graph->get_block_manager()
-                           .convert<seggraph::VegitoEdgeBlockHeader>(
-                               src_edge_block->get_prev_pointer());
-      if (!src_edge_block) {
-        break;
-      } else {
-        src_entries = src_edge_block->get_entries();
-        auto src_num_entries = src_edge_block->get_num_entries();
-        src_entries_cursor = src_entries - src_num_entries;  // at the begining
-        src_segment_idx++;
-      }
-    }
-    if (is_founded == false) {
-      LOG(ERROR) << "delete edge error";
-    }
-
-    is_founded = false;
-    // process dst vertex
-    seggraph::segid_t dst_segid =
-        dst_graph->get_vertex_seg_id(dst_offset_reverse);
-    uint32_t dst_segidx = dst_graph->get_vertex_seg_idx(dst_offset_reverse);
-    seggraph::VegitoSegmentHeader* dst_segment =
-        dst_writer.locate_segment(dst_segid, elabel, seggraph::EIN);
-    assert(dst_segment != nullptr);
-
-    uintptr_t dst_edge_block_pointer = dst_segment->get_region_ptr(dst_segidx);
-    seggraph::VegitoEdgeBlockHeader* dst_edge_block =
-        dst_graph->get_block_manager().convert<seggraph::VegitoEdgeBlockHeader>(
-            dst_edge_block_pointer);
-    assert(dst_edge_block != nullptr);
-    size_t dst_num_entries = dst_edge_block->get_num_entries();
-    seggraph::VegitoEdgeEntry* dst_entries = dst_edge_block->get_entries();
-    seggraph::VegitoEdgeEntry* dst_entries_cursor =
-        dst_entries - dst_num_entries;
-
-    std::vector<uint64_t> dst_prefix_sum;
-    seggraph::VegitoEdgeBlockHeader* dst_cur_header = dst_edge_block;
-    while (dst_cur_header) {
-      dst_prefix_sum.push_back(dst_cur_header->get_num_entries());
-      dst_cur_header = dst_graph->get_block_manager()
-                           .convert<seggraph::VegitoEdgeBlockHeader>(
-                               dst_cur_header->get_prev_pointer());
-    }
-
-    dst_prefix_sum[0] = 0;
-    for (auto i = 0; i < dst_prefix_sum.size() - 1; i++) {
-      dst_prefix_sum[i] = 0;
-      for (auto j = i + 1; j < dst_prefix_sum.size(); j++) {
-        dst_prefix_sum[i] += dst_prefix_sum[j];
-      }
-    }
-    dst_prefix_sum[dst_prefix_sum.size() - 1] = 0;
-    int dst_segment_idx = 0;
-
-    while (true) {
-      while (dst_entries_cursor != dst_entries) {
-        seggraph::vertex_t vid = dst_entries_cursor->get_dst();
-        auto delete_flag = vid >> (sizeof(seggraph::vertex_t) * 8 - 1);
-        if (parser.GetOffset(vid) == src_offset && delete_flag != 1) {
-          is_founded = true;
-          auto del_loc = dst_entries - dst_entries_cursor - 1 +
-                         dst_prefix_sum[dst_segment_idx];
+  auto src_writer = src_graph->create_graph_writer(write_epoch);
+  if (src_writer.delete_edges(
+          src_offset_reverse, elabel, seggraph::EOUT,
+          [&](vertex_t vid) { return parser.GetOffset(vid) == dst_offset; },
+          1) == 0) {
+    LOG(ERROR) << "delete edge error";
+  }
 
-          auto mask = ((seggraph::vertex_t) 1)
-                      << (sizeof(seggraph::vertex_t) * 8 - 1);
-          del_loc = del_loc | mask;
-          dst_writer.put_edge(dst_offset_reverse, elabel, seggraph::EIN,
-                              del_loc, edge_data);
-          break;
-        }
-        dst_entries_cursor++;
-      }
-      if (is_founded == true) {
-        break;
-      }
-      dst_edge_block = dst_graph->get_block_manager()
-                           .convert<seggraph::VegitoEdgeBlockHeader>(
-                               dst_edge_block->get_prev_pointer());
-      if (!dst_edge_block) {
-        break;
-      } else {
-        dst_entries = dst_edge_block->get_entries();
-        auto dst_num_entries = dst_edge_block->get_num_entries();
-        dst_entries_cursor = dst_entries - dst_num_entries;  // at the begining
-        dst_segment_idx++;
-      }
-    }
-    if (is_founded == false) {
-      LOG(ERROR) << "delete edge error";
-    }
+  auto dst_writer = dst_graph->create_graph_writer(write_epoch);
+  if (dst_writer.delete_edges(
+          dst_offset_reverse, elabel, seggraph::EIN,
+          [&](vertex_t vid) { return parser.GetOffset(vid) == src_offset; },
+          1) == 0) {
+    LOG(ERROR) << "delete edge error";
   }
 }
 }  // namespace graph
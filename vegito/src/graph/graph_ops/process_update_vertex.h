@@ -0,0 +1,78 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_GRAPH_GRAPH_OPS_PROCESS_UPDATE_VERTEX_H_
+#define VEGITO_SRC_GRAPH_GRAPH_OPS_PROCESS_UPDATE_VERTEX_H_
+
+#include <vector>
+
+#include "fragment/unified_log.h"
+#include "graph/graph_ops/log_field_decoder.h"
+#include "graph/graph_store.h"
+#include "graph/type_def.h"
+
+namespace gart {
+namespace graph {
+// write the changed properties of an inner vertex as a new version, so only
+// the pages of the changed columns are copied.
+// returns false if the vertex belongs to another fragment
+inline bool process_update_vertex(const LogEntry& log,
+                                  graph::GraphStore* graph_store) {
+  gart::IdParser<seggraph::vertex_t> parser;
+  parser.Init(graph_store->get_total_partitions(),
+              graph_store->get_total_vertex_label_num());
+
+  auto fid = parser.GetFid(log.vid);
+  if (fid != graph_store->get_local_pid()) {
+    return false;
+  }
+  auto vlabel = parser.GetLabelId(log.vid);
+  auto voffset = parser.GetOffset(log.vid);
+  const PropRowDecoder& decoder = graph_store->get_prop_decoder(vlabel);
+  char* prop_buffer = thread_prop_row(decoder.row_bytes);
+
+  // fields are pairs of a property index and its new value
+  thread_local std::vector<int> cids;
+  cids.clear();
+  LogFieldReader fields = log.fields();
+  LogField field;
+  while (fields.next(field)) {
+    int64_t cid = field.as_int64();
+    if (!fields.next(field)) {
+      // an empty value at the end of a text log
+      field = LogField();
+    }
+    if (cid < 0 || cid >= static_cast<int64_t>(decoder.cols.size())) {
+      LOG(ERROR) << "Unknown property " << cid << " of vertex label "
+                 << vlabel;
+      continue;
+    }
+    const PropColumnDecoder& col = decoder.cols[cid];
+    col.decode(field, prop_buffer + col.offset);
+    cids.push_back(static_cast<int>(cid));
+  }
+  if (cids.empty()) {
+    return true;
+  }
+
+  Property* property = graph_store->get_property(vlabel);
+  property->update(voffset, cids, prop_buffer, 0, log.epoch);
+  return true;
+}
+
+}  // namespace graph
+}  // namespace gart
+
+#endif  // VEGITO_SRC_GRAPH_GRAPH_OPS_PROCESS_UPDATE_VERTEX_H_
@@ -15,6 +15,16 @@
 
 #include "graph/graph_store.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "etcd/v3/action_constants.hpp"
+
+#include "util/checkpoint_io.h"
+
 namespace gart {
 namespace graph {
 
@@ -25,6 +35,9 @@ GraphStore::~GraphStore() {
     array_allocator.deallocate_v6d(vertex_table_oid);
     array_allocator.deallocate_v6d(ovl2g_oid);
   }
+  for (const auto& blob : retired_blobs_) {
+    array_allocator.deallocate_v6d(blob.first);
+  }
 }
 
 template <>
@@ -68,6 +81,7 @@ void GraphStore::add_vgraph(uint64_t vlabel, RGMapping* rg_map) {
   ov_seg_graphs_[vlabel] = new seggraph::SegGraph(rg_map);
   auto& ov_schema = ov_seg_graphs_[vlabel]->get_blob_schema();
   blob_schema.set_ov_block_oid(ov_schema.get_block_oid());
+  blob_schema.set_ov_block_extents(ov_schema.get_block_extents());
   blob_schema.set_ov_elabel2segs(ov_schema.get_elabel2segs());
 
   // add common information
@@ -101,6 +115,7 @@ void GraphStore::add_vgraph(uint64_t vlabel, RGMapping* rg_map) {
     vineyard::ObjectID oid;
     uint64_t max_v = ov_seg_graphs_[vlabel]->get_vertex_capacity();
     ovl2gs_[vlabel] = alloc.allocate_v6d(max_v, oid);
+    ovl2g_sizes_[vlabel] = max_v;
     gart::ArrayMeta meta(oid, max_v);
     blob_schema.set_ovl2g_meta(meta);
   }
@@ -108,11 +123,86 @@ void GraphStore::add_vgraph(uint64_t vlabel, RGMapping* rg_map) {
   blob_schemas_[vlabel] = blob_schema;
 }
 
+void GraphStore::grow_vertex_table_(uint64_t vlabel, uint64_t size) {
+  auto alloc = std::allocator_traits<decltype(
+      array_allocator)>::rebind_alloc<seggraph::vertex_t>(array_allocator);
+
+  VTable& vtable = vertex_tables_[vlabel];
+  gart::BlobSchema& blob_schema = blob_schemas_[vlabel];
+  vineyard::ObjectID oid;
+  seggraph::vertex_t* table = alloc.allocate_v6d(size, oid);
+  uint64_t shift = size - vtable.size;
+  memcpy(table, vtable.table,
+         vtable.max_inner_location * sizeof(seggraph::vertex_t));
+  // outer vertices move to the new back, along with the locations their
+  // deletions refer to
+  uint64_t delete_mask = ((uint64_t) 1) << (sizeof(uint64_t) * 8 - 1);
+  for (uint64_t i = vtable.min_outer_location; i < vtable.size; i++) {
+    seggraph::vertex_t value = vtable.table[i];
+    table[i + shift] = (value & delete_mask) ? value + shift : value;
+  }
+
+  retired_blobs_.emplace_back(blob_schema.get_vertex_table_oid(), -1);
+  vtable.table = table;
+  vtable.size = size;
+  vtable.min_outer += shift;
+  vtable.min_outer_location += shift;
+  blob_schema.set_vtable_meta(gart::VTableMeta(oid, size));
+}
+
+void GraphStore::grow_ovl2g_(uint64_t vlabel, uint64_t size) {
+  auto alloc = std::allocator_traits<decltype(
+      array_allocator)>::rebind_alloc<uint64_t>(array_allocator);
+
+  gart::BlobSchema& blob_schema = blob_schemas_[vlabel];
+  size = std::max(size, ovl2g_sizes_[vlabel] * 2);
+  vineyard::ObjectID oid;
+  uint64_t* ovl2g = alloc.allocate_v6d(size, oid);
+  memcpy(ovl2g, ovl2gs_[vlabel], ovl2g_sizes_[vlabel] * sizeof(uint64_t));
+
+  retired_blobs_.emplace_back(blob_schema.get_ovl2g_oid(), -1);
+  ovl2gs_[vlabel] = ovl2g;
+  ovl2g_sizes_[vlabel] = size;
+  blob_schema.set_ovl2g_meta(gart::ArrayMeta(oid, size));
+}
+
+void GraphStore::compile_prop_decoders() {
+  uint64_t label_num = total_vertex_label_num_;
+  for (auto& [elabel, bytes] : edge_property_bytes_) {
+    label_num = std::max(label_num, elabel + 1);
+  }
+  prop_decoders_.assign(label_num, PropRowDecoder());
+
+  for (auto& [vlabel, schema] : property_schemas_) {
+    PropRowDecoder& decoder = prop_decoders_[vlabel];
+    for (uint64_t idx = 0; idx < schema.cols.size(); idx++) {
+      decoder.add_column(get_prefix_property_bytes(vlabel, idx),
+                         schema.cols[idx].vlen, schema.cols[idx].vtype);
+    }
+    decoder.row_bytes = get_total_property_bytes(vlabel);
+  }
+
+  for (auto& [elabel, bytes] : edge_property_bytes_) {
+    PropRowDecoder& decoder = prop_decoders_[elabel];
+    uint64_t prop_num = get_edge_property_num(elabel);
+    for (uint64_t idx = 0; idx < prop_num; idx++) {
+      uint64_t offset = get_edge_prop_prefix_bytes(elabel, idx);
+      uint64_t next = idx + 1 < prop_num
+                          ? get_edge_prop_prefix_bytes(elabel, idx + 1)
+                          : bytes;
+      decoder.add_column(offset, next - offset,
+                         static_cast<PropertyStoreDataType>(
+                             get_edge_property_dtypes(elabel, idx)));
+    }
+    decoder.row_bytes = bytes;
+  }
+}
+
 void GraphStore::add_vprop(uint64_t vlabel, Property::Schema schema) {
   assert(seg_graphs_[vlabel]);
 
   property_schemas_[vlabel] = schema;
-  uint64_t v_capacity = seg_graphs_[vlabel]->get_vertex_capacity();
+  uint64_t v_capacity = kPropertyCapacity;
 
   switch (schema.store_type) {
   case PROP_COLUMN: {
@@ -146,6 +236,163 @@ void GraphStore::update_blob(uint64_t blob_epoch) {
         ov_graph->get_max_vertex_id() + ov_graph->get_deleted_outer_num());
   }
   blob_epoch_ = blob_epoch;
+
+  // epochs from `blob_epoch` on are published with the grown blobs
+  if (seg_graphs_.empty()) {
+    return;
+  }
+  int64_t min_read_epoch =
+      seg_graphs_.begin()->second->get_min_read_epoch(blob_epoch);
+  for (auto iter = retired_blobs_.begin(); iter != retired_blobs_.end();) {
+    if (iter->second < 0) {
+      iter->second = blob_epoch;
+    }
+    if (iter->second <= min_read_epoch) {
+      array_allocator.deallocate_v6d(iter->first);
+      iter = retired_blobs_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+namespace {
+constexpr uint64_t kCheckpointMagic = 0x47415254434b5032ul;  // "GARTCKP2"
+}  // namespace
+
+bool GraphStore::save_checkpoint(const std::string& path, uint64_t epoch,
+                                 int64_t offset) {
+  // write to a temporary file first, a crash never leaves a partial one
+  std::string tmp_path = path + ".tmp";
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    LOG(ERROR) << "Checkpoint file (" << tmp_path << ") open failed.";
+    return false;
+  }
+
+  util::CheckpointWriter writer(out);
+  writer.Write(kCheckpointMagic);
+  writer.Write(local_pid_);
+  writer.Write(total_partitions_);
+  writer.Write(epoch);
+  writer.Write(offset);
+  writer.Write(blob_schemas_.size());
+  for (const auto& pair : blob_schemas_) {
+    uint64_t vlabel = pair.first;
+    writer.Write(vlabel);
+    seg_graphs_[vlabel]->checkpoint(writer);
+    ov_seg_graphs_[vlabel]->checkpoint(writer);
+
+    // inner vertices grow from the front, outer ones from the back
+    const VTable& vtable = vertex_tables_[vlabel];
+    writer.Write(vtable.size);
+    writer.Write(vtable.max_inner);
+    writer.Write(vtable.min_outer);
+    writer.Write(vtable.min_outer_location);
+    writer.WriteArray(vtable.table, vtable.max_inner_location);
+    writer.WriteArray(vtable.table + vtable.min_outer_location,
+                      vtable.size - vtable.min_outer_location);
+
+    writer.WriteArray(ovl2gs_[vlabel],
+                      ov_seg_graphs_[vlabel]->get_max_vertex_id());
+    writer.WriteMap(key_lid_map_[vlabel]);
+
+    bool has_property = property_stores_[vlabel] != nullptr;
+    writer.Write(has_property);
+    if (has_property) {
+      property_stores_[vlabel]->checkpoint(writer);
+    }
+  }
+  out.close();
+  if (!writer.ok() || out.fail()) {
+    LOG(ERROR) << "Checkpoint file (" << tmp_path << ") write failed.";
+    return false;
+  }
+
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Checkpoint file (" << path << ") rename failed.";
+    return false;
+  }
+  return true;
+}
+
+bool GraphStore::load_checkpoint(const std::string& path, uint64_t& epoch,
+                                 int64_t& offset) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    LOG(ERROR) << "Checkpoint file (" << path << ") open failed.";
+    return false;
+  }
+
+  util::CheckpointReader reader(in);
+  if (reader.Read<uint64_t>() != kCheckpointMagic ||
+      reader.Read<int>() != local_pid_ ||
+      reader.Read<int>() != total_partitions_) {
+    LOG(ERROR) << "Checkpoint file (" << path
+               << ") does not belong to partition " << local_pid_;
+    return false;
+  }
+  epoch = reader.Read<uint64_t>();
+  offset = reader.Read<int64_t>();
+
+  if (reader.Read<size_t>() != blob_schemas_.size()) {
+    LOG(ERROR) << "Checkpoint file (" << path
+               << ") does not match the graph schema";
+    return false;
+  }
+  for (const auto& pair : blob_schemas_) {
+    uint64_t vlabel = pair.first;
+    if (reader.Read<uint64_t>() != vlabel ||
+        !seg_graphs_[vlabel]->restore(reader) ||
+        !ov_seg_graphs_[vlabel]->restore(reader)) {
+      reader.Fail();
+      break;
+    }
+
+    VTable& vtable = vertex_tables_[vlabel];
+    uint64_t vtable_size = reader.Read<uint64_t>();
+    if (vtable_size > vtable.size) {
+      grow_vertex_table_(vlabel, vtable_size);
+    } else if (vtable_size < vtable.size) {
+      reader.Fail();
+      break;
+    }
+    vtable.max_inner = reader.Read<uint64_t>();
+    vtable.min_outer = reader.Read<uint64_t>();
+    vtable.min_outer_location = reader.Read<uint64_t>();
+    if (vtable.min_outer_location > vtable.size) {
+      reader.Fail();
+      break;
+    }
+    vtable.max_inner_location =
+        reader.ReadArray(vtable.table, vtable.min_outer_location);
+    if (reader.ReadArray(vtable.table + vtable.min_outer_location,
+                         vtable.size - vtable.min_outer_location) !=
+        vtable.size - vtable.min_outer_location) {
+      reader.Fail();
+      break;
+    }
+
+    uint64_t num_outer = ov_seg_graphs_[vlabel]->get_max_vertex_id();
+    if (num_outer > ovl2g_sizes_[vlabel]) {
+      grow_ovl2g_(vlabel, num_outer);
+    }
+    reader.ReadArray(ovl2gs_[vlabel], ovl2g_sizes_[vlabel]);
+    reader.ReadMap(key_lid_map_[vlabel]);
+
+    bool has_property = reader.Read<bool>();
+    if (has_property != (property_stores_[vlabel] != nullptr) ||
+        (has_property && !property_stores_[vlabel]->restore(reader))) {
+      reader.Fail();
+      break;
+    }
+  }
+  if (!reader.ok()) {
+    LOG(ERROR) << "Checkpoint file (" << path << ") is corrupted.";
+    return false;
+  }
+  update_offset();
+  return true;
 }
 
 namespace {
@@ -353,16 +600,16 @@ std::string SchemaImpl::get_json(bool gie, int pid) {
   return graph_schema.dump();
 }
 
-void GraphStore::get_blob_json(uint64_t write_epoch) const {
+std::string GraphStore::get_blob_json(uint64_t write_epoch) const {
   using json = vineyard::json;
   json blob_schema;
+  auto blob_schemas = fetch_blob_schema(write_epoch);
   blob_schema["ipc_socket"] = gart::framework::config.getIPCScoket();
   blob_schema["machine id"] = mid_;
   blob_schema["fid"] = local_pid_;
-  blob_schema["fnum"] = local_pnum_;
+  blob_schema["fnum"] = total_partitions_;
   blob_schema["epoch"] = write_epoch;
-  blob_schema["vertex_label_num"] = blob_schemas_.size();
-  auto blob_schemas = fetch_blob_schema(write_epoch);
+  blob_schema["vertex_label_num"] = blob_schemas.size();
   json blob_array = json::array();
   for (const auto& pair : blob_schemas) {
     uint64_t vlabel = pair.first;
@@ -371,20 +618,105 @@ void GraphStore::get_blob_json(uint64_t write_epoch) const {
   }
   blob_schema["blob"] = blob_array;
 
-  std::string blob_schema_str = blob_schema.dump();
-  std::string blob_json_key =
-      FLAGS_meta_prefix + "gart_blob_m" + std::to_string(0) + "_p" +
-      std::to_string(local_pid_) + "_e" + std::to_string(write_epoch);
+  return blob_schema.dump();
+}
 
-  auto response_task = etcd_client_->put(blob_json_key, blob_schema_str).get();
-  assert(response_task.is_ok());
+void GraphStore::put_blob_json(
+    const std::vector<uint64_t>& write_epochs) const {
+  if (write_epochs.empty()) {
+    return;
+  }
+
+  // issue the puts together, so that coalesced epochs share round trips
+  std::vector<pplx::task<etcd::Response>> tasks;
+  for (uint64_t write_epoch : write_epochs) {
+    std::string blob_json_key =
+        FLAGS_meta_prefix + "gart_blob_m" + std::to_string(0) + "_p" +
+        std::to_string(local_pid_) + "_e" + std::to_string(write_epoch);
+    tasks.push_back(
+        etcd_client_->put(blob_json_key, get_blob_json(write_epoch)));
+  }
+  for (auto& task : tasks) {
+    auto response_task = task.get();
+    assert(response_task.is_ok());
+  }
 
+  // readers may only see an epoch after its blob schema is in etcd
+  uint64_t write_epoch =
+      *std::max_element(write_epochs.begin(), write_epochs.end());
   std::string latest_epoch =
       FLAGS_meta_prefix + "gart_latest_epoch_p" + std::to_string(local_pid_);
-  response_task =
+  auto response_task =
       etcd_client_->put(latest_epoch, std::to_string(write_epoch)).get();
   assert(response_task.is_ok());
 }
 
+void GraphStore::put_metrics_json(const std::string& metrics_json) const {
+  std::string metrics_key =
+      FLAGS_meta_prefix + "gart_ingest_metrics_p" + std::to_string(local_pid_);
+  auto response_task = etcd_client_->put(metrics_key, metrics_json).get();
+  if (!response_task.is_ok()) {
+    LOG(ERROR) << "Put " << metrics_key
+               << " failed: " << response_task.error_message();
+  }
+}
+
+bool GraphStore::get_min_reader_epoch(int64_t& epoch) const {
+  std::string pin_prefix = FLAGS_meta_prefix + "gart_reader_epoch_p" +
+                           std::to_string(local_pid_) + "_";
+  auto response = etcd_client_->ls(pin_prefix).get();
+  if (!response.is_ok()) {
+    // no pin at all is not an error
+    if (response.error_code() == etcdv3::ERROR_KEY_NOT_FOUND) {
+      epoch = INT64_MAX;
+      return true;
+    }
+    LOG(ERROR) << "List " << pin_prefix
+               << " failed: " << response.error_message();
+    return false;
+  }
+
+  epoch = INT64_MAX;
+  for (const auto& value : response.values()) {
+    std::string pinned = value.as_string();
+    char* end = nullptr;
+    int64_t pinned_epoch = strtoll(pinned.c_str(), &end, 10);
+    if (pinned.empty() || *end != '\0') {
+      LOG(ERROR) << "Invalid reader epoch " << pinned << " of "
+                 << value.key();
+      continue;
+    }
+    epoch = std::min(epoch, pinned_epoch);
+  }
+  return true;
+}
+
+std::vector<seggraph::SegGraph*> GraphStore::get_seg_graphs() const {
+  std::vector<seggraph::SegGraph*> ret;
+  for (auto* graphs : {&seg_graphs_, &ov_seg_graphs_}) {
+    for (auto& [vlabel, graph] : *graphs) {
+      if (graph) {
+        ret.push_back(graph);
+      }
+    }
+  }
+  return ret;
+}
+
+GraphStore::StorageStats GraphStore::get_storage_stats() {
+  StorageStats stats;
+  for (seggraph::SegGraph* graph : get_seg_graphs()) {
+    seggraph::BlockManager& block_manager = graph->get_block_manager();
+    stats.block_used_bytes += block_manager.get_used_bytes();
+    stats.block_free_bytes += block_manager.get_free_bytes();
+  }
+  for (auto& [vlabel, property] : property_stores_) {
+    if (property) {
+      stats.prop_page_allocs += property->getNumPageAllocs();
+    }
+  }
+  return stats;
+}
+
 }  // namespace graph
 }  // namespace gart
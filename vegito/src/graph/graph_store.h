@@ -16,11 +16,16 @@
 #ifndef VEGITO_SRC_GRAPH_GRAPH_STORE_H_
 #define VEGITO_SRC_GRAPH_GRAPH_STORE_H_
 
+#include <mutex>
+#include <utility>
+#include <vector>
+
 #include "etcd/Client.hpp"
 #include "etcd/Response.hpp"
 #include "glog/logging.h"
 
 #include "fragment/id_parser.h"
+#include "graph/graph_ops/log_field_decoder.h"
 #include "property/property_col_array.h"
 #include "property/property_col_paged.h"
 #include "seggraph/core/seggraph.hpp"
@@ -29,6 +34,10 @@
 namespace gart {
 namespace graph {
 
+// rows of the property columns of a vertex label; vertex topology grows on
+// demand, but the columns are preallocated and inserting past them is fatal
+constexpr uint64_t kPropertyCapacity = 1ul << 20;
+
 struct SchemaImpl {
   // property name -> property idx
   std::unordered_map<std::string, int> property_id_map;
@@ -52,6 +61,8 @@ struct SchemaImpl {
 
 class GraphStore {
  public:
+  // inner vertices grow from the front, outer ones from the back; the table
+  // is moved to a larger blob when both ends meet
   struct VTable {
     seggraph::vertex_t* table;
     uint64_t size;
@@ -63,12 +74,15 @@ class GraphStore {
   };
 
   GraphStore(int local_pid = 0, int mid = 0, int total_partitions = 0,
-             int total_vertex_label_num = 1)
+             int local_partitions = 1,
+             std::shared_ptr<etcd::Client> etcd_client = nullptr)
       : local_pid_(local_pid),
         mid_(mid),
-        local_pnum_(total_partitions),
+        local_pnum_(local_partitions),
         total_partitions_(total_partitions),
-        etcd_client_(std::make_shared<etcd::Client>(FLAGS_etcd_endpoint)) {}
+        etcd_client_(etcd_client ? etcd_client
+                                 : std::make_shared<etcd::Client>(
+                                       FLAGS_etcd_endpoint)) {}
 
   ~GraphStore();
 
@@ -97,6 +111,7 @@ class GraphStore {
   inline uint64_t get_mid() const { return mid_; }
   inline uint64_t get_local_pid() const { return local_pid_; }
   inline int get_total_partitions() const { return total_partitions_; }
+  inline int get_local_partition_num() const { return local_pnum_; }
   inline int get_total_vertex_label_num() const {
     return total_vertex_label_num_;
   }
@@ -121,24 +136,55 @@ class GraphStore {
 
   void update_blob(uint64_t blob_epoch);
 
-  void get_blob_json(uint64_t write_epoch) const;
+  // serialize the blob schemas of a published epoch
+  std::string get_blob_json(uint64_t write_epoch) const;
+
+  // put blob schemas of epochs to etcd, then advance the latest epoch
+  void put_blob_json(const std::vector<uint64_t>& write_epochs) const;
 
   void put_schema();
 
+  // put the ingest metrics of the partition next to its latest epoch
+  void put_metrics_json(const std::string& metrics_json) const;
+
+  // the oldest epoch pinned by readers of the partition under
+  // gart_reader_epoch_p<pid>_<reader>, INT64_MAX if none; false if etcd fails
+  bool get_min_reader_epoch(int64_t& epoch) const;
+
+  // topology of the inner and outer vertices of all vertex labels
+  std::vector<seggraph::SegGraph*> get_seg_graphs() const;
+
+  struct StorageStats {
+    uint64_t block_used_bytes = 0;  // taken from the topology blobs
+    uint64_t block_free_bytes = 0;  // in free lists, part of the above
+    uint64_t prop_page_allocs = 0;
+  };
+
+  // must not run with writers
+  StorageStats get_storage_stats();
+
+  // save the store at an epoch boundary, along with the position of the log
+  // stream to resume from; must not run with writers
+  bool save_checkpoint(const std::string& path, uint64_t epoch,
+                       int64_t offset);
+
+  // restore a checkpoint into a store built from the same schema
+  bool load_checkpoint(const std::string& path, uint64_t& epoch,
+                       int64_t& offset);
+
   seggraph::SegGraph* get_ov_graph(uint64_t vlabel) {
     return ov_seg_graphs_[vlabel];
   }
 
   inline void add_inner(uint64_t vlabel, seggraph::vertex_t lid) {
-    VTable& vtable = vertex_tables_[vlabel];
-    assert(vtable.max_inner_location != vtable.min_outer_location);
+    VTable& vtable = reserve_vtable_slot_(vlabel);
     vtable.table[vtable.max_inner_location] = lid;
     ++vtable.max_inner_location;
     ++vtable.max_inner;
   }
 
   inline void delete_inner(uint64_t vlabel, seggraph::vertex_t offset) {
-    VTable& vtable = vertex_tables_[vlabel];
+    VTable& vtable = reserve_vtable_slot_(vlabel);
     for (auto i = 0; i < vtable.max_inner_location; i++) {
       auto value = vtable.table[i];
       auto delete_flag = value >> (sizeof(seggraph::vertex_t) * 8 - 1);
@@ -157,15 +203,14 @@ class GraphStore {
   }
 
   inline void add_outer(uint64_t vlabel, seggraph::vertex_t lid) {
-    VTable& vtable = vertex_tables_[vlabel];
-    assert(vtable.max_inner_location != vtable.min_outer_location);
+    VTable& vtable = reserve_vtable_slot_(vlabel);
     vtable.table[vtable.min_outer_location - 1] = lid;
     --vtable.min_outer;
     --vtable.min_outer_location;
   }
 
   inline void delete_outer(uint64_t vlabel, seggraph::vertex_t lid) {
-    VTable& vtable = vertex_tables_[vlabel];
+    VTable& vtable = reserve_vtable_slot_(vlabel);
     gart::IdParser<seggraph::vertex_t> parser;
     parser.Init(get_total_partitions(), get_total_vertex_label_num());
     for (auto i = vtable.size - 1; i >= vtable.min_outer_location; i--) {
@@ -185,11 +230,13 @@ class GraphStore {
   }
 
   inline void insert_blob_schema(uint64_t write_epoch) {
+    std::lock_guard<std::mutex> lock(history_blob_mutex_);
     history_blob_schemas_[write_epoch] = blob_schemas_;
   }
 
   std::map<uint64_t, gart::BlobSchema> fetch_blob_schema(
       uint64_t write_epoch) const {
+    std::lock_guard<std::mutex> lock(history_blob_mutex_);
     auto iter = history_blob_schemas_.find(write_epoch);
     assert(iter != history_blob_schemas_.end());
     return iter->second;
@@ -197,6 +244,9 @@ class GraphStore {
 
   inline void set_ovl2g(uint64_t vlabel, uint64_t offset,
                         seggraph::vertex_t gid) {
+    if (offset >= ovl2g_sizes_[vlabel]) {
+      grow_ovl2g_(vlabel, offset + 1);
+    }
     ovl2gs_[vlabel][offset] = gid;
   }
 
@@ -246,6 +296,15 @@ class GraphStore {
     }
   }
 
+  // flatten the property layouts of all labels for the log decoders, after
+  // update_property_bytes()
+  void compile_prop_decoders();
+
+  // label is a vertex label or an absolute edge label
+  inline const PropRowDecoder& get_prop_decoder(uint64_t label) const {
+    return prop_decoders_[label];
+  }
+
   uint64_t get_total_property_bytes(uint64_t vlabel) {
     return property_bytes_[vlabel];
   }
@@ -273,6 +332,13 @@ class GraphStore {
 
   void insert_edge_property_dtypes(uint64_t elabel, uint64_t idx, int dtype) {
     edge_property_dtypes_.emplace(std::make_pair(elabel, idx), dtype);
+    uint64_t& num = edge_property_num_[elabel];
+    num = std::max(num, idx + 1);
+  }
+
+  uint64_t get_edge_property_num(uint64_t elabel) const {
+    auto iter = edge_property_num_.find(elabel);
+    return iter == edge_property_num_.end() ? 0 : iter->second;
   }
 
   int get_edge_property_dtypes(uint64_t elabel, uint64_t idx) {
@@ -302,6 +368,18 @@ class GraphStore {
   }
 
  private:
+  VTable& reserve_vtable_slot_(uint64_t vlabel) {
+    VTable& vtable = vertex_tables_[vlabel];
+    if (vtable.max_inner_location == vtable.min_outer_location) {
+      grow_vertex_table_(vlabel, vtable.size * 2);
+    }
+    return vtable;
+  }
+
+  // move to larger blobs, published with the next epoch
+  void grow_vertex_table_(uint64_t vlabel, uint64_t size);
+  void grow_ovl2g_(uint64_t vlabel, uint64_t size);
+
   static const int MAX_TABLES = 30;
   static const int MAX_COLS = 10;
   static const int MAX_VPROPS = 10;
@@ -330,6 +408,10 @@ class GraphStore {
   std::map<uint64_t, uint64_t> edge_property_bytes_;
   std::map<std::pair<uint64_t, uint64_t>, uint64_t> edge_property_prefix_bytes_;
   std::map<std::pair<uint64_t, uint64_t>, uint64_t> edge_property_dtypes_;
+  std::map<uint64_t, uint64_t> edge_property_num_;
+
+  // label -> compiled property layout, indexed without lookups on ingest
+  std::vector<PropRowDecoder> prop_decoders_;
 
   std::map<std::string, uint64_t> vertex_table_maps_;
   std::map<std::string, uint64_t> edge_table_maps_;
@@ -338,13 +420,19 @@ class GraphStore {
 
   std::unordered_map<uint64_t, VTable> vertex_tables_;
   std::unordered_map<uint64_t, uint64_t*> ovl2gs_;
+  std::unordered_map<uint64_t, uint64_t> ovl2g_sizes_;
+  // blobs replaced by larger ones, with the first epoch not reading them,
+  // or -1 until the epoch is published
+  std::vector<std::pair<vineyard::ObjectID, int64_t>> retired_blobs_;
 
   // vlabel -> vertex blob schemas
   std::map<uint64_t, gart::BlobSchema> blob_schemas_;
   std::map<uint64_t, std::map<uint64_t, gart::BlobSchema>>
       history_blob_schemas_;  // version --> map<vlabel, schema>
+  // history schemas are read by the epoch publisher
+  mutable std::mutex history_blob_mutex_;
 
-  uint64_t blob_epoch_;
+  uint64_t blob_epoch_ = 0;
 
   seggraph::SparseArrayAllocator<void> array_allocator;
 
@@ -27,8 +27,11 @@
 #ifndef VEGITO_SRC_PROPERTY_PROPERTY_H_
 #define VEGITO_SRC_PROPERTY_PROPERTY_H_
 
+#include "glog/logging.h"
+
 #include "fragment/shared_storage.h"
 #include "seggraph/core/allocator.hpp"
+#include "util/checkpoint_io.h"
 #include "util/util.h"
 
 enum PropertyStoreType { /* PROP_KV, PROP_ROW, */
@@ -82,6 +85,12 @@ class Property {  // NOLINT(build/class)
     assert(false);
   }
 
+  // write the columns `cids` of a row, `v` holds a whole row
+  virtual void update(uint64_t off, const std::vector<int>& cids, char* v,
+                      uint64_t seq, uint64_t ver) {
+    assert(false);
+  }
+
   uint64_t copy(const Property* store) {
     uint64_t max_ver = uint64_t(-1);
     auto row_cursor = store->getRowCursor(max_ver);
@@ -106,7 +115,7 @@ class Property {  // NOLINT(build/class)
 
   uint64_t getNewOffset() {
     uint64_t ret = gart::util::FAA(&header_, 1);
-    assert(ret < max_items_);
+    check_offset_(ret);
     return ret;
   }
 
@@ -131,6 +140,19 @@ class Property {  // NOLINT(build/class)
   // clean the pages whose version < `version`
   virtual void gc(uint64_t version) {}
 
+  // number of pages allocated for new versions of values
+  virtual uint64_t getNumPageAllocs() const { return 0; }
+
+  // save and restore all versions of values, must not run with writers
+  virtual void checkpoint(gart::util::CheckpointWriter& writer) const {
+    assert(false);
+  }
+
+  virtual bool restore(gart::util::CheckpointReader& reader) {
+    assert(false);
+    return false;
+  }
+
   const std::vector<gart::VPropMeta>& get_blob_metas() const {
     return blob_metas_;
   }
@@ -182,6 +204,15 @@ class Property {  // NOLINT(build/class)
   explicit Property(uint64_t max_items)
       : max_items_(max_items), header_(0), stable_header_(0) {}
 
+  // the columns do not grow, so writing past them would corrupt memory
+  void check_offset_(uint64_t off) const {
+    if (off >= max_items_) {
+      LOG(ERROR) << "Row " << off << " exceeds the capacity of the property "
+                 << "store (" << max_items_ << " rows).";
+      exit(1);
+    }
+  }
+
   static inline void copy_val_(char* dst, const char* src, uint64_t sz) {
     switch (sz) {
     case 1:
@@ -63,7 +63,7 @@ void PropertyColArray::update(uint64_t off, const std::vector<int>& cids,
 
 void PropertyColArray::_put(uint64_t offset, uint64_t key, char* val,
                             int64_t seq, uint64_t version, bool insert) {
-  assert(offset < max_items_);
+  check_offset_(offset);
 
   int64_t& meta_seq = seq_[offset];
 
@@ -36,6 +36,8 @@ thread_local char* pool = nullptr;
 thread_local uint64_t cached_ver[20];           // table id
 thread_local uint32_t cached_page_num[20][30];  // table id, column id
 thread_local void* cached_page[20][30] = {{nullptr}};
+// table ids are only unique in one partition, a process may host several
+thread_local const void* cached_store[20] = {nullptr};
 }  // namespace
 
 // NOTE: page_sz is number of objects, instead of bytes
@@ -48,6 +50,7 @@ inline PropertyColPaged::Page* PropertyColPaged::getNewPage_(uint64_t page_sz,
 
   buf = reinterpret_cast<char*>(malloc(pg_sz));
   Page* ret = new (buf) Page(ver, prev);
+  ++num_page_allocs_;
 
   if (page_sz != 1 && prev != nullptr) {
     memcpy(ret->content, prev->content, page_sz * vlen);
@@ -72,6 +75,7 @@ inline PropertyColPaged::Page* PropertyColPaged::getNewPage_(
   flex_buf.allocated_sz += pg_sz;
   assert(flex_buf.allocated_sz <= flex_buf.total_sz);
   Page* ret = new (buf) Page(ver, prev);
+  ++num_page_allocs_;
 
   if (prev != nullptr) {
     ret->prev_ptr =
@@ -294,7 +298,7 @@ inline PropertyColPaged::Page* PropertyColPaged::findPage(int colID,
 
 void PropertyColPaged::insert(uint64_t off, uint64_t k, char* v, uint64_t seq,
                               uint64_t ver) {
-  assert(off < max_items_);
+  check_offset_(off);
 
   // assert(k != 0);  // for LDBC
 
@@ -325,7 +329,7 @@ void PropertyColPaged::update(uint64_t off, const std::vector<int>& cids,
                               char* v, uint64_t seq, uint64_t ver) {
   if (val_len_ == 0)
     return;
-  assert(off < max_items_);
+  check_offset_(off);
 
   // int64_t &meta_seq = seq_[off];
   // assert(meta_seq != -1 && meta_seq != seq);
@@ -359,7 +363,7 @@ void PropertyColPaged::update(uint64_t off, const std::vector<int>& cids,
 void PropertyColPaged::update(uint64_t off, int cid, char* v, uint64_t ver) {
   if (val_len_ == 0)
     return;
-  assert(off < max_items_);
+  check_offset_(off);
 
   const Property::Column& col = cols_[cid];
 
@@ -421,6 +425,85 @@ void PropertyColPaged::gc(uint64_t ver) {
 #endif
 }
 
+void PropertyColPaged::checkpoint(gart::util::CheckpointWriter& writer) const {
+  uint64_t header = header_, stable_header = stable_header_;
+  writer.Write(header);
+  writer.Write(stable_header);
+  writer.Write(cols_.size());
+  for (int i = 0; i < cols_.size(); i++) {
+    assert(cols_[i].updatable);
+    const FlexBuf& flex_buf = flex_bufs_[i];
+    const FlexCol& flex = flexCols_[i];
+    // the header and all pages, pages are saved as offsets in the buffer
+    writer.Write(flex_buf.allocated_sz);
+    writer.WriteBytes(flex_buf.buf, flex_buf.allocated_sz);
+    writer.Write(reinterpret_cast<uintptr_t>(flex_buf.buf));
+    writer.Write(flex.pages.size());
+    for (int p = 0; p < flex.pages.size(); ++p) {
+      Page* old_page = flex.old_pages[p];
+      writer.Write<int64_t>(reinterpret_cast<char*>(flex.pages[p]) -
+                            flex_buf.buf);
+      writer.Write<int64_t>(
+          old_page ? reinterpret_cast<char*>(old_page) - flex_buf.buf : -1);
+    }
+  }
+}
+
+bool PropertyColPaged::restore(gart::util::CheckpointReader& reader) {
+  header_ = reader.Read<uint64_t>();
+  stable_header_ = reader.Read<uint64_t>();
+  if (reader.Read<size_t>() != cols_.size()) {
+    return false;
+  }
+  for (int i = 0; i < cols_.size(); i++) {
+    FlexBuf& flex_buf = flex_bufs_[i];
+    FlexCol& flex = flexCols_[i];
+    size_t allocated_sz = reader.Read<size_t>();
+    if (!reader.ok() || allocated_sz > flex_buf.total_sz) {
+      return false;
+    }
+    reader.ReadBytes(flex_buf.buf, allocated_sz);
+    flex_buf.allocated_sz = allocated_sz;
+
+    // pages link to each other by absolute pointers of the saved buffer
+    uintptr_t saved_buf = reader.Read<uintptr_t>();
+    auto rebase = [&](Page* page) {
+      if (page == nullptr) {
+        return page;
+      }
+      uintptr_t off = reinterpret_cast<uintptr_t>(page) - saved_buf;
+      return reinterpret_cast<Page*>(flex_buf.buf + off);
+    };
+
+    if (reader.Read<size_t>() != flex.pages.size()) {
+      return false;
+    }
+    for (int p = 0; p < flex.pages.size(); ++p) {
+      int64_t page_off = reader.Read<int64_t>();
+      int64_t old_page_off = reader.Read<int64_t>();
+      if (page_off < 0 || page_off >= allocated_sz ||
+          old_page_off >= static_cast<int64_t>(allocated_sz)) {
+        return false;
+      }
+      flex.pages[p] = reinterpret_cast<Page*>(flex_buf.buf + page_off);
+      flex.old_pages[p] =
+          old_page_off < 0
+              ? nullptr
+              : reinterpret_cast<Page*>(flex_buf.buf + old_page_off);
+      flex.locks[p] = 0;
+      // an uninitialized (lazily allocated) page has no versions to link
+      if (flex.old_pages[p] == nullptr) {
+        continue;
+      }
+      for (Page* page = flex.pages[p]; page != nullptr; page = page->prev) {
+        page->prev = rebase(page->prev);
+        page->next = rebase(page->next);
+      }
+    }
+  }
+  return reader.ok();
+}
+
 char* PropertyColPaged::getByOffset(uint64_t offset, int col_id,
                                     uint64_t version, uint64_t* walk_cnt) {
   char* val = nullptr;
@@ -433,10 +516,17 @@ char* PropertyColPaged::getByOffset(uint64_t offset, int col_id,
     uint64_t pg_num = offset / col.page_size;
 #if 1
     if (cached_page[table_id_][col_id] != nullptr &&
-        cached_ver[table_id_] == version &&
+        cached_store[table_id_] == this && cached_ver[table_id_] == version &&
         cached_page_num[table_id_][col_id] == pg_num) {
       page = reinterpret_cast<Page*>(cached_page[table_id_][col_id]);
     } else {
+      if (cached_store[table_id_] != this) {
+        // drop pages of the same table cached from another partition
+        for (auto& cached : cached_page[table_id_]) {
+          cached = nullptr;
+        }
+        cached_store[table_id_] = this;
+      }
       cached_ver[table_id_] = version;
       page = findPage(col_id, pg_num, version, walk_cnt);
       cached_page[table_id_][col_id] = page;
@@ -61,6 +61,12 @@ class PropertyColPaged : public Property {
 
   virtual void gc(uint64_t version);
 
+  virtual void checkpoint(gart::util::CheckpointWriter& writer) const;
+
+  virtual bool restore(gart::util::CheckpointReader& reader);
+
+  virtual uint64_t getNumPageAllocs() const { return num_page_allocs_; }
+
   const std::vector<uint64_t>& getKeyCol() const;
 
   virtual char* col(int col_id, uint64_t* len = nullptr) const {
@@ -154,6 +160,7 @@ class PropertyColPaged : public Property {
 
   std::vector<FlexBuf> flex_bufs_;
   std::vector<vineyard::ObjectID> col_ids_;
+  uint64_t num_page_allocs_ = 0;
 
   Page* findPage(int col_id, uint64_t page_num, uint64_t version,
                  uint64_t* walk_cnt = nullptr);
@@ -0,0 +1,106 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace seggraph {
+
+/**
+ * Blocks of a BlockManager live in a chain of blobs, called extents. A
+ * pointer to a block keeps the extent id in its high 16 bits and the offset
+ * in the extent in the low 48 bits, so pointers into extent 0 are plain
+ * offsets and 0 is still the null pointer. A block never spans two extents.
+ *
+ * Writers and readers of a SegGraph both map its extents here: the writer
+ * as it adds them, readers from the extent table published in BlobSchema.
+ */
+class BlockExtents {
+ public:
+  constexpr static int EXTENT_SHIFT = 48;
+  constexpr static uintptr_t OFFSET_MASK = (1ul << EXTENT_SHIFT) - 1;
+  constexpr static size_t MAX_EXTENTS = 1ul << 12;
+
+  BlockExtents() : num_extents(0) {
+    for (size_t i = 0; i < MAX_EXTENTS; i++) {
+      bases[i].store(nullptr, std::memory_order_relaxed);
+      capacities[i] = 0;
+    }
+  }
+
+  BlockExtents(const BlockExtents&) = delete;
+
+  BlockExtents& operator=(const BlockExtents&) = delete;
+
+  static uintptr_t make_pointer(size_t extent, uintptr_t offset) {
+    return (static_cast<uintptr_t>(extent) << EXTENT_SHIFT) | offset;
+  }
+
+  static size_t get_extent(uintptr_t pointer) {
+    return pointer >> EXTENT_SHIFT;
+  }
+
+  static uintptr_t get_offset(uintptr_t pointer) {
+    return pointer & OFFSET_MASK;
+  }
+
+  // extents are only appended, a pointer into one is never handed out
+  // before its base is set
+  void set_base(size_t extent, char* base, size_t capacity) {
+    capacities[extent] = capacity;
+    bases[extent].store(base, std::memory_order_release);
+    if (extent >= num_extents.load(std::memory_order_relaxed))
+      num_extents.store(extent + 1, std::memory_order_release);
+  }
+
+  char* get_base(size_t extent) const {
+    return bases[extent].load(std::memory_order_acquire);
+  }
+
+  size_t get_capacity(size_t extent) const { return capacities[extent]; }
+
+  size_t size() const { return num_extents.load(std::memory_order_acquire); }
+
+  template <typename T>
+  inline T* convert(uintptr_t pointer) const {
+    if (__builtin_expect((pointer == 0), 0))
+      return nullptr;
+    return reinterpret_cast<T*>(
+        bases[get_extent(pointer)].load(std::memory_order_acquire) +
+        get_offset(pointer));
+  }
+
+  // the pointer of an address in one of the extents
+  uintptr_t revert(const void* ptr) const {
+    auto addr = reinterpret_cast<const char*>(ptr);
+    size_t n = size();
+    for (size_t i = 0; i < n; i++) {
+      const char* base = get_base(i);
+      if (base && addr >= base && addr < base + capacities[i])
+        return make_pointer(i, addr - base);
+    }
+    return 0;
+  }
+
+ private:
+  std::atomic<char*> bases[MAX_EXTENTS];
+  size_t capacities[MAX_EXTENTS];
+  std::atomic<size_t> num_extents;
+};
+
+}  // namespace seggraph
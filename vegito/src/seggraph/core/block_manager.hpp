@@ -26,12 +26,17 @@
 
 #include <sys/mman.h>
 
+#include <algorithm>
+#include <cstring>
+
 #include "tbb/enumerable_thread_specific.h"
 #include "vineyard/client/client.h"
 #include "vineyard/client/ds/blob.h"
 
 #include "framework/config.h"  // NOLINT(build/include_subdir)
+#include "seggraph/core/block_extents.hpp"
 #include "seggraph/core/types.hpp"
+#include "util/checkpoint_io.h"
 
 namespace seggraph {
 class BlockManager {
@@ -40,42 +45,41 @@ class BlockManager {
 
   static uint64_t allocated_mem_size;
 
-  explicit BlockManager(size_t _capacity)
-      : capacity(_capacity),
+  // blocks are taken from extents of `_extent_size` bytes, a new one is
+  // added when the last is full
+  explicit BlockManager(size_t _extent_size)
+      : extent_size(_extent_size),
         mutex(),
         free_blocks(std::vector<std::vector<uintptr_t>>(
             LARGE_BLOCK_THRESHOLD, std::vector<uintptr_t>())),
         large_free_blocks(MAX_ORDER, std::vector<uintptr_t>()) {
     {
       using BlobWriter = vineyard::BlobWriter;
-      using Blob = vineyard::Blob;
-
-      fd = EMPTY_FD;
 
       std::string ipc_socket = gart::framework::config.getIPCScoket();
 
       VINEYARD_CHECK_OK(client.Connect(ipc_socket));
       std::unique_ptr<BlobWriter> blob_writer;
-      std::shared_ptr<Blob> blob;
-      VINEYARD_CHECK_OK(client.CreateBlob(capacity, blob_writer));
-      VINEYARD_CHECK_OK(client.GetBlob(blob_writer->id(), true, blob));
-      data = reinterpret_cast<void*>(blob_writer->data());
-
-      oid = blob_writer->id();
+      VINEYARD_CHECK_OK(client.CreateBlob(
+          BlockExtents::MAX_EXTENTS * sizeof(vineyard::ObjectID), blob_writer));
+      extent_oids = reinterpret_cast<vineyard::ObjectID*>(blob_writer->data());
+      memset(extent_oids, 0,
+             BlockExtents::MAX_EXTENTS * sizeof(vineyard::ObjectID));
+      extent_table_oid = blob_writer->id();
     }
 
-    file_size = FILE_TRUNC_SIZE;
-    used_size = 0;
+    num_shared_small_blocks = 0;
+    add_extent(extent_size);
 
     null_holder = alloc(LARGE_BLOCK_THRESHOLD);
   }
 
   ~BlockManager() {
     free(null_holder, LARGE_BLOCK_THRESHOLD);
-    msync(data, capacity, MS_SYNC);
-    munmap(data, capacity);
-    if (fd != EMPTY_FD)
-      close(fd);
+    for (size_t i = 0; i < extents.size(); i++) {
+      msync(extents.get_base(i), extents.get_capacity(i), MS_SYNC);
+      munmap(extents.get_base(i), extents.get_capacity(i));
+    }
     client.Disconnect();
   }
 
@@ -92,7 +96,7 @@ class BlockManager {
   }
 
   size_t getUsedMemory() {
-    size_t ret = used_size;
+    size_t ret = get_used_bytes();
     for (int i = 0; i < LARGE_BLOCK_THRESHOLD; i++) {
       ret -= free_blocks.local()[i].size() * (1ul << i);
     }
@@ -102,10 +106,44 @@ class BlockManager {
     return ret;
   }
 
+  // bytes ever taken from the extents, including the freed blocks
+  size_t get_used_bytes() const {
+    uintptr_t next = next_pointer.load();
+    size_t last = BlockExtents::get_extent(next);
+    size_t ret = std::min<size_t>(BlockExtents::get_offset(next),
+                                  extents.get_capacity(last));
+    for (size_t i = 0; i < last; i++) {
+      ret += used_sizes[i];
+    }
+    return ret;
+  }
+
+  // bytes held by the free lists of all threads, must not run with writers
+  size_t get_free_bytes() {
+    size_t ret = 0;
+    for (auto& lists : free_blocks) {
+      for (order_t order = 0; order < LARGE_BLOCK_THRESHOLD; order++) {
+        ret += lists[order].size() * (1ul << order);
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (order_t order = 0; order < MAX_ORDER; order++) {
+      ret += large_free_blocks[order].size() * (1ul << order);
+    }
+    return ret;
+  }
+
   uintptr_t alloc(order_t order) {
     uintptr_t pointer = NULLPOINTER;
     if (order < LARGE_BLOCK_THRESHOLD) {
       pointer = pop(free_blocks.local(), order);
+      if (pointer == NULLPOINTER &&
+          num_shared_small_blocks.load(std::memory_order_relaxed) > 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pointer = pop(large_free_blocks, order);
+        if (pointer != NULLPOINTER)
+          num_shared_small_blocks--;
+      }
     } else {
       std::lock_guard<std::mutex> lock(mutex);
       pointer = pop(large_free_blocks, order);
@@ -113,19 +151,13 @@ class BlockManager {
 
     if (pointer == NULLPOINTER) {
       size_t block_size = 1ul << order;
-      pointer = used_size.fetch_add(block_size);
-
-      if (pointer + block_size >= file_size) {
-        auto new_file_size =
-            ((pointer + block_size) / FILE_TRUNC_SIZE + 1) * FILE_TRUNC_SIZE;
-        std::lock_guard<std::mutex> lock(mutex);
-        if (new_file_size >= file_size) {
-          if (fd != EMPTY_FD) {
-            if (ftruncate(fd, new_file_size) != 0)
-              throw std::runtime_error("ftruncate block file error.");
-          }
-          file_size = new_file_size;
-        }
+      while (true) {
+        pointer = next_pointer.fetch_add(block_size);
+        size_t extent = BlockExtents::get_extent(pointer);
+        size_t offset = BlockExtents::get_offset(pointer);
+        if (offset + block_size <= extents.get_capacity(extent))
+          break;
+        grow(extent, offset, block_size);
       }
     }
 
@@ -141,38 +173,156 @@ class BlockManager {
     }
   }
 
+  // free to the lists shared by all threads, for threads other than the
+  // writers, e.g., the compactor
+  void free_shared(uintptr_t block, order_t order) {
+    std::lock_guard<std::mutex> lock(mutex);
+    push(large_free_blocks, order, block);
+    if (order < LARGE_BLOCK_THRESHOLD)
+      num_shared_small_blocks++;
+  }
+
   template <typename T>
   inline T* convert(uintptr_t block) const {
-    if (__builtin_expect((block == NULLPOINTER), 0))
-      return nullptr;
-    return reinterpret_cast<T*>(reinterpret_cast<char*>(data) + block);
+    return extents.convert<T>(block);
   }
 
+  inline const BlockExtents& get_extents() const { return extents; }
+
   inline uintptr_t revert(uintptr_t block) const {
-    return block - (uintptr_t) data;
+    return extents.revert(reinterpret_cast<const void*>(block));
   }
 
-  inline uintptr_t revert(void* ptr) const {
-    return reinterpret_cast<char*>(ptr) - reinterpret_cast<char*>(data);
+  inline uintptr_t revert(const void* ptr) const {
+    return extents.revert(ptr);
   }
 
-  inline vineyard::ObjectID get_block_oid() const { return oid; }
+  // blocks are addressed by (extent, offset), so the used prefix of each
+  // extent is saved as is; free lists of all threads are merged
+  void checkpoint(gart::util::CheckpointWriter& writer) {
+    uintptr_t next = next_pointer.load();
+    size_t num_extents = BlockExtents::get_extent(next) + 1;
+    writer.Write(num_extents);
+    for (size_t i = 0; i < num_extents; i++) {
+      size_t capacity = extents.get_capacity(i);
+      size_t size = i + 1 < num_extents
+                        ? used_sizes[i]
+                        : std::min<size_t>(BlockExtents::get_offset(next),
+                                           capacity);
+      writer.Write(capacity);
+      writer.Write(size);
+      writer.WriteBytes(extents.get_base(i), size);
+    }
+
+    std::vector<std::vector<uintptr_t>> blocks(MAX_ORDER);
+    for (auto& local_blocks : free_blocks) {
+      for (order_t order = 0; order < LARGE_BLOCK_THRESHOLD; order++) {
+        blocks[order].insert(blocks[order].end(), local_blocks[order].begin(),
+                             local_blocks[order].end());
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (order_t order = 0; order < MAX_ORDER; order++) {
+        blocks[order].insert(blocks[order].end(),
+                             large_free_blocks[order].begin(),
+                             large_free_blocks[order].end());
+      }
+    }
+    for (const auto& order_blocks : blocks) {
+      writer.WriteVector(order_blocks);
+    }
+  }
+
+  // small free blocks go to the free list of the calling thread
+  bool restore(gart::util::CheckpointReader& reader) {
+    size_t num_extents = reader.Read<size_t>();
+    if (!reader.ok() || num_extents == 0 ||
+        num_extents > BlockExtents::MAX_EXTENTS) {
+      return false;
+    }
+    size_t size = 0;
+    for (size_t i = 0; i < num_extents; i++) {
+      size_t capacity = reader.Read<size_t>();
+      size = reader.Read<size_t>();
+      if (!reader.ok() || size > capacity) {
+        return false;
+      }
+      if (i == extents.size()) {
+        add_extent(capacity);
+      } else if (extents.get_capacity(i) < size) {
+        return false;
+      }
+      reader.ReadBytes(extents.get_base(i), size);
+      if (i + 1 < num_extents)
+        used_sizes[i] = size;
+    }
+    next_pointer = BlockExtents::make_pointer(num_extents - 1, size);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (order_t order = 0; order < MAX_ORDER; order++) {
+      if (order < LARGE_BLOCK_THRESHOLD) {
+        reader.ReadVector(free_blocks.local()[order]);
+      } else {
+        reader.ReadVector(large_free_blocks[order]);
+      }
+    }
+    return reader.ok();
+  }
+
+  // the blob of the first extent
+  inline vineyard::ObjectID get_block_oid() const { return extent_oids[0]; }
+
+  // a blob of BlockExtents::MAX_EXTENTS object ids, one per extent and 0 for
+  // the ones not added yet
+  inline vineyard::ObjectID get_extent_table_oid() const {
+    return extent_table_oid;
+  }
 
   inline vineyard::Client* get_client() { return &client; }
 
  private:
-  const size_t capacity;
-  int fd;
-  void* data;
+  const size_t extent_size;
+  BlockExtents extents;
+  vineyard::ObjectID* extent_oids;
+  vineyard::ObjectID extent_table_oid;
   vineyard::Client client;
-  vineyard::ObjectID oid;
   std::mutex mutex;
   tbb::enumerable_thread_specific<std::vector<std::vector<uintptr_t>>>
       free_blocks;
+  // large blocks, and small ones freed by free_shared()
   std::vector<std::vector<uintptr_t>> large_free_blocks;
-  std::atomic<size_t> used_size, file_size;
+  std::atomic<size_t> num_shared_small_blocks;
+  // (extent, offset) of the next block to take from the last extent
+  std::atomic<uintptr_t> next_pointer;
+  // bytes taken from each extent before the last
+  size_t used_sizes[BlockExtents::MAX_EXTENTS];
   uintptr_t null_holder;
 
+  // with the mutex held, or before any allocation
+  void add_extent(size_t capacity) {
+    size_t extent = extents.size();
+    if (extent == BlockExtents::MAX_EXTENTS)
+      throw std::runtime_error("Too many block extents.");
+
+    std::unique_ptr<vineyard::BlobWriter> blob_writer;
+    VINEYARD_CHECK_OK(client.CreateBlob(capacity, blob_writer));
+    extents.set_base(extent, reinterpret_cast<char*>(blob_writer->data()),
+                     capacity);
+    extent_oids[extent] = blob_writer->id();
+    used_sizes[extent] = capacity;
+    next_pointer = BlockExtents::make_pointer(extent, 0);
+  }
+
+  // a block of `block_size` at `offset` does not fit in `extent`, the first
+  // of such blocks decides the used bytes of it
+  void grow(size_t extent, size_t offset, size_t block_size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    used_sizes[extent] = std::min(used_sizes[extent], offset);
+    if (BlockExtents::get_extent(next_pointer.load()) == extent)
+      add_extent(std::max(extent_size, block_size));
+  }
+
   uintptr_t pop(std::vector<std::vector<uintptr_t>>& free_block,
                 order_t order) {
     uintptr_t pointer = NULLPOINTER;
@@ -188,10 +338,8 @@ class BlockManager {
     free_block[order].push_back(pointer);
   }
 
-  constexpr static int EMPTY_FD = -1;
   constexpr static order_t MAX_ORDER = 64;
   constexpr static order_t LARGE_BLOCK_THRESHOLD = 20;
-  constexpr static size_t FILE_TRUNC_SIZE = 1ul << 30;  // 1GB
 };
 
 class BlockManagerLibc {
@@ -24,8 +24,10 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 
+#include "seggraph/core/block_extents.hpp"
 #include "seggraph/core/bloom_filter.hpp"
 #include "seggraph/core/utils.hpp"
 
@@ -478,6 +480,67 @@ class EdgeBlockHeader : public N2OBlockHeader {
   char data[0];
 };
 
+/**
+ * Deleted edges of an edge block, by their index in the block, as of an
+ * epoch. The first delete of an epoch copies the newest version, so readers
+ * of older epochs keep seeing the edges; versions are chained newest first.
+ */
+class EdgeDeletionBitmap : public BlockHeader {
+ public:
+  timestamp_t get_epoch() const { return epoch; }
+
+  uintptr_t get_prev_pointer() const { return prev_pointer; }
+
+  size_t get_capacity() const {
+    return (get_block_size() - sizeof(*this)) / sizeof(uint64_t) * 64;
+  }
+
+  bool test(size_t idx) const {
+    return idx < get_capacity() && ((words[idx >> 6] >> (idx & 63)) & 1);
+  }
+
+  void set(size_t idx) { words[idx >> 6] |= (uint64_t) 1 << (idx & 63); }
+
+  void clear(size_t idx) { words[idx >> 6] &= ~((uint64_t) 1 << (idx & 63)); }
+
+  // number of deleted edges among the first `num_edges`
+  size_t count(size_t num_edges) const {
+    num_edges = std::min(num_edges, get_capacity());
+    size_t ret = 0;
+    for (size_t i = 0; i < num_edges / 64; i++)
+      ret += __builtin_popcountll(words[i]);
+    if (num_edges % 64)
+      ret += __builtin_popcountll(words[num_edges / 64] &
+                                  (((uint64_t) 1 << (num_edges % 64)) - 1));
+    return ret;
+  }
+
+  // a copy of `base` if any
+  void fill(order_t order, timestamp_t epoch, uintptr_t prev_pointer,
+            const EdgeDeletionBitmap* base) {
+    BlockHeader::fill(order, Type::SPECIAL);
+    this->epoch = epoch;
+    this->prev_pointer = prev_pointer;
+    size_t num_words = get_capacity() / 64;
+    size_t num_copied =
+        base ? std::min(num_words, base->get_capacity() / 64) : 0;
+    for (size_t i = 0; i < num_copied; i++)
+      words[i] = base->words[i];
+    for (size_t i = num_copied; i < num_words; i++)
+      words[i] = 0;
+  }
+
+  static order_t get_order_for(size_t num_edges) {
+    return size_to_order(sizeof(EdgeDeletionBitmap) +
+                         (num_edges + 63) / 64 * sizeof(uint64_t));
+  }
+
+ private:
+  timestamp_t epoch;
+  uintptr_t prev_pointer;
+  uint64_t words[0];
+};
+
 class VegitoEdgeBlockHeader : public BlockHeader {
  public:
   size_t get_num_entries() const { return this->num_entries; }
@@ -510,8 +573,9 @@ class VegitoEdgeBlockHeader : public BlockHeader {
     return (VegitoEdgeEntry*) ((uint8_t*) this + block_size);
   }
 
-  bool has_space() const {
-    if (sizeof(*this) + (num_entries + 1) * sizeof(VegitoEdgeEntry) >
+  bool has_space(size_t num_new_entries = 1) const {
+    if (sizeof(*this) +
+            (num_entries + num_new_entries) * sizeof(VegitoEdgeEntry) >
         get_vegito_block_size())
       return false;
     else
@@ -539,17 +603,38 @@ class VegitoEdgeBlockHeader : public BlockHeader {
     return get_entries() - num - 1;
   }
 
+  uintptr_t get_deletion_bitmap() const { return deletion_bitmap; }
+
+  void set_deletion_bitmap(uintptr_t deletion_bitmap) {
+    this->deletion_bitmap = deletion_bitmap;
+  }
+
+  // deletions visible at `epoch`, nullptr if none
+  const EdgeDeletionBitmap* get_deletion_bitmap(const BlockExtents& extents,
+                                                timestamp_t epoch) const {
+    uintptr_t pointer = deletion_bitmap;
+    while (pointer) {
+      auto bitmap = extents.convert<const EdgeDeletionBitmap>(pointer);
+      if (bitmap->get_epoch() <= epoch)
+        return bitmap;
+      pointer = bitmap->get_prev_pointer();
+    }
+    return nullptr;
+  }
+
   void fill(order_t order, uintptr_t prev_pointer, size_t prev_num_entries) {
     BlockHeader::fill(order, Type::EDGE);
     set_prev_pointer(prev_pointer);
     set_prev_num_entries(prev_num_entries);
     set_num_entries(0);
+    set_deletion_bitmap(0);
   }
 
  private:
   uint32_t num_entries;
   uint32_t prev_num_entries;
   uintptr_t prev_pointer;
+  uintptr_t deletion_bitmap;  // the newest EdgeDeletionBitmap, 0 if none
 };
 
 class EpochBlockHeader : public BlockHeader {
@@ -710,5 +795,6 @@ static_assert(sizeof(EdgeLabelEntry) == 24);
 static_assert(sizeof(EdgeLabelBlockHeader) == 32);
 static_assert(sizeof(EdgeEntry) == 24);
 static_assert(sizeof(EdgeBlockHeader) == 48);
-static_assert(sizeof(VegitoEdgeBlockHeader) == 24);
+static_assert(sizeof(EdgeDeletionBitmap) == 24);
+static_assert(sizeof(VegitoEdgeBlockHeader) == 32);
 }  // namespace seggraph
@@ -77,7 +77,9 @@ class EpochEdgeIterator : public EdgeIteratorBase {
         if (idx == 0) {
           entries = header->get_entries();
           entries_cursor = entries - num_entries;  // at the begining
-          return;                                  // nothing to do
+          deletions = header->get_deletion_bitmap(block_manager.get_extents(),
+                                                  read_epoch_id);
+          return;  // nothing to do
         } else {
           auto last_cursor = (epoch_cursor - 1);
           read_end_offset = last_cursor->get_offset();
@@ -90,6 +92,7 @@ class EpochEdgeIterator : public EdgeIteratorBase {
       header = nullptr;
       entries = nullptr;
       entries_cursor = nullptr;
+      deletions = nullptr;
     } else {
       while (header->get_prev_num_entries() >= read_end_offset) {
         header = block_manager.convert<VegitoEdgeBlockHeader>(
@@ -98,6 +101,8 @@ class EpochEdgeIterator : public EdgeIteratorBase {
       auto offset = read_end_offset - header->get_prev_num_entries();
       entries = header->get_entries();
       entries_cursor = entries - offset;
+      deletions = header->get_deletion_bitmap(block_manager.get_extents(),
+                                              read_epoch_id);
     }
   }
 
@@ -114,14 +119,23 @@ class EpochEdgeIterator : public EdgeIteratorBase {
 
     entries_cursor = entries - num_entries;  // at the begining
     edge_prop_offset = seg_header->get_allocated_edge_num((uintptr_t) header);
+    deletions = header->get_deletion_bitmap(block_manager.get_extents(),
+                                            read_epoch_id);
     return true;
   }
 
+  // skips the edges deleted as of read_epoch_id
   bool valid() {
-    if (unlikely(entries_cursor == entries))
-      return switch_block();
-    else
-      return true;
+    while (true) {
+      if (unlikely(entries_cursor == entries)) {
+        if (!switch_block())
+          return false;
+      } else if (!deletions || !deletions->test(entries - entries_cursor - 1)) {
+        return true;
+      } else {
+        entries_cursor++;
+      }
+    }
   }
 
   void next() { entries_cursor++; }
@@ -182,6 +196,7 @@ class EpochEdgeIterator : public EdgeIteratorBase {
   VegitoEdgeEntry* entries_cursor = nullptr;
   VegitoEdgeBlockHeader* header = nullptr;
   EpochBlockHeader* epoch_header = nullptr;
+  const EdgeDeletionBitmap* deletions = nullptr;
 
   const BlockManager& block_manager;
 
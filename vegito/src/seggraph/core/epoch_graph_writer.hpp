@@ -15,9 +15,21 @@
 
 #pragma once
 
+#include <functional>
+#include <string_view>
+#include <vector>
+
 #include "seggraph/core/segment_graph.hpp"
 
 namespace seggraph {
+struct EdgeUpdate {
+  vertex_t src;
+  label_t label;
+  dir_t dir;
+  vertex_t dst;
+  std::string_view edge_data;
+};
+
 class EpochGraphWriter {
  public:
   EpochGraphWriter(SegGraph& _graph, timestamp_t _write_epoch_id)
@@ -44,11 +56,37 @@ class EpochGraphWriter {
     put_edge(src, label, EOUT, dst, edge_data);
   }
   void put_edge(vertex_t src, label_t label, dir_t dir, vertex_t dst,
-                std::string_view edge_data = "");
+                std::string_view edge_data = "") {
+    EdgeUpdate edge{src, label, dir, dst, edge_data};
+    const EdgeUpdate* edges[] = {&edge};
+    append_edges(edges, 1);
+  }
+
+  // put a batch of edges, grouped by (segment, label, dir, src) so that the
+  // locks, edge block and epoch entry of a group are taken once; edges of
+  // the same src, label and dir keep their order
+  void put_edges(const EdgeUpdate* edges, size_t num_edges);
+
+  // delete the edges of `src` whose dst matches, newest first and at most
+  // `limit` of them; returns the number of edges deleted
+  size_t delete_edges(vertex_t src, label_t label, dir_t dir,
+                      const std::function<bool(vertex_t)>& match,
+                      size_t limit = SIZE_MAX);
+
+  // allocate a segment of (label, dir) holding an edge block of each vertex
+  // for degrees[i] edges, so that a bulk load fills them without copying;
+  // a no-op if the segment already exists
+  void reserve_segment(segid_t segid, label_t label, dir_t dir,
+                       const uint32_t degrees[VERTEX_PER_SEG],
+                       size_t edge_prop_size);
 
   // segment compact
   void merge_segments(label_t label, dir_t dir = EOUT);
 
+  // rewrite the segments of `segid` into ones of half the size or less, if
+  // their edges fit after dropping the deleted ones; returns the bytes saved
+  size_t compact_segments(segid_t segid);
+
   ~EpochGraphWriter() {}
 
   void lock_vertex(vertex_t vertex_id) {
@@ -71,11 +109,37 @@ class EpochGraphWriter {
       throw std::invalid_argument("The vertex id is invalid.");
   }
 
+  // append edges of the same src, label and dir, whose properties are of
+  // the same size
+  void append_edges(const EdgeUpdate* const* edges, size_t num_edges);
+
+  // returns the newest deletion bitmap of the block
+  EdgeDeletionBitmap* delete_edge(VegitoEdgeBlockHeader* edge_block,
+                                  size_t idx);
+
   void update_edge_label_block(vertex_t src, label_t label, dir_t dir,
                                uintptr_t edge_block_pointer);
 
+  // edges deleted before any reader are dropped; the edge block of `segidx`
+  // gets room for `num_new_edges` more edges
   void merge_segment(VegitoSegmentHeader* old_seg, VegitoSegmentHeader* new_seg,
                      vertex_t segidx, uintptr_t* pointer,
-                     VegitoEdgeBlockHeader** edge_block, size_t edge_prop_size);
+                     VegitoEdgeBlockHeader** edge_block, size_t edge_prop_size,
+                     size_t num_new_edges = 1);
+
+  // bytes of a segment holding the edges of `seg` after merge_segment
+  size_t get_merged_size(VegitoSegmentHeader* seg, size_t edge_prop_size,
+                         vertex_t segidx = -1, size_t num_new_edges = 0);
+
+  static order_t get_init_segment_order() {
+    order_t order = SegGraph::INIT_SEGMENT_ORDER;
+    while ((1ul << order) < sizeof(VegitoSegmentHeader) * 10)
+      order++;
+    return order;
+  }
+
+  // a copy of an epoch table with the offsets after dropping edges
+  uintptr_t merge_epoch_table(uintptr_t epoch_table_pointer,
+                              const std::vector<size_t>& dropped_offsets);
 };
 }  // namespace seggraph
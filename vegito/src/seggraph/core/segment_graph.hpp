@@ -32,6 +32,7 @@
 #include "seggraph/core/allocator.hpp"
 #include "seggraph/core/block_manager.hpp"
 #include "seggraph/core/futex.hpp"
+#include "seggraph/core/segmented_array.hpp"
 
 namespace seggraph {
 class SegEdgeIterator;
@@ -43,44 +44,36 @@ class EpochGraphReader;
 class SegGraph {
  public:
   SegGraph(gart::graph::RGMapping* rg_map,
-           size_t _max_block_size = 1 * (1ul << 30),
-           vertex_t _max_vertex_id = 1 * (1ul << 20))
+           size_t _block_extent_size = 1ul << 28,
+           vertex_t _init_vertex_capacity = VERTEX_PER_SEG)
       : epoch_id(0),
         transaction_id(0),
         vertex_id(0),
         read_epoch_table(NO_TRANSACTION),
+        min_reader_epoch(ROLLBACK_TOMBSTONE),
         recycled_vertex_ids(),
-        max_vertex_id(_max_vertex_id),
 
         // segment
         seg_id(0),
-        max_seg_id(_max_vertex_id / VERTEX_PER_SEG),
 
         array_allocator(false),
-        block_manager(_max_block_size),
+        block_manager(_block_extent_size),
+
+        vertex_futexes(array_allocator, VERTEX_CHUNK_SHIFT, false),
+        seg_mutexes(array_allocator, SEGMENT_CHUNK_SHIFT, false),
+        vertex_ptrs(array_allocator, VERTEX_CHUNK_SHIFT, false),
+        edge_label_ptrs(array_allocator, SEGMENT_CHUNK_SHIFT, true),
 
         rg_map(rg_map) {
     array_allocator.set_client(block_manager.get_client());
+    reserve_vertices(_init_vertex_capacity);
 
-    auto futex_allocater =
-        std::allocator_traits<decltype(array_allocator)>::rebind_alloc<Futex>(
-            array_allocator);
-    vertex_futexes = futex_allocater.allocate(max_vertex_id);
-
-    auto shared_mutex_allocater =
-        std::allocator_traits<decltype(array_allocator)>::rebind_alloc<
-            std::shared_timed_mutex*>(array_allocator);
-    seg_mutexes = shared_mutex_allocater.allocate(max_seg_id);
-
-    auto pointer_allocater = std::allocator_traits<decltype(
-        array_allocator)>::rebind_alloc<uintptr_t>(array_allocator);
-    vertex_ptrs = pointer_allocater.allocate(max_vertex_id);
-
-    edge_label_ptrs =
-        pointer_allocater.allocate_v6d(max_seg_id, edge_label_ptrs_oid);
-
-    gart::ArrayMeta meta(edge_label_ptrs_oid, max_seg_id);
+    gart::ChunkedArrayMeta meta(edge_label_ptrs.get_chunk_table_oid(),
+                                edge_label_ptrs.get_chunk_size(),
+                                SegmentedArray<uintptr_t>::MAX_CHUNKS);
     blob_schema.set_block_oid(block_manager.get_block_oid());
+    blob_schema.set_block_extents(gart::ArrayMeta(
+        block_manager.get_extent_table_oid(), BlockExtents::MAX_EXTENTS));
     blob_schema.set_elabel2segs(meta);
 
     // tricky method: avoid corner case in segment lock
@@ -93,28 +86,24 @@ class SegGraph {
 
   SegGraph(SegGraph&&) = delete;
 
-  ~SegGraph() noexcept {
-    auto futex_allocater =
-        std::allocator_traits<decltype(array_allocator)>::rebind_alloc<Futex>(
-            array_allocator);
-    futex_allocater.deallocate(vertex_futexes, max_vertex_id);
-
-    auto shared_mutex_allocater =
-        std::allocator_traits<decltype(array_allocator)>::rebind_alloc<
-            std::shared_timed_mutex*>(array_allocator);
-    shared_mutex_allocater.deallocate(seg_mutexes, max_seg_id);
-
-    auto pointer_allocater = std::allocator_traits<decltype(
-        array_allocator)>::rebind_alloc<uintptr_t>(array_allocator);
-
-    pointer_allocater.deallocate(vertex_ptrs, max_vertex_id);
-
-    pointer_allocater.deallocate_v6d(edge_label_ptrs_oid);
-  }
-
   vertex_t get_max_vertex_id() const { return vertex_id; }
 
-  vertex_t get_vertex_capacity() const { return max_vertex_id; }
+  vertex_t get_vertex_capacity() const { return vertex_ptrs.capacity(); }
+
+  // make room for the first `num_vertices` vertices and their segments,
+  // arrays grow by chunks and are never moved
+  void reserve_vertices(vertex_t num_vertices) {
+    // segment ids start from 1, see new_vertex
+    segid_t num_segs = (num_vertices + VERTEX_PER_SEG - 1) / VERTEX_PER_SEG + 1;
+    if (num_vertices <= vertex_ptrs.capacity() &&
+        num_segs <= edge_label_ptrs.capacity())
+      return;
+    std::lock_guard<std::mutex> lock(reserve_mutex);
+    vertex_futexes.reserve(num_vertices);
+    vertex_ptrs.reserve(num_vertices);
+    seg_mutexes.reserve(num_segs);
+    edge_label_ptrs.reserve(num_segs);
+  }
 
   uint64_t get_deleted_inner_num() const { return deleted_inner; }
 
@@ -144,7 +133,25 @@ class SegGraph {
 
   BlockManager& get_block_manager() { return block_manager; }
 
-  void recycle_segments(timestamp_t epoch_id);
+  // free the blocks retired before any reader of `epoch_id`, see
+  // get_min_read_epoch; returns the bytes freed
+  size_t recycle_segments(timestamp_t epoch_id);
+
+  // the oldest epoch pinned by readers, ROLLBACK_TOMBSTONE if none
+  void set_min_reader_epoch(timestamp_t epoch) {
+    min_reader_epoch.store(epoch, std::memory_order_relaxed);
+  }
+
+  // the oldest epoch readers may read while `write_epoch` is written:
+  // readers without a pin lag at most LAG_EPOCH_NUMBER epochs behind
+  timestamp_t get_min_read_epoch(timestamp_t write_epoch) const {
+    return std::min(write_epoch - static_cast<timestamp_t>(LAG_EPOCH_NUMBER),
+                    min_reader_epoch.load(std::memory_order_relaxed));
+  }
+
+  // save and restore the topology, must not run with writers
+  void checkpoint(gart::util::CheckpointWriter& writer);
+  bool restore(gart::util::CheckpointReader& reader);
 
   SegTransaction begin_transaction();
   SegTransaction begin_read_only_transaction();
@@ -196,28 +203,26 @@ class SegGraph {
   std::atomic<segid_t> seg_id;
 
   tbb::enumerable_thread_specific<timestamp_t> read_epoch_table;
-  tbb::enumerable_thread_specific<
-      std::vector<std::tuple<uintptr_t, order_t, timestamp_t>>>
+  std::atomic<timestamp_t> min_reader_epoch;
+  // blocks no longer linked, with the epoch they are retired in
+  tbb::concurrent_queue<std::tuple<uintptr_t, order_t, timestamp_t>>
       segments_to_recycle;
   tbb::concurrent_queue<vertex_t> recycled_vertex_ids;
 
-  const vertex_t max_vertex_id;
-  const segid_t max_seg_id;
-
   // memory allocator
   SparseArrayAllocator<void> array_allocator;  // meta data
   BlockManager block_manager;                  // topology data
 
-  Futex* vertex_futexes;
-  std::shared_timed_mutex** seg_mutexes;
-  uintptr_t* vertex_ptrs;
-  uintptr_t* edge_label_ptrs;
+  SegmentedArray<Futex> vertex_futexes;
+  SegmentedArray<std::shared_timed_mutex*> seg_mutexes;
+  SegmentedArray<uintptr_t> vertex_ptrs;
+  SegmentedArray<uintptr_t> edge_label_ptrs;  // published to readers
+  std::mutex reserve_mutex;
 
   vertex_t* vertex_table;
   vertex_t* ovl2g;
   // TODO: vineyard::Hashmap<vid_t, vid_t> ovg2l_map;
 
-  vineyard::ObjectID edge_label_ptrs_oid;
   vineyard::ObjectID ovl2g_oid;
   vineyard::ObjectID ovg2l_map;
 
@@ -244,6 +249,9 @@ class SegGraph {
 
   constexpr static order_t INIT_SEGMENT_ORDER = 20;
 
+  constexpr static int VERTEX_CHUNK_SHIFT = 16;
+  constexpr static int SEGMENT_CHUNK_SHIFT = 10;
+
   friend class SegEdgeIterator;
   friend class EpochEdgeIterator;
   friend class SegTransaction;
@@ -0,0 +1,135 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#include "seggraph/core/allocator.hpp"
+
+namespace seggraph {
+
+/**
+ * An array of per-vertex or per-segment meta data, made of chunks of
+ * 2^chunk_shift elements that are added as it grows. Chunks never move, so
+ * elements are read and written without locks while the array grows; calls
+ * of reserve() must be serialized by the caller.
+ *
+ * Chunks of a shared array are vineyard blobs, listed in a table blob of
+ * MAX_CHUNKS object ids (0 for chunks not added yet) for readers in other
+ * processes. Others are sparse anonymous mappings.
+ */
+template <typename T>
+class SegmentedArray {
+ public:
+  constexpr static size_t MAX_CHUNKS = 1ul << 12;
+
+  SegmentedArray(SparseArrayAllocator<void>& allocator, int chunk_shift,
+                 bool shared)
+      : allocator(allocator),
+        chunk_shift(chunk_shift),
+        chunk_mask((1ul << chunk_shift) - 1),
+        shared(shared),
+        num_chunks(0),
+        chunk_oids(nullptr),
+        chunk_table_oid(0) {
+    for (size_t i = 0; i < MAX_CHUNKS; i++) {
+      chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  SegmentedArray(const SegmentedArray&) = delete;
+
+  SegmentedArray& operator=(const SegmentedArray&) = delete;
+
+  ~SegmentedArray() {
+    auto chunk_allocator =
+        std::allocator_traits<SparseArrayAllocator<void>>::rebind_alloc<T>(
+            allocator);
+    size_t n = num_chunks.load();
+    for (size_t i = 0; i < n; i++) {
+      if (shared) {
+        chunk_allocator.deallocate_v6d(chunk_oids[i]);
+      } else {
+        chunk_allocator.deallocate(chunks[i].load(), get_chunk_size());
+      }
+    }
+    if (chunk_oids) {
+      chunk_allocator.deallocate_v6d(chunk_table_oid);
+    }
+  }
+
+  inline T& operator[](size_t idx) const {
+    return chunks[idx >> chunk_shift].load(
+        std::memory_order_acquire)[idx & chunk_mask];
+  }
+
+  size_t get_chunk_size() const { return 1ul << chunk_shift; }
+
+  size_t capacity() const {
+    return num_chunks.load(std::memory_order_acquire) << chunk_shift;
+  }
+
+  // add chunks until `n` elements fit; new elements are zeros
+  void reserve(size_t n) {
+    if (n <= capacity())
+      return;
+    if (n > (MAX_CHUNKS << chunk_shift))
+      throw std::runtime_error("Segmented array is full.");
+
+    auto chunk_allocator =
+        std::allocator_traits<SparseArrayAllocator<void>>::rebind_alloc<T>(
+            allocator);
+    if (shared && !chunk_oids) {
+      auto table_allocator = std::allocator_traits<SparseArrayAllocator<
+          void>>::rebind_alloc<vineyard::ObjectID>(allocator);
+      chunk_oids = table_allocator.allocate_v6d(MAX_CHUNKS, chunk_table_oid);
+      memset(chunk_oids, 0, MAX_CHUNKS * sizeof(vineyard::ObjectID));
+    }
+
+    size_t n_chunks = num_chunks.load();
+    while ((n_chunks << chunk_shift) < n) {
+      T* chunk;
+      if (shared) {
+        chunk = chunk_allocator.allocate_v6d(get_chunk_size(),
+                                             chunk_oids[n_chunks]);
+        memset(chunk, 0, get_chunk_size() * sizeof(T));
+      } else {
+        chunk = chunk_allocator.allocate(get_chunk_size());
+      }
+      chunks[n_chunks].store(chunk, std::memory_order_release);
+      num_chunks.store(++n_chunks, std::memory_order_release);
+    }
+  }
+
+  // blob of the object ids of chunks, only for shared arrays
+  vineyard::ObjectID get_chunk_table_oid() const { return chunk_table_oid; }
+
+ private:
+  SparseArrayAllocator<void>& allocator;
+  const int chunk_shift;
+  const size_t chunk_mask;
+  const bool shared;
+
+  std::atomic<T*> chunks[MAX_CHUNKS];
+  std::atomic<size_t> num_chunks;
+
+  vineyard::ObjectID* chunk_oids;
+  vineyard::ObjectID chunk_table_oid;
+};
+
+}  // namespace seggraph
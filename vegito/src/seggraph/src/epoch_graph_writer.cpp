@@ -15,12 +15,18 @@
 
 #include "seggraph/core/epoch_graph_writer.hpp"
 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 using vertex_t = seggraph::vertex_t;
 using EpochGraphWriter = seggraph::EpochGraphWriter;
 using VegitoSegmentHeader = seggraph::VegitoSegmentHeader;
+using EdgeDeletionBitmap = seggraph::EdgeDeletionBitmap;
 
 vertex_t EpochGraphWriter::new_vertex(bool use_recycled_vertex) {
   vertex_t vertex_id = graph.vertex_id.fetch_add(1, std::memory_order_relaxed);
+  graph.reserve_vertices(vertex_id + 1);
   graph.vertex_futexes[vertex_id].clear();
   graph.vertex_ptrs[vertex_id] = graph.block_manager.NULLPOINTER;
 
@@ -120,8 +126,47 @@ void EpochGraphWriter::update_edge_label_block(segid_t segid, label_t label,
   }
 }
 
-void EpochGraphWriter::put_edge(vertex_t src, label_t label, dir_t dir,
-                                vertex_t dst, std::string_view edge_data) {
+void EpochGraphWriter::put_edges(const EdgeUpdate* edges, size_t num_edges) {
+  // number the groups by (src, label, dir) in the order they first appear,
+  // then lay out the edges group by group, each in its order in the batch
+  std::unordered_map<uint64_t, size_t> group_ids;
+  std::vector<size_t> edge_groups(num_edges);
+  std::vector<size_t> group_offsets;
+  group_ids.reserve(num_edges);
+  for (size_t i = 0; i < num_edges; i++) {
+    check_vertex_id(edges[i].src);
+    uint64_t key = (edges[i].src << (sizeof(label_t) * 8 + 2)) |
+                   (static_cast<uint64_t>(edges[i].label) << 2) |
+                   edges[i].dir;
+    auto iter = group_ids.emplace(key, group_offsets.size()).first;
+    if (iter->second == group_offsets.size())
+      group_offsets.push_back(0);
+    edge_groups[i] = iter->second;
+    group_offsets[iter->second]++;
+  }
+  size_t offset = 0;
+  for (auto& group_offset : group_offsets) {
+    size_t group_size = group_offset;
+    group_offset = offset;
+    offset += group_size;
+  }
+  std::vector<const EdgeUpdate*> grouped(num_edges);
+  for (size_t i = 0; i < num_edges; i++)
+    grouped[group_offsets[edge_groups[i]]++] = edges + i;
+
+  // group_offsets now point to the end of each group
+  size_t begin = 0;
+  for (size_t end : group_offsets) {
+    append_edges(grouped.data() + begin, end - begin);
+    begin = end;
+  }
+}
+
+void EpochGraphWriter::append_edges(const EdgeUpdate* const* edges,
+                                    size_t num_edges) {
+  vertex_t src = edges[0]->src;
+  label_t label = edges[0]->label;
+  dir_t dir = edges[0]->dir;
   check_vertex_id(src);
   // we don't need to check dst id
   // check_vertex_id(dst);
@@ -129,8 +174,7 @@ void EpochGraphWriter::put_edge(vertex_t src, label_t label, dir_t dir,
   segid_t segid = graph.get_vertex_seg_id(src);
   uint32_t segidx = graph.get_vertex_seg_idx(src);
 
-  auto edge_prop_value = edge_data.data();
-  size_t edge_prop_size = edge_data.size();
+  size_t edge_prop_size = edges[0]->edge_data.size();
 
   VegitoSegmentHeader *segment, *test_segment;
 
@@ -154,9 +198,7 @@ start:
     // the first writer to change segment location
     if (segment == test_segment) {
       // allocate a new segment
-      auto order = SegGraph::INIT_SEGMENT_ORDER;
-      while ((1 << order) < sizeof(VegitoSegmentHeader) * 10)
-        order++;
+      auto order = get_init_segment_order();
 
       auto new_seg_pointer = graph.block_manager.alloc(order);
       auto new_segment =
@@ -180,11 +222,7 @@ start:
   VegitoEdgeBlockHeader* edge_block =
       graph.block_manager.convert<VegitoEdgeBlockHeader>(edge_block_pointer);
 
-  VegitoEdgeEntry entry;
-  entry.set_dst(dst);
-
-  if (!edge_block || !edge_block->has_space()) {
-    size_t size;
+  if (!edge_block || !edge_block->has_space(num_edges)) {
     order_t order;
 
     // calculate the size for new edge block
@@ -194,6 +232,12 @@ start:
       // default init value
       order = DEFAULT_INIT_ORDER;
     }
+    // a copied block also holds the old edges
+    size_t num_copied = edge_block ? edge_block->get_num_entries() : 0;
+    while ((1ul << order) <
+           (order >= SegGraph::COPY_THRESHOLD_ORDER ? 0 : num_copied) +
+               num_edges)
+      order++;
 
     auto new_edge_block_pointer = segment->alloc(order, edge_prop_size);
 
@@ -208,6 +252,11 @@ start:
       if (test_segment == segment) {
         // allocate a new segment
         order_t new_order = segment->get_order() + 1;
+        if (num_edges > 1) {
+          new_order = std::max(
+              new_order, size_to_order(get_merged_size(
+                             segment, edge_prop_size, segidx, num_edges)));
+        }
         auto new_seg_pointer = graph.block_manager.alloc(new_order);
         auto new_segment =
             graph.block_manager.convert<VegitoSegmentHeader>(new_seg_pointer);
@@ -215,9 +264,9 @@ start:
 
         // copy&merge data of old segment into new segment
         merge_segment(segment, new_segment, segidx, &edge_block_pointer,
-                      &edge_block, edge_prop_size);
+                      &edge_block, edge_prop_size, num_edges);
 
-        graph.segments_to_recycle.local().push_back(
+        graph.segments_to_recycle.push(
             std::make_tuple(graph.block_manager.revert((uintptr_t) segment),
                             segment->get_order(), write_epoch_id));
         update_edge_label_block(segid, label, dir, new_seg_pointer);
@@ -243,6 +292,9 @@ start:
         new_edge_block->fill(order, 0, 0);
 
         if (edge_block) {
+          // edges keep their indexes, and so their deletions
+          new_edge_block->set_deletion_bitmap(
+              edge_block->get_deletion_bitmap());
           auto entries = edge_block->get_entries();
           auto num_entries = edge_block->get_num_entries();
           for (size_t i = 0; i < num_entries; i++) {
@@ -337,23 +389,147 @@ start:
       segment->get_allocated_edge_num((uintptr_t) edge_block) +
       edge_block->get_num_entries();
 
-  // insert edge
-  auto edge = edge_block->append(entry);
+  for (size_t i = 0; i < num_edges; i++) {
+    // insert edge property first, readers see the edge once it is appended
+    if (edge_prop_size > 0) {
+      segment->append_property(allocated_edge_num + i,
+                               edges[i]->edge_data.data(), edge_prop_size);
+    }
+
+    // insert edge
+    VegitoEdgeEntry entry;
+    entry.set_dst(edges[i]->dst);
+    edge_block->append(entry);
+  }
+  graph.seg_mutexes[segid]->unlock_shared();
+  graph.vertex_futexes[src].unlock();
+}
+
+size_t EpochGraphWriter::delete_edges(
+    vertex_t src, label_t label, dir_t dir,
+    const std::function<bool(vertex_t)>& match, size_t limit) {
+  check_vertex_id(src);
+
+  segid_t segid = graph.get_vertex_seg_id(src);
+  uint32_t segidx = graph.get_vertex_seg_idx(src);
+  size_t num_deleted = 0;
+
+  graph.vertex_futexes[src].lock();
+  graph.seg_mutexes[segid]->lock_shared();
 
-  // insert edge property
-  if (edge_prop_size > 0) {
-    segment->append_property(allocated_edge_num, edge_prop_value,
-                             edge_prop_size);
+  auto segment = locate_segment(segid, label, dir);
+  VegitoEdgeBlockHeader* edge_block = nullptr;
+  if (segment) {
+    edge_block = graph.block_manager.convert<VegitoEdgeBlockHeader>(
+        segment->get_region_ptr(segidx));
+  }
+  while (edge_block && num_deleted < limit) {
+    auto bitmap = graph.block_manager.convert<EdgeDeletionBitmap>(
+        edge_block->get_deletion_bitmap());
+    auto entries = edge_block->get_entries();
+    for (size_t idx = edge_block->get_num_entries();
+         idx-- > 0 && num_deleted < limit;) {
+      if ((bitmap && bitmap->test(idx)) ||
+          !match((entries - idx - 1)->get_dst()))
+        continue;
+      bitmap = delete_edge(edge_block, idx);
+      num_deleted++;
+    }
+    edge_block = graph.block_manager.convert<VegitoEdgeBlockHeader>(
+        edge_block->get_prev_pointer());
   }
+
   graph.seg_mutexes[segid]->unlock_shared();
   graph.vertex_futexes[src].unlock();
+  return num_deleted;
+}
+
+EdgeDeletionBitmap* EpochGraphWriter::delete_edge(
+    VegitoEdgeBlockHeader* edge_block, size_t idx) {
+  auto bitmap = graph.block_manager.convert<EdgeDeletionBitmap>(
+      edge_block->get_deletion_bitmap());
+  if (bitmap && bitmap->get_epoch() == write_epoch_id &&
+      idx < bitmap->get_capacity()) {
+    bitmap->set(idx);
+    return bitmap;
+  }
+
+  // a new version, readers of earlier epochs keep the previous one; a
+  // version of this epoch outgrown by a copied block is replaced, since no
+  // reader sees this epoch yet, but the block it was copied from may still
+  // point to it, so it is recycled rather than freed
+  bool replace = bitmap && bitmap->get_epoch() == write_epoch_id;
+  order_t order =
+      EdgeDeletionBitmap::get_order_for(edge_block->get_block_size());
+  auto pointer = graph.block_manager.alloc(order);
+  auto new_bitmap = graph.block_manager.convert<EdgeDeletionBitmap>(pointer);
+  new_bitmap->fill(order, write_epoch_id,
+                   replace ? bitmap->get_prev_pointer()
+                           : edge_block->get_deletion_bitmap(),
+                   bitmap);
+  new_bitmap->set(idx);
+  compiler_fence();
+  edge_block->set_deletion_bitmap(pointer);
+  if (replace) {
+    graph.segments_to_recycle.push(
+        std::make_tuple(graph.block_manager.revert(bitmap),
+                        bitmap->get_order(), write_epoch_id));
+  }
+  return new_bitmap;
+}
+
+void EpochGraphWriter::reserve_segment(segid_t segid, label_t label,
+                                       dir_t dir,
+                                       const uint32_t degrees[VERTEX_PER_SEG],
+                                       size_t edge_prop_size) {
+  size_t num_entries = 0;
+  for (int i = 0; i < VERTEX_PER_SEG; i++) {
+    if (degrees[i] > 0) {
+      num_entries += sizeof(VegitoEdgeBlockHeader) / sizeof(VegitoEdgeEntry) +
+                     (1ul << size_to_order(degrees[i]));
+    }
+  }
+  if (num_entries == 0) {
+    return;
+  }
+
+  graph.seg_mutexes[segid]->lock();
+  if (locate_segment(segid, label, dir)) {
+    graph.seg_mutexes[segid]->unlock();
+    return;
+  }
+  auto order = size_to_order(
+      sizeof(VegitoSegmentHeader) +
+      num_entries * (sizeof(VegitoEdgeEntry) + edge_prop_size));
+  auto seg_pointer = graph.block_manager.alloc(order);
+  auto segment = graph.block_manager.convert<VegitoSegmentHeader>(seg_pointer);
+  segment->fill(seg_pointer, order, segid);
+
+  for (int i = 0; i < VERTEX_PER_SEG; i++) {
+    if (degrees[i] == 0) {
+      continue;
+    }
+    order_t block_order = size_to_order(degrees[i]);
+    auto block_pointer = segment->alloc(block_order, edge_prop_size);
+    auto edge_block =
+        graph.block_manager.convert<VegitoEdgeBlockHeader>(block_pointer);
+    edge_block->fill(block_order, 0, 0);
+    segment->set_region_ptr(i, block_pointer);
+  }
+  update_edge_label_block(segid, label, dir, seg_pointer);
+  graph.seg_mutexes[segid]->unlock();
 }
 
 void EpochGraphWriter::merge_segment(VegitoSegmentHeader* old_seg,
                                      VegitoSegmentHeader* new_seg,
                                      vertex_t segidx, uintptr_t* pointer,
                                      VegitoEdgeBlockHeader** edge_block,
-                                     size_t edge_prop_size) {
+                                     size_t edge_prop_size,
+                                     size_t num_new_edges) {
+  // edges deleted as of the oldest epoch readers may read are dropped
+  timestamp_t safe_epoch = graph.get_min_read_epoch(write_epoch_id);
+  const auto& extents = graph.block_manager.get_extents();
+
   // merge old edge block + compact
   for (int i = 0; i < VERTEX_PER_SEG; i++) {
     size_t new_num_entries = 0;
@@ -361,6 +537,9 @@ void EpochGraphWriter::merge_segment(VegitoSegmentHeader* old_seg,
     auto merged_block =
         graph.block_manager.convert<VegitoEdgeBlockHeader>(region_ptr);
     std::vector<VegitoEdgeBlockHeader*> merged_edge_blocks;
+    std::vector<const EdgeDeletionBitmap*> dropped_edges;  // of each block
+    std::vector<size_t> dropped_offsets;  // from the oldest edge
+    std::vector<timestamp_t> deletion_epochs;  // after safe_epoch
 
     // 1. calculate the required order
     while (merged_block) {
@@ -368,21 +547,58 @@ void EpochGraphWriter::merge_segment(VegitoSegmentHeader* old_seg,
       size_t num_merged_entries = merged_block->get_num_entries();
 
       new_num_entries += num_merged_entries;
+      // old versions go with the old segment
+      for (uintptr_t p = merged_block->get_deletion_bitmap(); p;) {
+        auto bitmap = graph.block_manager.convert<EdgeDeletionBitmap>(p);
+        if (bitmap->get_epoch() > safe_epoch) {
+          deletion_epochs.push_back(bitmap->get_epoch());
+        }
+        graph.segments_to_recycle.push(
+            std::make_tuple(p, bitmap->get_order(), write_epoch_id));
+        p = bitmap->get_prev_pointer();
+      }
       merged_block = graph.block_manager.convert<VegitoEdgeBlockHeader>(
           merged_block->get_prev_pointer());
     }
 
-    if (new_num_entries == 0 && i != segidx)
+    size_t offset = 0;
+    for (int j = merged_edge_blocks.size() - 1; j >= 0; j--) {
+      auto dropped =
+          merged_edge_blocks[j]->get_deletion_bitmap(extents, safe_epoch);
+      dropped_edges.push_back(dropped);
+      size_t num_merged_entries = merged_edge_blocks[j]->get_num_entries();
+      for (size_t k = 0; k < num_merged_entries; k++, offset++) {
+        if (dropped && dropped->test(k)) {
+          dropped_offsets.push_back(offset);
+        }
+      }
+    }
+    new_num_entries -= dropped_offsets.size();
+
+    if (new_num_entries == 0 && i != segidx) {
+      uintptr_t epoch_table_pointer = old_seg->get_epoch_table(i);
+      if (epoch_table_pointer) {
+        graph.segments_to_recycle.push(std::make_tuple(
+            epoch_table_pointer,
+            graph.block_manager.convert<EpochBlockHeader>(epoch_table_pointer)
+                ->get_order(),
+            write_epoch_id));
+      }
       continue;
+    }
 
     auto merged_size = (pointer != nullptr && i == segidx)
-                           ? (new_num_entries + 1)
+                           ? (new_num_entries + num_new_edges)
                            : new_num_entries;
     auto merged_order = size_to_order(merged_size);
 
     auto new_edge_block_pointer = new_seg->alloc(merged_order, edge_prop_size);
     new_seg->set_region_ptr(i, new_edge_block_pointer);
-    new_seg->set_epoch_table(i, old_seg->get_epoch_table(i));
+    new_seg->set_epoch_table(
+        i, dropped_offsets.empty()
+               ? old_seg->get_epoch_table(i)
+               : merge_epoch_table(old_seg->get_epoch_table(i),
+                                   dropped_offsets));
     auto new_edge_block = graph.block_manager.convert<VegitoEdgeBlockHeader>(
         new_edge_block_pointer);
     new_edge_block->fill(merged_order, 0, 0);
@@ -390,11 +606,14 @@ void EpochGraphWriter::merge_segment(VegitoSegmentHeader* old_seg,
     // 2. merge + compact
     for (int j = merged_edge_blocks.size() - 1; j >= 0; j--) {
       auto merged_block = merged_edge_blocks[j];
+      auto dropped = dropped_edges[merged_edge_blocks.size() - 1 - j];
       size_t num_merged_entries = merged_block->get_num_entries();
       auto merged_entries = merged_block->get_entries();
 
       for (size_t k = 0; k < num_merged_entries; k++) {
         merged_entries--;
+        if (dropped && dropped->test(k))
+          continue;
         auto merged_edge =
             new_edge_block->append(*merged_entries);  // direct update size
         // insert edge property
@@ -412,6 +631,37 @@ void EpochGraphWriter::merge_segment(VegitoSegmentHeader* old_seg,
       }
     }
 
+    // 3. deletions still visible to some reader, by the new indexes
+    std::sort(deletion_epochs.begin(), deletion_epochs.end());
+    deletion_epochs.erase(
+        std::unique(deletion_epochs.begin(), deletion_epochs.end()),
+        deletion_epochs.end());
+    uintptr_t bitmap_pointer = 0;
+    for (timestamp_t epoch : deletion_epochs) {
+      order_t order = EdgeDeletionBitmap::get_order_for(
+          new_edge_block->get_block_size());
+      auto new_bitmap_pointer = graph.block_manager.alloc(order);
+      auto bitmap =
+          graph.block_manager.convert<EdgeDeletionBitmap>(new_bitmap_pointer);
+      bitmap->fill(order, epoch, bitmap_pointer, nullptr);
+      size_t idx = 0;
+      for (int j = merged_edge_blocks.size() - 1; j >= 0; j--) {
+        auto dropped = dropped_edges[merged_edge_blocks.size() - 1 - j];
+        auto deleted =
+            merged_edge_blocks[j]->get_deletion_bitmap(extents, epoch);
+        size_t num_merged_entries = merged_edge_blocks[j]->get_num_entries();
+        for (size_t k = 0; k < num_merged_entries; k++) {
+          if (dropped && dropped->test(k))
+            continue;
+          if (deleted && deleted->test(k))
+            bitmap->set(idx);
+          idx++;
+        }
+      }
+      bitmap_pointer = new_bitmap_pointer;
+    }
+    new_edge_block->set_deletion_bitmap(bitmap_pointer);
+
     if (pointer != nullptr && i == segidx) {
       *pointer = new_edge_block_pointer;
       *edge_block = new_edge_block;
@@ -419,9 +669,43 @@ void EpochGraphWriter::merge_segment(VegitoSegmentHeader* old_seg,
   }
 }
 
+uintptr_t EpochGraphWriter::merge_epoch_table(
+    uintptr_t epoch_table_pointer,
+    const std::vector<size_t>& dropped_offsets) {
+  auto epoch_table =
+      graph.block_manager.convert<EpochBlockHeader>(epoch_table_pointer);
+  if (!epoch_table)
+    return epoch_table_pointer;
+
+  order_t order = epoch_table->get_order();
+  auto new_epoch_table_pointer = graph.block_manager.alloc(order);
+  auto new_epoch_table =
+      graph.block_manager.convert<EpochBlockHeader>(new_epoch_table_pointer);
+  new_epoch_table->fill(order, 0, epoch_table->get_latest_epoch());
+
+  // an epoch starts after fewer edges, by those dropped before it
+  auto entries = epoch_table->get_entries();
+  auto num_entries = epoch_table->get_num_entries();
+  for (size_t i = 0; i < num_entries; i++) {
+    entries--;
+    VegitoEpochEntry epoch_entry = *entries;
+    size_t num_dropped =
+        std::lower_bound(dropped_offsets.begin(), dropped_offsets.end(),
+                         epoch_entry.get_offset()) -
+        dropped_offsets.begin();
+    epoch_entry.set_offset(epoch_entry.get_offset() - num_dropped);
+    new_epoch_table->append(epoch_entry);
+  }
+
+  graph.segments_to_recycle.push(
+      std::make_tuple(epoch_table_pointer, order, write_epoch_id));
+  return new_epoch_table_pointer;
+}
+
 void EpochGraphWriter::merge_segments(label_t label, dir_t dir) {
   size_t edge_prop_size = graph.get_edge_prop_size(label);
   for (segid_t segid = 0; segid < graph.get_max_seg_id(); segid++) {
+    graph.seg_mutexes[segid]->lock();
     auto segment = locate_segment(segid, label, dir);
     if (segment) {
       auto new_seg_pointer = graph.block_manager.alloc(segment->get_order());
@@ -431,8 +715,83 @@ void EpochGraphWriter::merge_segments(label_t label, dir_t dir) {
 
       merge_segment(segment, new_segment, -1, nullptr, nullptr, edge_prop_size);
 
-      // graph.block_manager.free(segment, segment->get_order());
+      graph.segments_to_recycle.push(
+          std::make_tuple(graph.block_manager.revert((uintptr_t) segment),
+                          segment->get_order(), write_epoch_id));
+      update_edge_label_block(segid, label, dir, new_seg_pointer);
+    }
+    graph.seg_mutexes[segid]->unlock();
+  }
+}
+
+size_t EpochGraphWriter::compact_segments(segid_t segid) {
+  size_t saved_bytes = 0;
+  graph.seg_mutexes[segid]->lock();
+  auto edge_label_block = graph.block_manager.convert<EdgeLabelBlockHeader>(
+      graph.edge_label_ptrs[segid]);
+  size_t num_labels =
+      edge_label_block ? edge_label_block->get_num_entries() : 0;
+  for (size_t i = 0; i < num_labels; i++) {
+    label_t label = edge_label_block->get_entries()[i].get_label();
+    size_t edge_prop_size = graph.get_edge_prop_size(label);
+    for (dir_t dir : {EOUT, EIN}) {
+      auto segment = locate_segment(segid, label, dir);
+      if (!segment)
+        continue;
+
+      // only a segment of half the size pays off, and it is then at least
+      // half full, so that it is not rewritten again
+      order_t order =
+          std::max(size_to_order(get_merged_size(segment, edge_prop_size)),
+                   get_init_segment_order());
+      if (order >= segment->get_order())
+        continue;
+
+      auto new_seg_pointer = graph.block_manager.alloc(order);
+      auto new_segment =
+          graph.block_manager.convert<VegitoSegmentHeader>(new_seg_pointer);
+      new_segment->fill(new_seg_pointer, order, segid);
+
+      merge_segment(segment, new_segment, -1, nullptr, nullptr, edge_prop_size);
+
+      graph.segments_to_recycle.push(
+          std::make_tuple(graph.block_manager.revert((uintptr_t) segment),
+                          segment->get_order(), write_epoch_id));
       update_edge_label_block(segid, label, dir, new_seg_pointer);
+      saved_bytes += segment->get_block_size() - new_segment->get_block_size();
+    }
+  }
+  graph.seg_mutexes[segid]->unlock();
+  return saved_bytes;
+}
+
+size_t EpochGraphWriter::get_merged_size(VegitoSegmentHeader* seg,
+                                         size_t edge_prop_size,
+                                         vertex_t segidx,
+                                         size_t num_new_edges) {
+  timestamp_t safe_epoch = graph.get_min_read_epoch(write_epoch_id);
+  const auto& extents = graph.block_manager.get_extents();
+  size_t num_slots = 0;
+  for (int i = 0; i < VERTEX_PER_SEG; i++) {
+    size_t num_entries = 0;
+    auto edge_block = graph.block_manager.convert<VegitoEdgeBlockHeader>(
+        seg->get_region_ptr(i));
+    while (edge_block) {
+      num_entries += edge_block->get_num_entries();
+      auto dropped = edge_block->get_deletion_bitmap(extents, safe_epoch);
+      if (dropped)
+        num_entries -= dropped->count(edge_block->get_num_entries());
+      edge_block = graph.block_manager.convert<VegitoEdgeBlockHeader>(
+          edge_block->get_prev_pointer());
     }
+    if (i == segidx)
+      num_entries += num_new_edges;
+    if (num_entries == 0)
+      continue;
+    // see VegitoSegmentHeader::alloc
+    num_slots += sizeof(VegitoEdgeBlockHeader) / sizeof(VegitoEdgeEntry) +
+                 (1ul << size_to_order(num_entries));
   }
+  return sizeof(VegitoSegmentHeader) +
+         num_slots * (sizeof(VegitoEdgeEntry) + edge_prop_size);
 }
@@ -33,6 +33,32 @@ using EpochGraphWriter = seggraph::EpochGraphWriter;
 using SegGraph = seggraph::SegGraph;
 using timestamp_t = seggraph::timestamp_t;
 
+namespace {
+// in the format of CheckpointWriter::WriteArray, chunk by chunk
+template <typename T>
+void write_array(gart::util::CheckpointWriter& writer,
+                 const seggraph::SegmentedArray<T>& array, size_t num) {
+  writer.Write(num);
+  size_t chunk_size = array.get_chunk_size();
+  for (size_t i = 0; i < num; i += chunk_size) {
+    writer.WriteBytes(&array[i], std::min(chunk_size, num - i) * sizeof(T));
+  }
+}
+
+template <typename T>
+bool read_array(gart::util::CheckpointReader& reader,
+                seggraph::SegmentedArray<T>& array, size_t num) {
+  if (reader.Read<size_t>() != num || !reader.ok()) {
+    return false;
+  }
+  size_t chunk_size = array.get_chunk_size();
+  for (size_t i = 0; i < num; i += chunk_size) {
+    reader.ReadBytes(&array[i], std::min(chunk_size, num - i) * sizeof(T));
+  }
+  return reader.ok();
+}
+}  // namespace
+
 SegTransaction SegGraph::begin_transaction() {
   auto local_txn_id = transaction_id.fetch_add(1, std::memory_order_relaxed) +
                       1;  // txn_id begin from 1
@@ -64,17 +90,93 @@ SegTransaction SegGraph::begin_batch_loader() {
   return SegTransaction(*this, RO_TRANSACTION, read_epoch_id, true, false);
 }
 
-void SegGraph::recycle_segments(timestamp_t epoch_id) {
-  std::vector<std::tuple<uintptr_t, order_t, timestamp_t>>
-      new_segments_to_recycle;
-  for (std::tuple<uintptr_t, order_t, timestamp_t> segment :
-       segments_to_recycle.local()) {
+size_t SegGraph::recycle_segments(timestamp_t epoch_id) {
+  timestamp_t min_read_epoch = get_min_read_epoch(epoch_id);
+  // blocks retired meanwhile wait for the next call
+  size_t num_segments = segments_to_recycle.unsafe_size();
+  size_t freed_bytes = 0;
+  std::tuple<uintptr_t, order_t, timestamp_t> segment;
+  for (size_t i = 0; i < num_segments && segments_to_recycle.try_pop(segment);
+       i++) {
     timestamp_t epoch = std::get<2>(segment);
-    if (epoch + LAG_EPOCH_NUMBER < epoch_id) {
-      block_manager.free(std::get<0>(segment), std::get<1>(segment));
+    if (epoch < min_read_epoch) {
+      block_manager.free_shared(std::get<0>(segment), std::get<1>(segment));
+      freed_bytes += 1ul << std::get<1>(segment);
     } else {
-      new_segments_to_recycle.push_back(segment);
+      segments_to_recycle.push(segment);
     }
   }
-  segments_to_recycle.local().swap(new_segments_to_recycle);
+  return freed_bytes;
+}
+
+void SegGraph::checkpoint(gart::util::CheckpointWriter& writer) {
+  vertex_t num_vertices = vertex_id.load();
+  segid_t num_segs = seg_id.load() + 1;  // segment 0 always exists
+  writer.Write(epoch_id.load());
+  writer.Write(transaction_id.load());
+  writer.Write(num_vertices);
+  writer.Write(num_segs);
+  writer.Write(deleted_inner);
+  writer.Write(deleted_outer);
+  write_array(writer, vertex_ptrs, num_vertices);
+  write_array(writer, edge_label_ptrs, num_segs);
+
+  std::vector<vertex_t> recycled_ids(recycled_vertex_ids.unsafe_begin(),
+                                     recycled_vertex_ids.unsafe_end());
+  writer.WriteVector(recycled_ids);
+
+  std::vector<std::tuple<uintptr_t, order_t, timestamp_t>> segments(
+      segments_to_recycle.unsafe_begin(), segments_to_recycle.unsafe_end());
+  writer.Write(segments.size());
+  for (const auto& segment : segments) {
+    writer.Write(std::get<0>(segment));
+    writer.Write(std::get<1>(segment));
+    writer.Write(std::get<2>(segment));
+  }
+
+  block_manager.checkpoint(writer);
+}
+
+bool SegGraph::restore(gart::util::CheckpointReader& reader) {
+  epoch_id = reader.Read<timestamp_t>();
+  transaction_id = reader.Read<timestamp_t>();
+  vertex_t num_vertices = reader.Read<vertex_t>();
+  segid_t num_segs = reader.Read<segid_t>();
+  deleted_inner = reader.Read<uint64_t>();
+  deleted_outer = reader.Read<uint64_t>();
+  if (!reader.ok() || num_segs == 0) {
+    return false;
+  }
+  reserve_vertices(num_vertices);
+  if (num_segs > edge_label_ptrs.capacity() ||
+      !read_array(reader, vertex_ptrs, num_vertices) ||
+      !read_array(reader, edge_label_ptrs, num_segs)) {
+    return false;
+  }
+  for (vertex_t v = 0; v < num_vertices; v++) {
+    vertex_futexes[v].clear();
+  }
+  for (segid_t seg = 1; seg < num_segs; seg++) {
+    seg_mutexes[seg] = new std::shared_timed_mutex();
+  }
+  vertex_id = num_vertices;
+  seg_id = num_segs - 1;
+
+  std::vector<vertex_t> recycled_ids;
+  reader.ReadVector(recycled_ids);
+  recycled_vertex_ids.clear();
+  for (vertex_t v : recycled_ids) {
+    recycled_vertex_ids.push(v);
+  }
+
+  size_t num_recycle = reader.Read<size_t>();
+  segments_to_recycle.clear();
+  for (size_t i = 0; i < num_recycle && reader.ok(); i++) {
+    uintptr_t pointer = reader.Read<uintptr_t>();
+    order_t order = reader.Read<order_t>();
+    timestamp_t epoch = reader.Read<timestamp_t>();
+    segments_to_recycle.push(std::make_tuple(pointer, order, epoch));
+  }
+
+  return reader.ok() && block_manager.restore(reader);
 }
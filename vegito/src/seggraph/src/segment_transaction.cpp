@@ -43,6 +43,7 @@ vertex_t SegTransaction::new_vertex(bool use_recycled_vertex) {
   } else if (!use_recycled_vertex ||
              (!graph.recycled_vertex_ids.try_pop(vertex_id))) {
     vertex_id = graph.vertex_id.fetch_add(1, std::memory_order_relaxed);
+    graph.reserve_vertices(vertex_id + 1);
   }
   graph.vertex_futexes[vertex_id].clear();
   graph.vertex_ptrs[vertex_id] = graph.block_manager.NULLPOINTER;
@@ -23,6 +23,18 @@ DEFINE_string(kafka_unified_log_topic, "unified_log",
               "Kafka topic for unified logs.");
 DEFINE_string(kafka_unified_log_file, "test_graph.txt",
               "The file to record unified logs.");  // for tests
+DEFINE_int32(kafka_fetch_batch_size, 512,
+             "max number of messages fetched from kafka in a batch.");
+DEFINE_int32(kafka_prefetch_depth, 65536,
+             "max number of kafka messages prefetched or being applied.");
+DEFINE_string(unified_log_shm_name, "",
+              "read unified logs from shared memory rings named "
+              "/<name>_<partition> instead of kafka, see binlog_convert.");
+DEFINE_int32(unified_log_shm_size_mb, 256,
+             "size of each shared memory ring in MB, if it is created.");
+DEFINE_string(bulk_load_dir, "",
+              "directory of the unified logs of a bulk load, see "
+              "binlog_convert; loaded as epoch 0 if there is no checkpoint.");
 
 DEFINE_string(etcd_endpoint, "http://127.0.0.1:2379",
               "etcd endpoint for schema.");
@@ -36,3 +48,33 @@ DEFINE_string(table_schema_file_path, "schema/db_schema.json",
 
 DEFINE_int32(server_num, 2, "total server number.");
 DEFINE_int32(server_id, 0, "server id.");
+DEFINE_int32(num_partitions, 0,
+             "total partition number, 0 for one partition per server.");
+DEFINE_string(partition_map_file, "",
+              "json file mapping server id to its partitions, "
+              "partitions are assigned round-robin if empty.");
+
+DEFINE_int32(num_parse_threads, 2, "number of threads to parse unified logs.");
+DEFINE_int32(num_apply_threads, 0,
+             "number of threads to apply edges to the graph store, "
+             "0 to apply all logs on the consumer thread.");
+DEFINE_int32(pipeline_batch_size, 1024,
+             "number of unified logs in a batch of the apply pipeline.");
+DEFINE_int32(pipeline_max_inflight_batches, 16,
+             "max number of batches queued in the apply pipeline.");
+
+DEFINE_string(checkpoint_dir, "",
+              "directory of graph store checkpoints, "
+              "empty to disable checkpointing and recovery.");
+DEFINE_int32(checkpoint_epoch_interval, 100,
+             "number of epochs between two checkpoints.");
+
+DEFINE_int32(metrics_interval_ms, 5000,
+             "interval to export ingest metrics to etcd, 0 to disable.");
+DEFINE_string(metrics_file, "",
+              "file to export ingest metrics to, "
+              "rewritten every metrics interval if not empty.");
+
+DEFINE_int32(compaction_interval_ms, 1000,
+             "interval to free and compact topology blocks no reader "
+             "reads, 0 to disable.");
@@ -21,6 +21,11 @@
 DECLARE_string(kafka_broker_list);
 DECLARE_string(kafka_unified_log_topic);
 DECLARE_string(kafka_unified_log_file);  // for tests
+DECLARE_int32(kafka_fetch_batch_size);
+DECLARE_int32(kafka_prefetch_depth);
+DECLARE_string(unified_log_shm_name);
+DECLARE_int32(unified_log_shm_size_mb);
+DECLARE_string(bulk_load_dir);
 
 DECLARE_string(etcd_endpoint);
 DECLARE_string(meta_prefix);
@@ -31,5 +36,20 @@ DECLARE_string(table_schema_file_path);
 
 DECLARE_int32(server_num);
 DECLARE_int32(server_id);
+DECLARE_int32(num_partitions);
+DECLARE_string(partition_map_file);
+
+DECLARE_int32(num_parse_threads);
+DECLARE_int32(num_apply_threads);
+DECLARE_int32(pipeline_batch_size);
+DECLARE_int32(pipeline_max_inflight_batches);
+
+DECLARE_string(checkpoint_dir);
+DECLARE_int32(checkpoint_epoch_interval);
+
+DECLARE_int32(metrics_interval_ms);
+DECLARE_string(metrics_file);
+
+DECLARE_int32(compaction_interval_ms);
 
 #endif  // VEGITO_SRC_SYSTEM_FLAGS_H_
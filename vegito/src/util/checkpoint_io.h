@@ -0,0 +1,146 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_UTIL_CHECKPOINT_IO_H_
+#define VEGITO_SRC_UTIL_CHECKPOINT_IO_H_
+
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace gart {
+namespace util {
+
+/**
+ * Binary writer of checkpoint files. Values are written in the host byte
+ * order, so a checkpoint can only be restored on the same architecture.
+ */
+class CheckpointWriter {
+ public:
+  explicit CheckpointWriter(std::ostream& os) : os_(os) {}
+
+  template <typename T>
+  void Write(const T& val) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be checkpointed");
+    os_.write(reinterpret_cast<const char*>(&val), sizeof(T));
+  }
+
+  void WriteBytes(const void* data, size_t len) {
+    os_.write(static_cast<const char*>(data), len);
+  }
+
+  // the number of elements is written before the elements
+  template <typename T>
+  void WriteArray(const T* vals, size_t num) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be checkpointed");
+    Write(num);
+    WriteBytes(vals, num * sizeof(T));
+  }
+
+  template <typename T>
+  void WriteVector(const std::vector<T>& vals) {
+    WriteArray(vals.data(), vals.size());
+  }
+
+  template <typename K, typename V>
+  void WriteMap(const std::unordered_map<K, V>& map) {
+    Write(map.size());
+    for (const auto& pair : map) {
+      Write(pair.first);
+      Write(pair.second);
+    }
+  }
+
+  bool ok() const { return os_.good(); }
+
+ private:
+  std::ostream& os_;
+};
+
+/**
+ * Reader of files written by CheckpointWriter. A short or inconsistent file
+ * makes the reader fail, and every later read returns zeros.
+ */
+class CheckpointReader {
+ public:
+  explicit CheckpointReader(std::istream& is) : is_(is) {}
+
+  template <typename T>
+  T Read() {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "only trivially copyable values can be checkpointed");
+    T val{};
+    ReadBytes(&val, sizeof(T));
+    return val;
+  }
+
+  void ReadBytes(void* data, size_t len) {
+    if (!ok()) {
+      return;
+    }
+    is_.read(static_cast<char*>(data), len);
+  }
+
+  // returns the number of elements read, at most `capacity`
+  template <typename T>
+  size_t ReadArray(T* vals, size_t capacity) {
+    size_t num = Read<size_t>();
+    if (num > capacity) {
+      failed_ = true;
+      return 0;
+    }
+    ReadBytes(vals, num * sizeof(T));
+    return ok() ? num : 0;
+  }
+
+  template <typename T>
+  void ReadVector(std::vector<T>& vals) {
+    size_t num = Read<size_t>();
+    if (!ok()) {
+      return;
+    }
+    vals.resize(num);
+    ReadBytes(vals.data(), num * sizeof(T));
+  }
+
+  template <typename K, typename V>
+  void ReadMap(std::unordered_map<K, V>& map) {
+    size_t num = Read<size_t>();
+    map.clear();
+    map.reserve(num);
+    for (size_t i = 0; i < num && ok(); i++) {
+      K key = Read<K>();
+      map[key] = Read<V>();
+    }
+  }
+
+  // mark the checkpoint as inconsistent
+  void Fail() { failed_ = true; }
+
+  bool ok() const { return !failed_ && is_.good(); }
+
+ private:
+  std::istream& is_;
+  bool failed_ = false;
+};
+
+}  // namespace util
+}  // namespace gart
+
+#endif  // VEGITO_SRC_UTIL_CHECKPOINT_IO_H_
@@ -0,0 +1,298 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_UTIL_KAFKA_CONSUMER_H_
+#define VEGITO_SRC_UTIL_KAFKA_CONSUMER_H_
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "glog/logging.h"
+#include "librdkafka/rdkafka.h"
+#include "librdkafka/rdkafkacpp.h"
+
+namespace gart {
+namespace util {
+
+class KafkaConsumer;
+
+/**
+ * Messages handed out by KafkaConsumer::Consume(). Payloads point into the
+ * librdkafka buffers and stay valid until the batch is released, which also
+ * returns its slots to the prefetch ring of the consumer.
+ *
+ * A batch must be released before its consumer is destroyed.
+ */
+class KafkaMessageBatch {
+ public:
+  KafkaMessageBatch(const KafkaMessageBatch&) = delete;
+  KafkaMessageBatch& operator=(const KafkaMessageBatch&) = delete;
+
+  ~KafkaMessageBatch() { Release(); }
+
+  size_t size() const { return messages_.size(); }
+
+  bool empty() const { return messages_.empty(); }
+
+  std::string_view payload(size_t idx) const {
+    const rd_kafka_message_t* msg = messages_[idx];
+    return std::string_view(static_cast<const char*>(msg->payload), msg->len);
+  }
+
+  int64_t offset(size_t idx) const { return messages_[idx]->offset; }
+
+  inline void Release();
+
+ private:
+  friend class KafkaConsumer;
+
+  explicit KafkaMessageBatch(KafkaConsumer* consumer) : consumer_(consumer) {}
+
+  KafkaConsumer* consumer_;
+  std::vector<rd_kafka_message_t*> messages_;
+};
+
+/**
+ * Consumer of one Kafka partition with a background prefetch thread.
+ *
+ * The prefetch thread pulls messages with rd_kafka_consume_batch() into a
+ * ring of at most `queue_depth` messages. Messages count against the ring
+ * until their KafkaMessageBatch is released, so the memory held by a slow
+ * reader is bounded.
+ */
+class KafkaConsumer {
+ public:
+  KafkaConsumer(const std::string& broker_list, const std::string& topic,
+                int32_t partition, size_t fetch_batch_size, size_t queue_depth)
+      : partition_(partition),
+        fetch_batch_size_(std::max(fetch_batch_size, size_t(1))),
+        queue_depth_(std::max(queue_depth, size_t(1))),
+        ring_(queue_depth_, nullptr) {
+    RdKafka::Conf* conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
+    std::string rdkafka_err;
+    if (conf->set("metadata.broker.list", broker_list, rdkafka_err) !=
+        RdKafka::Conf::CONF_OK) {
+      LOG(ERROR) << "Failed to set metadata.broker.list: " << rdkafka_err;
+    }
+    if (conf->set("group.id", "gart_consumer", rdkafka_err) !=
+        RdKafka::Conf::CONF_OK) {
+      LOG(ERROR) << "Failed to set group.id: " << rdkafka_err;
+    }
+    if (conf->set("enable.auto.commit", "false", rdkafka_err) !=
+        RdKafka::Conf::CONF_OK) {
+      LOG(ERROR) << "Failed to set enable.auto.commit: " << rdkafka_err;
+    }
+    if (conf->set("auto.offset.reset", "earliest", rdkafka_err) !=
+        RdKafka::Conf::CONF_OK) {
+      LOG(ERROR) << "Failed to set auto.offset.reset: " << rdkafka_err;
+    }
+
+    consumer_ = RdKafka::Consumer::create(conf, rdkafka_err);
+    delete conf;
+    if (!consumer_) {
+      LOG(ERROR) << "Failed to create consumer: " << rdkafka_err;
+      exit(1);
+    }
+
+    RdKafka::Conf* tconf = RdKafka::Conf::create(RdKafka::Conf::CONF_TOPIC);
+    topic_ = RdKafka::Topic::create(consumer_, topic, tconf, rdkafka_err);
+    delete tconf;
+    if (!topic_) {
+      LOG(ERROR) << "Failed to create topic " << topic << ": " << rdkafka_err;
+      exit(1);
+    }
+  }
+
+  KafkaConsumer(const KafkaConsumer&) = delete;
+  KafkaConsumer& operator=(const KafkaConsumer&) = delete;
+
+  ~KafkaConsumer() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    space_cv_.notify_all();
+    ready_cv_.notify_all();
+    if (prefetch_thread_.joinable()) {
+      prefetch_thread_.join();
+      consumer_->stop(topic_, partition_);
+    }
+    for (size_t i = 0; i < num_ready_; i++) {
+      rd_kafka_message_destroy(ring_[(head_ + i) % queue_depth_]);
+    }
+    delete topic_;
+    delete consumer_;
+  }
+
+  void Start(int64_t start_offset = RdKafka::Topic::OFFSET_BEGINNING) {
+    RdKafka::ErrorCode resp =
+        consumer_->start(topic_, partition_, start_offset);
+    if (resp != RdKafka::ERR_NO_ERROR) {
+      LOG(ERROR) << "Failed to start consumer: " << RdKafka::err2str(resp);
+      exit(1);
+    }
+    prefetch_thread_ = std::thread([this] { prefetch_loop_(); });
+  }
+
+  /**
+   * Take up to `max_messages` prefetched messages. Waits for a full batch
+   * while the prefetcher is behind the partition, otherwise returns what is
+   * ready; the batch is empty if nothing arrives within `timeout_ms`.
+   */
+  std::shared_ptr<KafkaMessageBatch> Consume(size_t max_messages,
+                                             int timeout_ms) {
+    std::shared_ptr<KafkaMessageBatch> batch(new KafkaMessageBatch(this));
+    max_messages = std::clamp(max_messages, size_t(1), queue_depth_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    ready_cv_.wait_for(
+        lock, std::chrono::milliseconds(timeout_ms), [this, max_messages] {
+          return stop_ || num_ready_ >= max_messages ||
+                 (num_ready_ > 0 &&
+                  (caught_up_ || num_outstanding_ == queue_depth_));
+        });
+    size_t num = std::min(num_ready_, max_messages);
+    batch->messages_.reserve(num);
+    for (size_t i = 0; i < num; i++) {
+      batch->messages_.push_back(ring_[head_]);
+      head_ = (head_ + 1) % queue_depth_;
+    }
+    num_ready_ -= num;
+    return batch;
+  }
+
+  /**
+   * Number of messages in the partition from `next_offset` on, by the high
+   * watermark cached from the last fetch; -1 if it is unknown yet.
+   */
+  int64_t GetLag(int64_t next_offset) {
+    int64_t low = 0, high = 0;
+    if (consumer_->get_watermark_offsets(topic_->name(), partition_, &low,
+                                         &high) != RdKafka::ERR_NO_ERROR ||
+        high < 0) {
+      return -1;
+    }
+    return std::max(high - next_offset, int64_t(0));
+  }
+
+ private:
+  friend class KafkaMessageBatch;
+
+  static constexpr int kFetchTimeoutMs = 100;
+
+  void prefetch_loop_() {
+    std::vector<rd_kafka_message_t*> fetched(fetch_batch_size_);
+    while (true) {
+      size_t num_fetch;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_cv_.wait(lock, [this] {
+          return stop_ || num_outstanding_ < queue_depth_;
+        });
+        if (stop_) {
+          return;
+        }
+        num_fetch =
+            std::min(fetch_batch_size_, queue_depth_ - num_outstanding_);
+      }
+
+      ssize_t cnt = rd_kafka_consume_batch(topic_->c_ptr(), partition_,
+                                           kFetchTimeoutMs, fetched.data(),
+                                           num_fetch);
+      if (cnt < 0) {
+        LOG(ERROR) << "Failed to consume from kafka: "
+                   << rd_kafka_err2str(rd_kafka_last_error());
+        std::this_thread::sleep_for(
+            std::chrono::milliseconds(kFetchTimeoutMs));
+        continue;
+      }
+
+      // drop errors (e.g., partition EOF) and empty messages
+      size_t num_valid = 0;
+      for (ssize_t i = 0; i < cnt; i++) {
+        rd_kafka_message_t* msg = fetched[i];
+        if (msg->err != RD_KAFKA_RESP_ERR_NO_ERROR || msg->len == 0) {
+          if (msg->err != RD_KAFKA_RESP_ERR_NO_ERROR &&
+              msg->err != RD_KAFKA_RESP_ERR__PARTITION_EOF) {
+            LOG(ERROR) << "Kafka message error: " << rd_kafka_err2str(msg->err);
+          }
+          rd_kafka_message_destroy(msg);
+          continue;
+        }
+        fetched[num_valid++] = msg;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < num_valid; i++) {
+          ring_[(head_ + num_ready_) % queue_depth_] = fetched[i];
+          num_ready_++;
+        }
+        num_outstanding_ += num_valid;
+        caught_up_ = static_cast<size_t>(cnt) < num_fetch;
+      }
+      ready_cv_.notify_one();
+    }
+  }
+
+  void release_(size_t num) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      num_outstanding_ -= num;
+    }
+    space_cv_.notify_one();
+  }
+
+  RdKafka::Consumer* consumer_;
+  RdKafka::Topic* topic_;
+  int32_t partition_;
+  size_t fetch_batch_size_;
+  size_t queue_depth_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  std::condition_variable space_cv_;
+  std::vector<rd_kafka_message_t*> ring_;  // prefetched, not handed out
+  size_t head_ = 0;
+  size_t num_ready_ = 0;
+  size_t num_outstanding_ = 0;  // prefetched and not released yet
+  bool caught_up_ = false;      // the last fetch drained the partition
+  bool stop_ = false;
+
+  std::thread prefetch_thread_;
+};
+
+inline void KafkaMessageBatch::Release() {
+  if (messages_.empty()) {
+    return;
+  }
+  for (rd_kafka_message_t* msg : messages_) {
+    rd_kafka_message_destroy(msg);
+  }
+  consumer_->release_(messages_.size());
+  messages_.clear();
+}
+
+}  // namespace util
+}  // namespace gart
+
+#endif  // VEGITO_SRC_UTIL_KAFKA_CONSUMER_H_
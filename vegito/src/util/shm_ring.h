@@ -0,0 +1,398 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef VEGITO_SRC_UTIL_SHM_RING_H_
+#define VEGITO_SRC_UTIL_SHM_RING_H_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace gart {
+namespace util {
+
+// shared memory object of the ring of a partition, e.g., /gart_log_0
+inline std::string ShmRingName(const std::string& prefix, int32_t partition) {
+  return "/" + prefix + "_" + std::to_string(partition);
+}
+
+/**
+ * A single-producer, single-consumer ring of messages in a POSIX shared
+ * memory object, for a converter and a writer on the same host.
+ *
+ * Positions are byte offsets counted from the creation of the ring, so they
+ * only grow. Each message is an 8-byte header (length and flags) followed
+ * by the payload, padded to 8 bytes; a message never wraps around the end
+ * of the ring, which is skipped with a padding header instead. The producer
+ * blocks while the ring is full, and space is only reused once the consumer
+ * releases it.
+ *
+ * Both sides open the ring by name with the same capacity, whichever comes
+ * first creates it, and a zeroed ring is empty. The ring outlives both
+ * processes until it is unlinked, e.g., `rm /dev/shm/gart_log_0`.
+ */
+class ShmRing {
+ public:
+  ShmRing() = default;
+  ShmRing(const ShmRing&) = delete;
+  ShmRing& operator=(const ShmRing&) = delete;
+
+  ~ShmRing() {
+    if (header_) {
+      munmap(header_, sizeof(Header) + capacity_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  /**
+   * Only the process that creates the ring sizes it, the other one waits
+   * for the size. Both sides must agree on the capacity, and an existing
+   * ring keeps its contents.
+   */
+  bool Open(const std::string& name, size_t capacity) {
+    capacity = std::max(capacity & ~(kAlign - 1), kAlign * 2);
+    bool created = true;
+    fd_ = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd_ < 0 && errno == EEXIST) {
+      created = false;
+      fd_ = shm_open(name.c_str(), O_RDWR, 0600);
+    }
+    if (fd_ < 0) {
+      LOG(ERROR) << "Open shared memory " << name
+                 << " failed: " << strerror(errno);
+      return false;
+    }
+    if (created && ftruncate(fd_, sizeof(Header) + capacity) != 0) {
+      LOG(ERROR) << "Truncate shared memory " << name
+                 << " failed: " << strerror(errno);
+      return false;
+    }
+    struct stat st;
+    for (int waited_us = 0;; waited_us += kPollIntervalUs) {
+      if (fstat(fd_, &st) != 0) {
+        LOG(ERROR) << "Stat shared memory " << name
+                   << " failed: " << strerror(errno);
+        return false;
+      }
+      if (st.st_size != 0) {
+        break;
+      }
+      if (waited_us >= kOpenTimeoutUs) {
+        // the creator died before sizing it
+        LOG(ERROR) << "Shared memory " << name << " is not sized, unlink it";
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(kPollIntervalUs));
+    }
+    if (static_cast<size_t>(st.st_size) < sizeof(Header) + kAlign * 2) {
+      LOG(ERROR) << "Shared memory " << name << " is too small";
+      return false;
+    }
+    capacity_ = (st.st_size - sizeof(Header)) & ~(kAlign - 1);
+    if (capacity_ != capacity) {
+      LOG(ERROR) << "Shared memory " << name << " holds a ring of "
+                 << capacity_ << " bytes, not " << capacity;
+      return false;
+    }
+    void* addr = mmap(nullptr, sizeof(Header) + capacity_,
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+      LOG(ERROR) << "Map shared memory " << name
+                 << " failed: " << strerror(errno);
+      return false;
+    }
+    header_ = static_cast<Header*>(addr);
+    data_ = static_cast<char*>(addr) + sizeof(Header);
+    return true;
+  }
+
+  /**
+   * Copy a message into the ring, waiting while it is full. Returns false
+   * if the message is larger than the ring.
+   */
+  bool Push(const char* data, size_t len) {
+    uint64_t pos = header_->head.load(std::memory_order_relaxed);
+    size_t size = kAlign + align_(len);
+    size_t to_end = capacity_ - pos % capacity_;
+    size_t skip = to_end < size ? to_end : 0;
+    if (skip + size > capacity_ || len > UINT32_MAX) {
+      LOG(ERROR) << "Message of " << len << " bytes exceeds the ring of "
+                 << capacity_ << " bytes";
+      return false;
+    }
+    while (pos + skip + size -
+               header_->tail.load(std::memory_order_acquire) >
+           capacity_) {
+      std::this_thread::sleep_for(std::chrono::microseconds(kPollIntervalUs));
+    }
+    if (skip) {
+      write_header_(pos, 0, kPadding);
+      pos += skip;
+    }
+    write_header_(pos, static_cast<uint32_t>(len), 0);
+    memcpy(data_ + pos % capacity_ + kAlign, data, len);
+    header_->head.store(pos + size, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * The message at `pos`, if it has been written. `next` is set to the
+   * position after it. The message stays valid until released.
+   */
+  bool Peek(uint64_t pos, std::string_view& msg, uint64_t& next) const {
+    uint64_t head = header_->head.load(std::memory_order_acquire);
+    while (pos < head) {
+      uint32_t len, flags;
+      memcpy(&len, data_ + pos % capacity_, sizeof(len));
+      memcpy(&flags, data_ + pos % capacity_ + sizeof(len), sizeof(flags));
+      if (flags & kPadding) {
+        pos += capacity_ - pos % capacity_;
+        continue;
+      }
+      msg = std::string_view(data_ + pos % capacity_ + kAlign, len);
+      next = pos + kAlign + align_(len);
+      return true;
+    }
+    return false;
+  }
+
+  // messages before `pos` may be overwritten
+  void Release(uint64_t pos) {
+    header_->tail.store(pos, std::memory_order_release);
+  }
+
+  uint64_t head() const {
+    return header_->head.load(std::memory_order_acquire);
+  }
+
+  uint64_t tail() const {
+    return header_->tail.load(std::memory_order_acquire);
+  }
+
+  static constexpr int kPollIntervalUs = 50;
+
+ private:
+  static constexpr int kOpenTimeoutUs = 10 * 1000 * 1000;
+  static constexpr size_t kAlign = 8;
+  static constexpr uint32_t kPadding = 1;  // the rest of the ring is unused
+
+  // head and tail on their own cache lines
+  struct Header {
+    alignas(64) std::atomic<uint64_t> head;  // end of the written messages
+    alignas(64) std::atomic<uint64_t> tail;  // end of the released messages
+  };
+
+  static size_t align_(size_t len) {
+    return (len + kAlign - 1) & ~(kAlign - 1);
+  }
+
+  void write_header_(uint64_t pos, uint32_t len, uint32_t flags) {
+    memcpy(data_ + pos % capacity_, &len, sizeof(len));
+    memcpy(data_ + pos % capacity_ + sizeof(len), &flags, sizeof(flags));
+  }
+
+  int fd_ = -1;
+  Header* header_ = nullptr;
+  char* data_ = nullptr;
+  size_t capacity_ = 0;  // bytes for messages, a multiple of kAlign
+};
+
+class ShmRingConsumer;
+
+/**
+ * Messages handed out by ShmRingConsumer::Consume(). Payloads point into
+ * the ring and stay valid until the batch is released.
+ *
+ * A batch must be released before its consumer is destroyed.
+ */
+class ShmMessageBatch {
+ public:
+  ShmMessageBatch(const ShmMessageBatch&) = delete;
+  ShmMessageBatch& operator=(const ShmMessageBatch&) = delete;
+
+  ~ShmMessageBatch() { Release(); }
+
+  size_t size() const { return messages_.size(); }
+
+  bool empty() const { return messages_.empty(); }
+
+  std::string_view payload(size_t idx) const { return messages_[idx].first; }
+
+  // position of the message in the ring
+  int64_t offset(size_t idx) const { return messages_[idx].second; }
+
+  inline void Release();
+
+ private:
+  friend class ShmRingConsumer;
+
+  explicit ShmMessageBatch(ShmRingConsumer* consumer) : consumer_(consumer) {}
+
+  ShmRingConsumer* consumer_;
+  std::vector<std::pair<std::string_view, int64_t>> messages_;
+  uint64_t end_ = 0;  // position after the last message
+};
+
+/**
+ * Consumer of a ShmRing, with the interface of KafkaConsumer. Batches may
+ * be released in any order; the space of a batch is returned to the ring
+ * once all batches before it are released too.
+ *
+ * With `retain`, released messages stay in the ring until Commit() covers
+ * them, e.g., once a checkpoint up to them is saved, so that a restart from
+ * the checkpoint finds them; the ring must then hold the logs between two
+ * checkpoints. A start position no longer in the ring is fatal.
+ */
+class ShmRingConsumer {
+ public:
+  ShmRingConsumer(const std::string& name, size_t capacity,
+                  bool retain = false)
+      : retain_(retain) {
+    if (!ring_.Open(name, capacity)) {
+      exit(1);
+    }
+  }
+
+  ShmRingConsumer(const ShmRingConsumer&) = delete;
+  ShmRingConsumer& operator=(const ShmRingConsumer&) = delete;
+
+  void Start(int64_t start_offset = -1) {
+    next_ = ring_.tail();
+    if (start_offset >= 0) {
+      // skipping or replaying logs would silently corrupt the graph
+      if (static_cast<uint64_t>(start_offset) < next_ ||
+          static_cast<uint64_t>(start_offset) > ring_.head()) {
+        LOG(ERROR) << "Position " << start_offset << " is not in the ring ["
+                   << next_ << ", " << ring_.head() << "].";
+        exit(1);
+      }
+      next_ = start_offset;
+      ring_.Release(next_);
+    }
+    applied_ = next_;
+    committed_ = next_;
+  }
+
+  /**
+   * Take up to `max_messages` messages, waiting up to `timeout_ms` for the
+   * first one; the batch is empty if nothing arrives.
+   */
+  std::shared_ptr<ShmMessageBatch> Consume(size_t max_messages,
+                                           int timeout_ms) {
+    std::shared_ptr<ShmMessageBatch> batch(new ShmMessageBatch(this));
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(timeout_ms);
+    std::string_view msg;
+    uint64_t next;
+    while (!ring_.Peek(next_, msg, next)) {
+      if (std::chrono::steady_clock::now() >= deadline) {
+        return batch;
+      }
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(ShmRing::kPollIntervalUs));
+    }
+    do {
+      batch->messages_.emplace_back(msg, static_cast<int64_t>(next_));
+      next_ = next;
+    } while (batch->messages_.size() < max_messages &&
+             ring_.Peek(next_, msg, next));
+    batch->end_ = next_;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    outstanding_.emplace_back(next_, false);
+    return batch;
+  }
+
+  // messages before `offset` may leave the ring, once released
+  void Commit(int64_t offset) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    committed_ = std::max(committed_, static_cast<uint64_t>(offset));
+    release_ring_();
+  }
+
+  // number of bytes in the ring from `next_offset` on
+  int64_t GetLag(int64_t next_offset) const {
+    return std::max(static_cast<int64_t>(ring_.head()) - next_offset,
+                    int64_t(0));
+  }
+
+ private:
+  friend class ShmMessageBatch;
+
+  void release_(uint64_t end) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& batch : outstanding_) {
+      if (batch.first == end) {
+        batch.second = true;
+        break;
+      }
+    }
+    while (!outstanding_.empty() && outstanding_.front().second) {
+      applied_ = outstanding_.front().first;
+      outstanding_.pop_front();
+    }
+    release_ring_();
+  }
+
+  void release_ring_() {
+    uint64_t end = retain_ ? std::min(applied_, committed_) : applied_;
+    if (end > ring_.tail()) {
+      ring_.Release(end);
+    }
+  }
+
+  ShmRing ring_;
+  const bool retain_;
+  uint64_t next_ = 0;  // position of the next message to hand out
+
+  std::mutex mutex_;
+  // end position of each batch handed out, and whether it is released
+  std::deque<std::pair<uint64_t, bool>> outstanding_;
+  uint64_t applied_ = 0;    // end of the batches released in order
+  uint64_t committed_ = 0;  // see Commit()
+};
+
+inline void ShmMessageBatch::Release() {
+  if (messages_.empty()) {
+    return;
+  }
+  consumer_->release_(end_);
+  messages_.clear();
+}
+
+}  // namespace util
+}  // namespace gart
+
+#endif  // VEGITO_SRC_UTIL_SHM_RING_H_
@@ -0,0 +1,468 @@
+/** Copyright 2020-2023 Alibaba Group Holding Limited.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/**
+ * Ingest throughput benchmark of the writer. It generates a synthetic graph
+ * schema and a stream of text UnifiedLogs, and feeds them to the Runner
+ * through the file-stream path, so neither Kafka nor MySQL is needed (etcd
+ * and vineyard still are).
+ *
+ * Example:
+ *   vegito_ingest_bench --bench_num_ops 1000000 --bench_edge_ratio 0.8 \
+ *       --num_partitions 2 --v6d_ipc_socket /tmp/v6d.sock
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+
+#include "gflags/gflags.h"
+#include "vineyard/common/util/json.h"
+
+#include "fragment/id_parser.h"
+#include "framework/bench_runner.h"
+#include "framework/config.h"
+#include "graph/graph_store.h"
+
+DEFINE_string(bench_dir, "/tmp/gart_ingest_bench",
+              "directory of the generated schema and log files.");
+DEFINE_int64(bench_num_ops, 1000000, "number of generated logs.");
+DEFINE_int32(bench_logs_per_epoch, 10000, "number of logs in an epoch.");
+DEFINE_int32(bench_vertex_labels, 2,
+             "number of vertex labels, there is an edge label between "
+             "each pair of adjacent vertex labels.");
+DEFINE_double(bench_edge_ratio, 0.8, "ratio of edges in generated logs.");
+DEFINE_double(bench_delete_ratio, 0.0,
+              "ratio of deletions in generated logs, split between vertices "
+              "and edges by --bench_edge_ratio.");
+DEFINE_double(bench_update_ratio, 0.1,
+              "ratio of vertex property updates in generated logs.");
+DEFINE_int32(bench_int_props, 2, "number of int64 properties of a vertex.");
+DEFINE_int32(bench_string_props, 1,
+             "number of string properties of a vertex.");
+DEFINE_int32(bench_string_len, 32, "length of string properties (< 256).");
+DEFINE_int32(bench_edge_props, 1, "number of int64 properties of an edge.");
+DEFINE_int32(bench_seed, 0, "seed of the log generator.");
+
+// heap allocations of the whole process, counted while logs are applied
+namespace {
+std::atomic<bool> count_allocs(false);
+std::atomic<uint64_t> alloc_bytes(0);
+std::atomic<uint64_t> alloc_calls(0);
+
+inline void count_alloc(size_t size) {
+  if (count_allocs.load(std::memory_order_relaxed)) {
+    alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    alloc_calls.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+}  // namespace
+
+#ifdef __GLIBC__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+// operator new is served by malloc, so this also counts C++ allocations
+void* malloc(size_t size) {
+  count_alloc(size);
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  count_alloc(num * size);
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  count_alloc(size);
+  return __libc_realloc(ptr, size);
+}
+}  // extern "C"
+#endif
+
+namespace {
+
+using json = vineyard::json;
+using Clock = std::chrono::steady_clock;
+
+// rows of the property columns of a vertex label in a fragment
+constexpr int64_t kMaxVerticesPerLabel = gart::graph::kPropertyCapacity;
+
+// indexed by LogOp
+constexpr int kNumOps = static_cast<int>(gart::LogOp::kUpdateVertex) + 1;
+const char* kOpNames[kNumOps] = {
+    "invalid",     "add_vertex", "add_edge",     "delete_vertex",
+    "delete_edge", "epoch",      "update_vertex"};
+
+std::string vertex_label(int vlabel) { return "v" + std::to_string(vlabel); }
+
+std::string edge_label(int elabel) { return "e" + std::to_string(elabel); }
+
+// the edge label `elabel` links vertex label `elabel` to the next one
+int edge_dst_label(int elabel) {
+  return (elabel + 1) % FLAGS_bench_vertex_labels;
+}
+
+void write_json(const std::string& path, const json& value) {
+  std::ofstream file(path);
+  file << value.dump(2);
+  if (!file.good()) {
+    LOG(ERROR) << "Write file (" << path << ") failed.";
+    exit(1);
+  }
+}
+
+void generate_schema(const std::string& rg_mapping_path,
+                     const std::string& table_schema_path) {
+  int num_labels = FLAGS_bench_vertex_labels;
+  json types = json::array();
+  json tables = json::object();
+  for (int vlabel = 0; vlabel < num_labels; vlabel++) {
+    std::string name = vertex_label(vlabel);
+    json props = json::array();
+    json columns = json::array();
+    int num_props = 1 + FLAGS_bench_int_props + FLAGS_bench_string_props;
+    for (int idx = 0; idx < num_props; idx++) {
+      std::string column = idx == 0 ? "id" : "p" + std::to_string(idx);
+      props.push_back({{"id", idx},
+                       {"name", name + "_" + column},
+                       {"column_name", column}});
+      bool is_string = idx > FLAGS_bench_int_props;
+      columns.push_back({column, is_string ? "varchar(255)" : "int64"});
+    }
+    types.push_back({{"type", "VERTEX"},
+                     {"id", vlabel},
+                     {"label", name},
+                     {"table_name", name},
+                     {"id_column_name", "id"},
+                     {"propertyDefList", props},
+                     {"rawRelationShips", json::array({json::object()})}});
+    tables[name] = columns;
+  }
+  for (int elabel = 0; elabel < num_labels; elabel++) {
+    std::string name = edge_label(elabel);
+    json props = json::array();
+    json columns = {{"src", "int64"}, {"dst", "int64"}};
+    for (int idx = 0; idx < FLAGS_bench_edge_props; idx++) {
+      std::string column = "w" + std::to_string(idx);
+      props.push_back({{"id", idx},
+                       {"name", name + "_" + column},
+                       {"column_name", column}});
+      columns.push_back({column, "int64"});
+    }
+    json relation = {{"srcVertexLabel", vertex_label(elabel)},
+                     {"dstVertexLabel", vertex_label(edge_dst_label(elabel))},
+                     {"src_column_name", "src"},
+                     {"dst_column_name", "dst"}};
+    types.push_back({{"type", "EDGE"},
+                     {"id", num_labels + elabel},
+                     {"label", name},
+                     {"table_name", name},
+                     {"propertyDefList", props},
+                     {"rawRelationShips", json::array({relation})}});
+    tables[name] = columns;
+  }
+
+  write_json(rg_mapping_path,
+             {{"vertexLabelNum", num_labels}, {"types", types}});
+  write_json(table_schema_path, tables);
+}
+
+struct LogMix {
+  uint64_t num_logs[kNumOps] = {0};
+  uint64_t num_epochs = 0;
+  uint64_t num_bytes = 0;
+};
+
+/**
+ * Generates text UnifiedLogs of FLAGS_bench_num_ops operations. Vertices are
+ * assigned to fragments round-robin as the converter does; edges, updates
+ * and deletions only refer to live vertices.
+ */
+LogMix generate_logs(const std::string& log_path, int num_partitions) {
+  int num_labels = FLAGS_bench_vertex_labels;
+  gart::IdParser<int64_t> id_parser;
+  id_parser.Init(num_partitions, num_labels);
+
+  std::mt19937_64 rng(FLAGS_bench_seed);
+  std::uniform_real_distribution<double> coin(0, 1);
+  auto pick = [&rng](size_t n) {
+    return std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+  };
+
+  std::vector<std::vector<int64_t>> live_vertices(num_labels);
+  std::vector<int64_t> vertex_nums(num_labels, 0);
+  std::vector<std::vector<int64_t>> vertex_nums_per_fragment(
+      num_labels, std::vector<int64_t>(num_partitions, 0));
+  struct Edge {
+    int elabel;
+    int64_t src;
+    int64_t dst;
+  };
+  std::vector<Edge> live_edges;
+  std::unordered_set<int64_t> deleted_vertices;
+
+  std::string str_value(std::min(FLAGS_bench_string_len, 255), 'x');
+  std::ofstream out(log_path, std::ios::trunc);
+  LogMix mix;
+  std::string line;
+  for (int64_t idx = 0; idx < FLAGS_bench_num_ops; idx++) {
+    uint64_t epoch = idx / FLAGS_bench_logs_per_epoch;
+    std::string prefix = "|" + std::to_string(epoch) + "|";
+    bool is_delete = coin(rng) < FLAGS_bench_delete_ratio;
+    bool is_update = !is_delete && coin(rng) < FLAGS_bench_update_ratio;
+    bool is_edge = coin(rng) < FLAGS_bench_edge_ratio;
+    int elabel = pick(num_labels);
+    int vlabel = pick(num_labels);
+    line.clear();
+
+    if (is_delete && is_edge) {
+      // skip the edges whose endpoints are deleted
+      while (!live_edges.empty()) {
+        size_t pos = pick(live_edges.size());
+        Edge edge = live_edges[pos];
+        live_edges[pos] = live_edges.back();
+        live_edges.pop_back();
+        if (!deleted_vertices.count(edge.src) &&
+            !deleted_vertices.count(edge.dst)) {
+          line = "delete_edge" + prefix + std::to_string(edge.elabel) + "|" +
+                 std::to_string(edge.src) + "|" + std::to_string(edge.dst);
+          mix.num_logs[static_cast<int>(gart::LogOp::kDeleteEdge)]++;
+          break;
+        }
+      }
+    } else if (is_delete && !live_vertices[vlabel].empty()) {
+      auto& vertices = live_vertices[vlabel];
+      size_t pos = pick(vertices.size());
+      int64_t gid = vertices[pos];
+      vertices[pos] = vertices.back();
+      vertices.pop_back();
+      deleted_vertices.insert(gid);
+      line = "delete_vertex" + prefix + std::to_string(gid);
+      mix.num_logs[static_cast<int>(gart::LogOp::kDeleteVertex)]++;
+    } else if (is_update && !live_vertices[vlabel].empty()) {
+      // change one property other than the id
+      const auto& vertices = live_vertices[vlabel];
+      int64_t gid = vertices[pick(vertices.size())];
+      int num_props = FLAGS_bench_int_props + FLAGS_bench_string_props;
+      int prop = num_props == 0 ? 0 : 1 + pick(num_props);
+      line = "update_vertex" + prefix + std::to_string(gid) + "|" +
+             std::to_string(prop) + "|" +
+             (prop > FLAGS_bench_int_props ? str_value : std::to_string(idx));
+      mix.num_logs[static_cast<int>(gart::LogOp::kUpdateVertex)]++;
+    } else if (is_edge && !live_vertices[elabel].empty() &&
+               !live_vertices[edge_dst_label(elabel)].empty()) {
+      const auto& srcs = live_vertices[elabel];
+      const auto& dsts = live_vertices[edge_dst_label(elabel)];
+      Edge edge{elabel, srcs[pick(srcs.size())], dsts[pick(dsts.size())]};
+      live_edges.push_back(edge);
+      line = "add_edge" + prefix + std::to_string(elabel) + "|" +
+             std::to_string(edge.src) + "|" + std::to_string(edge.dst);
+      for (int prop = 0; prop < FLAGS_bench_edge_props; prop++) {
+        line += "|" + std::to_string(idx);
+      }
+      mix.num_logs[static_cast<int>(gart::LogOp::kAddEdge)]++;
+    }
+
+    if (line.empty()) {
+      int fid = vertex_nums[vlabel] % num_partitions;
+      int64_t offset = vertex_nums_per_fragment[vlabel][fid];
+      if (offset >= kMaxVerticesPerLabel) {
+        LOG(ERROR) << "Too many vertices of label " << vlabel
+                   << " in fragment " << fid << ", use more partitions, "
+                   << "labels or edges.";
+        exit(1);
+      }
+      vertex_nums[vlabel]++;
+      vertex_nums_per_fragment[vlabel][fid]++;
+      int64_t gid = id_parser.GenerateId(fid, vlabel, offset);
+      live_vertices[vlabel].push_back(gid);
+      line = "add_vertex" + prefix + std::to_string(gid) + "|" +
+             std::to_string(idx);
+      for (int prop = 0; prop < FLAGS_bench_int_props; prop++) {
+        line += "|" + std::to_string(idx + prop);
+      }
+      for (int prop = 0; prop < FLAGS_bench_string_props; prop++) {
+        line += "|" + str_value;
+      }
+      mix.num_logs[static_cast<int>(gart::LogOp::kAddVertex)]++;
+    }
+
+    out << line << '\n';
+    mix.num_bytes += line.size() + 1;
+    mix.num_epochs = epoch + 1;
+  }
+  if (!out.good()) {
+    LOG(ERROR) << "Write log file (" << log_path << ") failed.";
+    exit(1);
+  }
+  return mix;
+}
+
+// collects per-log and per-epoch latencies of the Runner
+class BenchObserver : public gart::framework::IngestObserver {
+ public:
+  BenchObserver(int num_partitions, uint64_t num_logs, uint64_t num_epochs)
+      : partitions_(num_partitions), num_active_(0) {
+    // reserve up front, so that recording does not allocate
+    for (auto& partition : partitions_) {
+      partition.latencies.reserve(num_logs);
+      partition.ops.reserve(num_logs);
+    }
+    publish_latencies_.reserve(num_epochs * num_partitions + 1);
+  }
+
+  void OnStreamBegin(int p_id) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (num_active_++ == 0 && begin_ == Clock::time_point()) {
+      begin_ = Clock::now();
+      count_allocs = true;
+    }
+  }
+
+  void OnStreamEnd(int p_id) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--num_active_ == 0) {
+      count_allocs = false;
+      end_ = Clock::now();
+    }
+  }
+
+  void OnLogApplied(int p_id, gart::LogOp op, Duration latency) override {
+    Partition& partition = partitions_[p_id];
+    partition.latencies.push_back(latency.count());
+    partition.ops.push_back(static_cast<uint8_t>(op));
+  }
+
+  void OnEpochPublished(int p_id, uint64_t epoch, Duration latency) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publish_latencies_.push_back(latency.count());
+  }
+
+  void Report(const LogMix& mix) {
+    double seconds = std::chrono::duration<double>(end_ - begin_).count();
+    uint64_t num_logs = FLAGS_bench_num_ops;
+    printf("\n***** Ingest Benchmark ****\n");
+    printf("partitions:        %zu (each scans all logs)\n",
+           partitions_.size());
+    printf("logs:              %lu in %lu epochs, %.1f bytes/log\n", num_logs,
+           mix.num_epochs, 1.0 * mix.num_bytes / num_logs);
+    for (int op = 1; op < kNumOps; op++) {
+      if (mix.num_logs[op] != 0) {
+        printf("  %-16s %lu\n", kOpNames[op], mix.num_logs[op]);
+      }
+    }
+    printf("elapsed:           %.3f s\n", seconds);
+    printf("throughput:        %.0f logs/s\n", num_logs / seconds);
+    printf("heap allocations:  %.1f bytes/log, %.2f calls/log\n",
+           1.0 * alloc_bytes / num_logs, 1.0 * alloc_calls / num_logs);
+
+    std::vector<uint64_t> by_op[kNumOps];
+    for (const auto& partition : partitions_) {
+      for (size_t idx = 0; idx < partition.ops.size(); idx++) {
+        by_op[partition.ops[idx]].push_back(partition.latencies[idx]);
+      }
+    }
+    if (std::all_of(std::begin(by_op), std::end(by_op),
+                    [](const auto& lat) { return lat.empty(); })) {
+      printf("apply latency:     n/a with the apply pipeline\n");
+    } else {
+      printf("apply latency (ns): %16s %10s %10s\n", "p50", "p99", "max");
+      for (int op = 1; op < kNumOps; op++) {
+        print_latency(kOpNames[op], by_op[op], 1);
+      }
+    }
+    printf("publish latency (us):%15s %10s %10s\n", "p50", "p99", "max");
+    print_latency("epoch", publish_latencies_, 1000);
+  }
+
+ private:
+  struct Partition {
+    std::vector<uint64_t> latencies;  // in Clock ticks
+    std::vector<uint8_t> ops;
+  };
+
+  static void print_latency(const char* name, std::vector<uint64_t>& lat,
+                            uint64_t unit) {
+    if (lat.empty()) {
+      return;
+    }
+    auto percentile = [&lat, unit](double p) {
+      size_t pos = std::min(lat.size() - 1, size_t(lat.size() * p));
+      std::nth_element(lat.begin(), lat.begin() + pos, lat.end());
+      return to_ns(lat[pos]) / unit;
+    };
+    uint64_t p50 = percentile(0.5), p99 = percentile(0.99);
+    uint64_t max = to_ns(*std::max_element(lat.begin(), lat.end())) / unit;
+    printf("  %-16s %19lu %10lu %10lu\n", name, p50, p99, max);
+  }
+
+  static uint64_t to_ns(uint64_t ticks) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               Duration(ticks))
+        .count();
+  }
+
+  std::vector<Partition> partitions_;
+
+  std::mutex mutex_;
+  int num_active_;
+  Clock::time_point begin_, end_;
+  std::vector<uint64_t> publish_latencies_;
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  // all partitions are hosted by this process unless told otherwise
+  gflags::SetCommandLineOptionWithMode("server_num", "1",
+                                       gflags::SET_FLAGS_DEFAULT);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (FLAGS_bench_num_ops <= 0 || FLAGS_bench_logs_per_epoch <= 0 ||
+      FLAGS_bench_vertex_labels <= 0 || FLAGS_bench_edge_ratio < 0 ||
+      FLAGS_bench_edge_ratio > 1 || FLAGS_bench_delete_ratio < 0 ||
+      FLAGS_bench_delete_ratio > 1 || FLAGS_bench_update_ratio < 0 ||
+      FLAGS_bench_update_ratio > 1 || FLAGS_bench_int_props < 0 ||
+      FLAGS_bench_string_props < 0 || FLAGS_bench_string_len < 0 ||
+      FLAGS_bench_edge_props < 0) {
+    LOG(ERROR) << "Invalid benchmark arguments.";
+    exit(1);
+  }
+
+  gart::framework::config.parse_sys_args(argc, argv);
+  int num_partitions = gart::framework::config.getNumPartitions();
+
+  std::filesystem::create_directories(FLAGS_bench_dir);
+  FLAGS_schema_file_path = FLAGS_bench_dir + "/rgmapping.json";
+  FLAGS_table_schema_file_path = FLAGS_bench_dir + "/db_schema.json";
+  FLAGS_kafka_unified_log_file = FLAGS_bench_dir + "/unified_log.txt";
+  generate_schema(FLAGS_schema_file_path, FLAGS_table_schema_file_path);
+  LogMix mix = generate_logs(FLAGS_kafka_unified_log_file, num_partitions);
+
+  BenchObserver observer(num_partitions, FLAGS_bench_num_ops, mix.num_epochs);
+  gart::framework::Runner runner;
+  runner.set_observer(&observer);
+  runner.run();
+
+  observer.Report(mix);
+  return 0;
+}